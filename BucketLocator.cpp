@@ -0,0 +1,214 @@
+#include "BucketLocator.h"
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define IOT_BUCKET_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define IOT_TARGET_AVX2
+#else
+#define IOT_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+using LocateFunction = size_t (*)(double, const double*, size_t);
+using BinFunction = void (*)(const double*, size_t, const double*, size_t, uint64_t*);
+
+/// @brief A bucket kernel and its name.
+struct Kernel {
+    const char* name;
+    LocateFunction locate;
+    BinFunction bin;
+};
+
+//==============================================================================
+// SCALAR KERNEL
+//==============================================================================
+
+/**
+ * @brief Branchless binary search for the first boundary >= value.
+ *
+ * The comparison selects the next base with a conditional move rather than a
+ * branch, so the search runs in a fixed number of steps for a given count.
+ */
+size_t locateScalar(double value, const double* boundaries, size_t boundary_count) {
+    if (boundary_count == 0) {
+        return 0;
+    }
+    const double* base = boundaries;
+    size_t length = boundary_count;
+    while (length > 1) {
+        const size_t half = length / 2;
+        // NaN compares false, so it moves right and ends in +Inf
+        base += !(value <= base[half]) ? half : 0;
+        length -= half;
+    }
+    return static_cast<size_t>(base - boundaries) + (!(value <= *base) ? 1 : 0);
+}
+
+void binScalar(const double* values, size_t value_count,
+    const double* boundaries, size_t boundary_count, uint64_t* bucket_counts) {
+    for (size_t i = 0; i < value_count; ++i) {
+        ++bucket_counts[locateScalar(values[i], boundaries, boundary_count)];
+    }
+}
+
+#ifdef IOT_BUCKET_X86
+
+//==============================================================================
+// SSE2 KERNEL
+//==============================================================================
+
+/**
+ * @brief Counts boundaries below the value two at a time.
+ *
+ * cmpnle yields all-ones lanes (-1) where !(value <= boundary), NaN included;
+ * subtracting the mask accumulates the count per lane.
+ */
+size_t locateSse2(double value, const double* boundaries, size_t boundary_count) {
+    const __m128d broadcast = _mm_set1_pd(value);
+    __m128i below = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 2 <= boundary_count; i += 2) {
+        const __m128d mask = _mm_cmpnle_pd(broadcast, _mm_loadu_pd(boundaries + i));
+        below = _mm_sub_epi64(below, _mm_castpd_si128(mask));
+    }
+
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), below);
+    size_t count = static_cast<size_t>(lanes[0] + lanes[1]);
+    for (; i < boundary_count; ++i) {
+        count += !(value <= boundaries[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+void binSse2(const double* values, size_t value_count,
+    const double* boundaries, size_t boundary_count, uint64_t* bucket_counts) {
+    for (size_t i = 0; i < value_count; ++i) {
+        ++bucket_counts[locateSse2(values[i], boundaries, boundary_count)];
+    }
+}
+
+//==============================================================================
+// AVX2 KERNEL
+//==============================================================================
+
+/**
+ * @brief Counts boundaries below the value four at a time.
+ */
+IOT_TARGET_AVX2 size_t locateAvx2(double value, const double* boundaries, size_t boundary_count) {
+    const __m256d broadcast = _mm256_set1_pd(value);
+    __m256i below = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 4 <= boundary_count; i += 4) {
+        const __m256d mask = _mm256_cmp_pd(broadcast, _mm256_loadu_pd(boundaries + i), _CMP_NLE_UQ);
+        below = _mm256_sub_epi64(below, _mm256_castpd_si256(mask));
+    }
+
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), below);
+    size_t count = static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+    for (; i < boundary_count; ++i) {
+        count += !(value <= boundaries[i]) ? 1 : 0;
+    }
+    return count;
+}
+
+IOT_TARGET_AVX2 void binAvx2(const double* values, size_t value_count,
+    const double* boundaries, size_t boundary_count, uint64_t* bucket_counts) {
+    for (size_t i = 0; i < value_count; ++i) {
+        ++bucket_counts[locateAvx2(values[i], boundaries, boundary_count)];
+    }
+}
+
+/**
+ * @brief Checks that the CPU and the OS support AVX2.
+ */
+bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 &&
+        (_xgetbv(0) & 0x6) == 0x6;
+    if (!os_saves_ymm) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // IOT_BUCKET_X86
+
+/**
+ * @brief Picks the widest kernel the CPU supports, or the one IOT_METRICS_BUCKET_KERNEL names.
+ *
+ * Only a narrower kernel can be forced; an unknown or unsupported name is ignored.
+ */
+Kernel selectKernel() {
+    const char* forced = std::getenv("IOT_METRICS_BUCKET_KERNEL");
+    const std::string_view name = forced ? forced : "";
+    if (name == "scalar") {
+        return { "scalar", &locateScalar, &binScalar };
+    }
+#ifdef IOT_BUCKET_X86
+    if (name != "sse2" && cpuSupportsAvx2()) {
+        return { "avx2", &locateAvx2, &binAvx2 };
+    }
+    return { "sse2", &locateSse2, &binSse2 };
+#else
+    return { "scalar", &locateScalar, &binScalar };
+#endif
+}
+
+/**
+ * @brief The kernel selected on first use.
+ */
+const Kernel& kernel() {
+    static const Kernel selected = selectKernel();
+    return selected;
+}
+
+} // namespace
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Returns the bucket index of one value.
+ * @param value Observed value.
+ * @param boundaries Sorted bucket boundaries.
+ * @param boundary_count Number of boundaries.
+ * @return Index in [0, boundary_count].
+ */
+size_t BucketLocator::locate(double value, const double* boundaries, size_t boundary_count) {
+    return kernel().locate(value, boundaries, boundary_count);
+}
+
+/**
+ * @brief Bins an array of values with one kernel dispatch for the whole array.
+ * @param values Observed values.
+ * @param value_count Number of values.
+ * @param boundaries Sorted bucket boundaries.
+ * @param boundary_count Number of boundaries.
+ * @param bucket_counts Per-bucket counts (boundary_count + 1 entries).
+ */
+void BucketLocator::binMany(const double* values, size_t value_count,
+    const double* boundaries, size_t boundary_count, uint64_t* bucket_counts) {
+    kernel().bin(values, value_count, boundaries, boundary_count, bucket_counts);
+}
+
+/**
+ * @brief Returns the name of the selected kernel.
+ */
+const char* BucketLocator::kernelName() {
+    return kernel().name;
+}
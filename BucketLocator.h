@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Locates histogram buckets for observed values.
+///
+/// The bucket of a value is the index of the first boundary it is less than or
+/// equal to, or the number of boundaries (the +Inf bucket) if it exceeds them
+/// all; NaN always lands in +Inf. Boundaries must be sorted ascending. The
+/// kernel is chosen once at startup from what the CPU supports: AVX2 compares
+/// four boundaries per instruction and SSE2 two, counting the boundaries below
+/// the value with no data-dependent branches. Elsewhere a branchless binary
+/// search is used. IOT_METRICS_BUCKET_KERNEL=scalar or sse2 forces a narrower
+/// kernel than the CPU allows (all kernels return the same buckets).
+class BucketLocator {
+public:
+    /// @brief Bucket index of one value.
+    /// @param value Observed value.
+    /// @param boundaries Sorted bucket boundaries.
+    /// @param boundary_count Number of boundaries.
+    /// @return Index in [0, boundary_count].
+    static size_t locate(double value, const double* boundaries, size_t boundary_count);
+
+    /// @brief Bin an array of values, incrementing one bucket count per value.
+    /// @param values Observed values.
+    /// @param value_count Number of values.
+    /// @param boundaries Sorted bucket boundaries.
+    /// @param boundary_count Number of boundaries.
+    /// @param bucket_counts Per-bucket counts (boundary_count + 1 entries).
+    static void binMany(const double* values, size_t value_count,
+        const double* boundaries, size_t boundary_count, uint64_t* bucket_counts);
+
+    /// @brief Name of the selected kernel ("avx2", "sse2" or "scalar").
+    static const char* kernelName();
+};
@@ -0,0 +1,239 @@
+#include "ExponentialHistogram.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+//==============================================================================
+// CONSTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Constructs an empty histogram at the finest scale.
+ * @param max_size Maximum number of buckets per sign.
+ */
+ExponentialHistogram::ExponentialHistogram(size_t max_size)
+    : max_size_(max_size < 2 ? 2 : max_size)
+{
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Records one finite value.
+ *
+ * If the value's bucket lies outside the window the sign can hold, the whole
+ * histogram is downscaled first by the fewest steps that make it fit.
+ * @param value Value to record.
+ */
+void ExponentialHistogram::record(double value) {
+    count_++;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    if (value == 0.0) {
+        zero_count_++;
+        return;
+    }
+
+    Buckets& buckets = value > 0.0 ? positive_ : negative_;
+    const double magnitude = std::fabs(value);
+    int32_t index = mapToIndex(magnitude, scale_);
+
+    if (!buckets.counts.empty()) {
+        const int32_t low = std::min(buckets.offset, index);
+        const int32_t high = std::max(buckets.offset + static_cast<int32_t>(buckets.counts.size()) - 1, index);
+        // The window can span more than INT32_MAX indexes at fine scales, so measure it in 64 bits
+        int32_t change = 0;
+        while (static_cast<int64_t>(shiftIndex(high, change)) - shiftIndex(low, change) + 1 >
+            static_cast<int64_t>(max_size_) && scale_ - change > min_scale) {
+            ++change;
+        }
+        if (change > 0) {
+            downscaleBy(change);
+            index = mapToIndex(magnitude, scale_);
+        }
+    }
+    increment(buckets, index);
+}
+
+/**
+ * @brief Replaces the state with a previously saved one.
+ * @param scale Scale the buckets are at.
+ * @param count Number of recorded values.
+ * @param sum Sum of recorded values.
+ * @param min Smallest recorded value.
+ * @param max Largest recorded value.
+ * @param zero_count Number of recorded zeros.
+ * @param positive Buckets of positive values.
+ * @param negative Buckets of negative values.
+ * @return False, leaving the histogram unchanged, if the state does not fit this histogram.
+ */
+bool ExponentialHistogram::restore(int32_t scale, uint64_t count, double sum, double min, double max,
+    uint64_t zero_count, Buckets positive, Buckets negative) {
+    if (scale < min_scale || scale > max_scale ||
+        positive.counts.size() > max_size_ || negative.counts.size() > max_size_) {
+        return false;
+    }
+    scale_ = scale;
+    count_ = count;
+    sum_ = sum;
+    min_ = min;
+    max_ = max;
+    zero_count_ = zero_count;
+    positive_ = std::move(positive);
+    negative_ = std::move(negative);
+    return true;
+}
+
+/**
+ * @brief Maps a positive finite value to its bucket index.
+ *
+ * The base-2 exponent comes from the exponent bits (frexp for subnormals).
+ * Exact powers of two sit on a bucket's upper bound and are handled exactly;
+ * other values use log2 of the mantissa in [1, 2) for the sub-octave position.
+ * @param value Positive finite value.
+ * @param scale Histogram scale.
+ * @return Bucket index at that scale.
+ */
+int32_t ExponentialHistogram::mapToIndex(double value, int32_t scale) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const int32_t biased_exponent = static_cast<int32_t>((bits >> 52) & 0x7FF);
+    const uint64_t significand = bits & ((uint64_t{ 1 } << 52) - 1);
+
+    int32_t exponent;
+    double mantissa;
+    if (biased_exponent == 0) {
+        // Subnormal: normalize through frexp (mantissa in [0.5, 1))
+        int frexp_exponent;
+        mantissa = std::frexp(value, &frexp_exponent) * 2.0;
+        exponent = frexp_exponent - 1;
+    }
+    else {
+        exponent = biased_exponent - 1023;
+        const uint64_t one_bits = (uint64_t{ 1023 } << 52) | significand;
+        std::memcpy(&mantissa, &one_bits, sizeof(mantissa));
+    }
+    const bool power_of_two = mantissa == 1.0;
+
+    if (scale <= 0) {
+        // Buckets are (2^i, 2^(i+1)] at scale 0: exact powers belong to the bucket below
+        return shiftIndex(power_of_two ? exponent - 1 : exponent, -scale);
+    }
+    const int32_t buckets_per_octave = int32_t{ 1 } << scale;
+    if (power_of_two) {
+        return exponent * buckets_per_octave - 1;
+    }
+    const int32_t within = static_cast<int32_t>(std::ceil(std::log2(mantissa) * buckets_per_octave)) - 1;
+    return exponent * buckets_per_octave + std::min(std::max(within, int32_t{ 0 }), buckets_per_octave - 1);
+}
+
+/**
+ * @brief Merges buckets into a coarser scale.
+ * @param source Buckets at some scale s.
+ * @param change Number of scale steps to drop (>= 0).
+ * @param target Receives the buckets at scale s - change.
+ */
+void ExponentialHistogram::downscale(const Buckets& source, int32_t change, Buckets& target) {
+    target.counts.clear();
+    if (source.counts.empty()) {
+        target.offset = 0;
+        return;
+    }
+
+    target.offset = shiftIndex(source.offset, change);
+    const int32_t last = shiftIndex(source.offset + static_cast<int32_t>(source.counts.size()) - 1, change);
+    target.counts.assign(static_cast<size_t>(last - target.offset) + 1, 0);
+    for (size_t i = 0; i < source.counts.size(); ++i) {
+        const int32_t index = shiftIndex(source.offset + static_cast<int32_t>(i), change);
+        target.counts[static_cast<size_t>(index - target.offset)] += source.counts[i];
+    }
+}
+
+/**
+ * @brief Builds cumulative classic buckets at power-of-two bounds.
+ *
+ * The histogram is viewed at scale min(scale, 0), where every bucket bound is
+ * an exact power of two. Negative buckets come first (most negative bound
+ * first), then le=0 when there are zeros or negatives, then the positive
+ * buckets up to the largest finite bound.
+ * @param out Cleared and filled in ascending order of bound.
+ */
+void ExponentialHistogram::classicBuckets(std::vector<ClassicBucket>& out) const {
+    out.clear();
+    thread_local Buckets positive, negative;
+    const int32_t change = scale_ > 0 ? scale_ : 0;
+    const int32_t octaves_per_bucket = int32_t{ 1 } << (change - scale_);
+    downscale(positive_, change, positive);
+    downscale(negative_, change, negative);
+
+    uint64_t cumulative = 0;
+    for (size_t i = negative.counts.size(); i-- > 0;) {
+        cumulative += negative.counts[i];
+        const double bound = -std::ldexp(1.0, (negative.offset + static_cast<int32_t>(i)) * octaves_per_bucket);
+        if (bound != 0.0 && std::isfinite(bound)) {
+            out.push_back({ bound, cumulative });
+        }
+    }
+
+    cumulative += zero_count_;
+    if (zero_count_ > 0 || !negative.counts.empty()) {
+        out.push_back({ 0.0, cumulative });
+    }
+
+    for (size_t i = 0; i < positive.counts.size(); ++i) {
+        cumulative += positive.counts[i];
+        const double bound = std::ldexp(1.0, (positive.offset + static_cast<int32_t>(i) + 1) * octaves_per_bucket);
+        if (!std::isfinite(bound)) {
+            break;
+        }
+        if (bound != 0.0) {
+            out.push_back({ bound, cumulative });
+        }
+    }
+}
+
+//==============================================================================
+// PRIVATE METHODS
+//==============================================================================
+
+/**
+ * @brief Adds one to a bucket, growing the window on either side as needed.
+ * @param buckets Buckets of one sign.
+ * @param index Bucket index (the caller has ensured the window fits).
+ */
+void ExponentialHistogram::increment(Buckets& buckets, int32_t index) {
+    if (buckets.counts.empty()) {
+        buckets.offset = index;
+        buckets.counts.assign(1, 1);
+        return;
+    }
+    if (index < buckets.offset) {
+        buckets.counts.insert(buckets.counts.begin(), static_cast<size_t>(buckets.offset - index), 0);
+        buckets.offset = index;
+    }
+    const size_t position = static_cast<size_t>(index - buckets.offset);
+    if (position >= buckets.counts.size()) {
+        buckets.counts.resize(position + 1, 0);
+    }
+    buckets.counts[position]++;
+}
+
+/**
+ * @brief Downscales both signs by change steps.
+ * @param change Number of scale steps to drop.
+ */
+void ExponentialHistogram::downscaleBy(int32_t change) {
+    Buckets merged;
+    downscale(positive_, change, merged);
+    positive_.offset = merged.offset;
+    positive_.counts.swap(merged.counts);
+    downscale(negative_, change, merged);
+    negative_.offset = merged.offset;
+    negative_.counts.swap(merged.counts);
+    scale_ -= change;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// @brief Base-2 exponential histogram aggregation (OpenTelemetry data model).
+///
+/// At scale s, bucket index i holds values in (base^i, base^(i+1)] with
+/// base = 2^(2^-s). Indexes come straight from the IEEE 754 exponent and
+/// mantissa, so recording is O(1). Each sign keeps at most max_size contiguous
+/// buckets; when a value falls outside that window the histogram downscales
+/// (adjacent buckets merge pairwise per step) until it fits, so memory per
+/// series is bounded whatever the range. Zero goes to a separate zero bucket.
+class ExponentialHistogram {
+public:
+    /// @brief Default maximum number of buckets per sign (OpenTelemetry SDK default).
+    static constexpr size_t default_max_size = 160;
+    /// @brief Starting (finest) scale (OpenTelemetry SDK default).
+    static constexpr int32_t max_scale = 20;
+    /// @brief Coarsest scale: the coarsest schema Prometheus accepts for native histograms.
+    /// At default_max_size buckets it already spans the whole double range, so only a much
+    /// smaller max_size can outgrow its window here.
+    static constexpr int32_t min_scale = -4;
+
+    /// @brief A contiguous run of bucket counts starting at index offset.
+    struct Buckets {
+        /// @brief Index of counts[0].
+        int32_t offset = 0;
+        /// @brief Per-bucket counts.
+        std::vector<uint64_t> counts;
+    };
+
+    /// @brief A cumulative classic bucket: observations <= upper_bound.
+    struct ClassicBucket {
+        /// @brief Inclusive upper bound (le).
+        double upper_bound;
+        /// @brief Cumulative count.
+        uint64_t cumulative_count;
+    };
+
+    /// @brief Construct an empty histogram at max_scale.
+    /// @param max_size Maximum number of buckets per sign.
+    explicit ExponentialHistogram(size_t max_size = default_max_size);
+
+    /// @brief Record one finite value.
+    void record(double value);
+
+    /// @brief Replace the state with a previously saved one (e.g. from a snapshot).
+    /// @return False, leaving the histogram unchanged, if the scale is out of range or a bucket window exceeds max_size.
+    bool restore(int32_t scale, uint64_t count, double sum, double min, double max, uint64_t zero_count,
+        Buckets positive, Buckets negative);
+
+    /// @brief Current scale.
+    int32_t scale() const { return scale_; }
+    /// @brief Number of recorded values.
+    uint64_t count() const { return count_; }
+    /// @brief Sum of recorded values.
+    double sum() const { return sum_; }
+    /// @brief Smallest recorded value.
+    double min() const { return min_; }
+    /// @brief Largest recorded value.
+    double max() const { return max_; }
+    /// @brief Number of recorded zeros.
+    uint64_t zeroCount() const { return zero_count_; }
+    /// @brief Buckets of positive values.
+    const Buckets& positive() const { return positive_; }
+    /// @brief Buckets of negative values (indexed by magnitude).
+    const Buckets& negative() const { return negative_; }
+
+    /// @brief Bucket index of a positive finite value at a scale.
+    static int32_t mapToIndex(double value, int32_t scale);
+
+    /// @brief Merge buckets into a coarser scale.
+    /// @param source Buckets at some scale s.
+    /// @param change Number of scale steps to drop (>= 0).
+    /// @param target Receives the buckets at scale s - change.
+    static void downscale(const Buckets& source, int32_t change, Buckets& target);
+
+    /// @brief Cumulative classic buckets at power-of-two bounds (scale 0 or coarser).
+    ///
+    /// Positive bounds are exact. Negative bounds are approximate at exact powers
+    /// of two, whose values sit on the other side of the bound. The +Inf bucket is
+    /// not included; its cumulative count is count().
+    /// @param out Cleared and filled in ascending order of bound.
+    void classicBuckets(std::vector<ClassicBucket>& out) const;
+
+private:
+    /// @brief Floor of index / 2^change for any sign.
+    static int32_t shiftIndex(int32_t index, int32_t change) {
+        return index >= 0 ? index >> change : -((-index - 1) >> change) - 1;
+    }
+
+    /// @brief Add one to a bucket, widening the window (caller ensures it fits).
+    static void increment(Buckets& buckets, int32_t index);
+
+    /// @brief Downscale both signs by change steps.
+    void downscaleBy(int32_t change);
+
+    /// @brief Maximum number of buckets per sign.
+    size_t max_size_;
+    /// @brief Current scale.
+    int32_t scale_ = max_scale;
+    /// @brief Number of recorded values.
+    uint64_t count_ = 0;
+    /// @brief Sum of recorded values.
+    double sum_ = 0.0;
+    /// @brief Smallest recorded value.
+    double min_ = std::numeric_limits<double>::max();
+    /// @brief Largest recorded value.
+    double max_ = std::numeric_limits<double>::lowest();
+    /// @brief Number of recorded zeros.
+    uint64_t zero_count_ = 0;
+    /// @brief Buckets of positive values.
+    Buckets positive_;
+    /// @brief Buckets of negative values, by magnitude.
+    Buckets negative_;
+};
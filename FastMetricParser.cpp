@@ -0,0 +1,391 @@
+#include "FastMetricParser.h"
+#include <charconv>
+
+//==============================================================================
+// METRIC POINT VIEW
+//==============================================================================
+
+/**
+ * @brief Resets the view for reuse, keeping the vectors' capacity.
+ */
+void MetricPointView::clear() {
+    metric_name = std::string_view();
+    instrument_type = std::string_view();
+    unit = std::string_view();
+    description = std::string_view();
+    value = 0.0;
+    has_metric_name = false;
+    has_instrument_type = false;
+    has_value = false;
+    has_boundaries = false;
+    boundaries.clear();
+    attributes.clear();
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Parses a text holding a single metric object.
+ * @param text JSON text.
+ * @param view Receives the fields.
+ * @return False if the text is outside the fast-path schema.
+ */
+bool FastMetricParser::parseObject(std::string_view text, MetricPointView& view) {
+    const char* cursor = text.data();
+    const char* end = text.data() + text.size();
+
+    skipWhitespace(cursor, end);
+    if (!scanObject(cursor, end, view)) {
+        return false;
+    }
+    skipWhitespace(cursor, end);
+    return cursor == end;
+}
+
+/**
+ * @brief Parses a text holding a JSON array of metric objects.
+ * @param text JSON text.
+ * @param views Resized to one entry per array element.
+ * @return False if the text or any element is outside the fast-path schema.
+ */
+bool FastMetricParser::parseArray(std::string_view text, std::vector<MetricPointView>& views) {
+    const char* cursor = text.data();
+    const char* end = text.data() + text.size();
+    size_t count = 0;
+
+    skipWhitespace(cursor, end);
+    if (cursor == end || *cursor != '[') {
+        return false;
+    }
+    ++cursor;
+    skipWhitespace(cursor, end);
+
+    if (cursor < end && *cursor == ']') {
+        ++cursor;
+    }
+    else {
+        for (;;) {
+            if (count == views.size()) {
+                views.emplace_back();
+            }
+            if (!scanObject(cursor, end, views[count])) {
+                return false;
+            }
+            ++count;
+
+            skipWhitespace(cursor, end);
+            if (cursor == end) {
+                return false;
+            }
+            if (*cursor == ']') {
+                ++cursor;
+                break;
+            }
+            if (*cursor != ',') {
+                return false;
+            }
+            ++cursor;
+            skipWhitespace(cursor, end);
+        }
+    }
+
+    views.resize(count);
+    skipWhitespace(cursor, end);
+    return cursor == end;
+}
+
+//==============================================================================
+// SCANNERS
+//==============================================================================
+
+/**
+ * @brief Parses one metric object.
+ * @param cursor Position of the opening brace; advanced past the closing brace.
+ * @param end End of the text.
+ * @param view Receives the fields (cleared first).
+ * @return False if the object is outside the fast-path schema.
+ */
+bool FastMetricParser::scanObject(const char*& cursor, const char* end, MetricPointView& view) {
+    view.clear();
+    if (cursor == end || *cursor != '{') {
+        return false;
+    }
+    ++cursor;
+    skipWhitespace(cursor, end);
+    if (cursor < end && *cursor == '}') {
+        ++cursor;
+        return true;
+    }
+
+    for (;;) {
+        std::string_view key;
+        if (!scanString(cursor, end, key)) {
+            return false;
+        }
+        skipWhitespace(cursor, end);
+        if (cursor == end || *cursor != ':') {
+            return false;
+        }
+        ++cursor;
+        skipWhitespace(cursor, end);
+
+        bool ok;
+        if (key == "metric_name") {
+            ok = scanString(cursor, end, view.metric_name);
+            view.has_metric_name = true;
+        }
+        else if (key == "instrument_type") {
+            ok = scanString(cursor, end, view.instrument_type);
+            view.has_instrument_type = true;
+        }
+        else if (key == "value") {
+            ok = scanNumber(cursor, end, view.value);
+            view.has_value = true;
+        }
+        else if (key == "unit") {
+            ok = scanString(cursor, end, view.unit);
+        }
+        else if (key == "description") {
+            ok = scanString(cursor, end, view.description);
+        }
+        else if (key == "boundaries") {
+            // A repeated key replaces the earlier array, as in the full parser
+            view.has_boundaries = true;
+            view.boundaries.clear();
+            if (cursor == end || *cursor != '[') {
+                return false;
+            }
+            ++cursor;
+            skipWhitespace(cursor, end);
+            ok = true;
+            if (cursor < end && *cursor == ']') {
+                ++cursor;
+            }
+            else {
+                for (;;) {
+                    double boundary;
+                    if (!scanNumber(cursor, end, boundary)) {
+                        return false;
+                    }
+                    view.boundaries.push_back(boundary);
+
+                    skipWhitespace(cursor, end);
+                    if (cursor == end) {
+                        return false;
+                    }
+                    if (*cursor == ']') {
+                        ++cursor;
+                        break;
+                    }
+                    if (*cursor != ',') {
+                        return false;
+                    }
+                    ++cursor;
+                    skipWhitespace(cursor, end);
+                }
+            }
+        }
+        else if (key == "attributes") {
+            view.attributes.clear();
+            if (cursor == end || *cursor != '{') {
+                return false;
+            }
+            ++cursor;
+            skipWhitespace(cursor, end);
+            ok = true;
+            if (cursor < end && *cursor == '}') {
+                ++cursor;
+            }
+            else {
+                for (;;) {
+                    std::string_view attribute_key, attribute_value;
+                    if (!scanString(cursor, end, attribute_key)) {
+                        return false;
+                    }
+                    skipWhitespace(cursor, end);
+                    if (cursor == end || *cursor != ':') {
+                        return false;
+                    }
+                    ++cursor;
+                    skipWhitespace(cursor, end);
+                    if (!scanString(cursor, end, attribute_value)) {
+                        return false;
+                    }
+                    view.attributes.emplace_back(attribute_key, attribute_value);
+
+                    skipWhitespace(cursor, end);
+                    if (cursor == end) {
+                        return false;
+                    }
+                    if (*cursor == '}') {
+                        ++cursor;
+                        break;
+                    }
+                    if (*cursor != ',') {
+                        return false;
+                    }
+                    ++cursor;
+                    skipWhitespace(cursor, end);
+                }
+            }
+        }
+        else {
+            // Unknown key: leave it to the full parser
+            return false;
+        }
+        if (!ok) {
+            return false;
+        }
+
+        skipWhitespace(cursor, end);
+        if (cursor == end) {
+            return false;
+        }
+        if (*cursor == '}') {
+            ++cursor;
+            return true;
+        }
+        if (*cursor != ',') {
+            return false;
+        }
+        ++cursor;
+        skipWhitespace(cursor, end);
+    }
+}
+
+/**
+ * @brief Parses a string that contains no escape sequences.
+ * @param cursor Position of the opening quote; advanced past the closing quote.
+ * @param end End of the text.
+ * @param out View of the characters between the quotes.
+ * @return False on a backslash, a control character, invalid UTF-8, or a missing quote.
+ */
+bool FastMetricParser::scanString(const char*& cursor, const char* end, std::string_view& out) {
+    if (cursor == end || *cursor != '"') {
+        return false;
+    }
+    const char* begin = ++cursor;
+    while (cursor < end) {
+        unsigned char c = static_cast<unsigned char>(*cursor);
+        if (c == '"') {
+            out = std::string_view(begin, static_cast<size_t>(cursor - begin));
+            ++cursor;
+            return true;
+        }
+        if (c == '\\' || c < 0x20) {
+            return false;
+        }
+        if (c >= 0x80) {
+            if (!scanUtf8Sequence(cursor, end)) {
+                return false;
+            }
+            continue;
+        }
+        ++cursor;
+    }
+    return false;
+}
+
+/**
+ * @brief Skips one multi-byte UTF-8 sequence, checking it is well formed.
+ *
+ * Follows RFC 3629 as the full parser does: overlong forms, UTF-16 surrogates
+ * and code points above U+10FFFF are rejected.
+ * @param cursor Position of the lead byte (>= 0x80); advanced past the sequence.
+ * @param end End of the text.
+ * @return False if the bytes are not a well-formed sequence.
+ */
+bool FastMetricParser::scanUtf8Sequence(const char*& cursor, const char* end) {
+    const unsigned char lead = static_cast<unsigned char>(*cursor);
+    size_t length;
+    unsigned char second_low = 0x80, second_high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0) second_low = 0xA0;
+        if (lead == 0xED) second_high = 0x9F;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0) second_low = 0x90;
+        if (lead == 0xF4) second_high = 0x8F;
+    }
+    else {
+        return false;
+    }
+    if (static_cast<size_t>(end - cursor) < length) {
+        return false;
+    }
+
+    const unsigned char second = static_cast<unsigned char>(cursor[1]);
+    if (second < second_low || second > second_high) {
+        return false;
+    }
+    for (size_t i = 2; i < length; ++i) {
+        const unsigned char continuation = static_cast<unsigned char>(cursor[i]);
+        if (continuation < 0x80 || continuation > 0xBF) {
+            return false;
+        }
+    }
+    cursor += length;
+    return true;
+}
+
+/**
+ * @brief Parses a JSON number (strict grammar, so no inf/nan/hex/leading '+').
+ * @param cursor Position of the first character; advanced past the number.
+ * @param end End of the text.
+ * @param out Parsed value.
+ * @return False if the text is not a JSON number or does not fit a double.
+ */
+bool FastMetricParser::scanNumber(const char*& cursor, const char* end, double& out) {
+    const char* begin = cursor;
+    auto digits = [&]() {
+        const char* start = cursor;
+        while (cursor < end && *cursor >= '0' && *cursor <= '9') {
+            ++cursor;
+        }
+        return cursor > start;
+    };
+
+    if (cursor < end && *cursor == '-') {
+        ++cursor;
+    }
+    if (cursor < end && *cursor == '0') {
+        ++cursor;
+    }
+    else if (!digits()) {
+        return false;
+    }
+    if (cursor < end && *cursor == '.') {
+        ++cursor;
+        if (!digits()) {
+            return false;
+        }
+    }
+    if (cursor < end && (*cursor == 'e' || *cursor == 'E')) {
+        ++cursor;
+        if (cursor < end && (*cursor == '+' || *cursor == '-')) {
+            ++cursor;
+        }
+        if (!digits()) {
+            return false;
+        }
+    }
+
+    auto [number_end, parse_error] = std::from_chars(begin, cursor, out);
+    return parse_error == std::errc() && number_end == cursor;
+}
+
+/**
+ * @brief Skips JSON whitespace (space, tab, CR, LF).
+ */
+void FastMetricParser::skipWhitespace(const char*& cursor, const char* end) {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r' || *cursor == '\n')) {
+        ++cursor;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// @brief A metric submission as views into the request body.
+///
+/// Views stay valid only as long as the buffer that was parsed.
+struct MetricPointView {
+    /// @brief Metric name.
+    std::string_view metric_name;
+    /// @brief Instrument type as submitted.
+    std::string_view instrument_type;
+    /// @brief Unit of measurement (empty if absent).
+    std::string_view unit;
+    /// @brief Metric description (empty if absent).
+    std::string_view description;
+    /// @brief Measurement value.
+    double value = 0.0;
+    /// @brief Whether metric_name was present.
+    bool has_metric_name = false;
+    /// @brief Whether instrument_type was present.
+    bool has_instrument_type = false;
+    /// @brief Whether value was present.
+    bool has_value = false;
+    /// @brief Whether a boundaries array was present.
+    bool has_boundaries = false;
+    /// @brief Histogram bucket boundaries as submitted.
+    std::vector<double> boundaries;
+    /// @brief Attributes in submission order (a repeated key keeps its last value downstream).
+    std::vector<std::pair<std::string_view, std::string_view>> attributes;
+
+    /// @brief Reset for reuse, keeping the vectors' capacity.
+    void clear();
+};
+
+/// @brief Single-pass parser for the fixed metric ingestion schema.
+///
+/// Recognizes exactly the objects clients normally send: the keys metric_name,
+/// instrument_type, unit and description with plain string values, a numeric
+/// value, an array of numeric boundaries, and an attributes object of plain
+/// strings. Strings must be valid UTF-8, as the full parser requires. Anything
+/// else (escape sequences, unknown keys, other value types, invalid UTF-8,
+/// malformed JSON) makes the parse fail without reporting why; callers then
+/// fall back to the full JSON parser, which produces the usual error messages. Nothing is allocated except
+/// growth of the attribute and boundary vectors.
+class FastMetricParser {
+public:
+    /// @brief Parse a text holding a single metric object.
+    /// @param text JSON text (surrounding whitespace allowed).
+    /// @param view Receives the fields.
+    /// @return False if the text is outside the fast-path schema.
+    static bool parseObject(std::string_view text, MetricPointView& view);
+
+    /// @brief Parse a text holding a JSON array of metric objects.
+    /// @param text JSON text (surrounding whitespace allowed).
+    /// @param views Resized to one entry per array element.
+    /// @return False if the text or any element is outside the fast-path schema.
+    static bool parseArray(std::string_view text, std::vector<MetricPointView>& views);
+
+private:
+    /// @brief Parse one metric object starting at cursor (after whitespace).
+    static bool scanObject(const char*& cursor, const char* end, MetricPointView& view);
+
+    /// @brief Parse a string without escape sequences.
+    static bool scanString(const char*& cursor, const char* end, std::string_view& out);
+
+    /// @brief Skip one well-formed multi-byte UTF-8 sequence.
+    static bool scanUtf8Sequence(const char*& cursor, const char* end);
+
+    /// @brief Parse a JSON number.
+    static bool scanNumber(const char*& cursor, const char* end, double& out);
+
+    /// @brief Skip JSON whitespace.
+    static void skipWhitespace(const char*& cursor, const char* end);
+};
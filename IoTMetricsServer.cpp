@@ -1,19 +1,65 @@
 ﻿#include "IoTMetricsServer.h"
+#include "Logger.h"
+#include "BucketLocator.h"
+#include "ExponentialHistogram.h"
+#include "QuantileSketch.h"
 #include <opentelemetry/sdk/metrics/meter_provider.h>
 #include <opentelemetry/sdk/metrics/data/metric_data.h>
 #include <opentelemetry/sdk/metrics/data/point_data.h>
 #include <opentelemetry/exporters/prometheus/exporter_factory.h>
 #include <opentelemetry/exporters/prometheus/exporter_options.h>
 #include <opentelemetry/metrics/provider.h>
+#include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <cstdlib>
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <shared_mutex>
+#include <filesystem>
 #include <limits>
-#include <sstream>
+#include <charconv>
+#include <cstring>
+#include <cctype>
+#include <bitset>
+#include <string_view>
+#include <unordered_map>
 
 using json = nlohmann::json;
 
+/// @brief Source of IoTMetricsServer::instance_id_ values.
+static std::atomic<uint64_t> next_instance_id_{ 1 };
+
+const std::map<std::string, std::string> IoTMetricsServer::overflow_attributes_ = {
+    {"otel.metric.overflow", "true"}
+};
+
+const std::string IoTMetricsServer::overflow_metric_description_ =
+    "Writes to new metrics past the IOT_METRICS_MAX_METRICS limit";
+
+/**
+ * @brief Reads an unsigned integer from an environment variable.
+ * @param variable Variable name.
+ * @param value Set to the parsed value if the variable is set.
+ * @return False if the variable is unset or empty.
+ * @throws std::runtime_error if the value is not an unsigned integer.
+ */
+static bool readUnsignedEnv(const char* variable, uint64_t& value) {
+    const char* text = std::getenv(variable);
+    if (!text || !*text) {
+        return false;
+    }
+    const char* end = text + std::strlen(text);
+    uint64_t parsed = 0;
+    auto [ptr, ec] = std::from_chars(text, end, parsed);
+    if (ec != std::errc() || ptr != end) {
+        throw std::runtime_error(std::string(variable) + " must be a non-negative integer, got: " + text);
+    }
+    value = parsed;
+    return true;
+}
+
 namespace metrics_api = opentelemetry::metrics;
 namespace metrics_sdk = opentelemetry::sdk::metrics;
 
@@ -25,13 +71,22 @@ namespace metrics_sdk = opentelemetry::sdk::metrics;
  * @brief Constructs a new IoTMetricsServer object.
  * @param port The port for the main API server.
  * @param metrics_port The port for the Prometheus metrics endpoint.
+ * @param binary_port The TCP port for binary frame ingestion (0 disables it).
+ * @param statsd_port The UDP port for StatsD line ingestion (0 disables it).
  */
-IoTMetricsServer::IoTMetricsServer(int port, int metrics_port)
+IoTMetricsServer::IoTMetricsServer(int port, int metrics_port, int binary_port, int statsd_port)
     : port_(port)
     , metrics_port_(metrics_port)
+    , binary_port_(binary_port)
+    , statsd_port_(statsd_port)
     , server_running_(false)
+    , instance_id_(next_instance_id_++)
 {
     http_server_ = std::make_unique<httplib::Server>();
+    loadHistogramViews();
+    loadCardinalityLimits();
+    loadSeriesTtls();
+    loadPersistence();
     initializeMetrics();
     setupRoutes();
 }
@@ -41,17 +96,159 @@ IoTMetricsServer::IoTMetricsServer(int port, int metrics_port)
  */
 IoTMetricsServer::~IoTMetricsServer() {
     stop();
+    releaseSlots();
 }
 
 //==============================================================================
 // INITIALIZATION METHODS
 //==============================================================================
 
+/**
+ * @brief Loads per-metric histogram boundaries and summary quantiles (views) from a JSON file.
+ *
+ * The file is named by IOT_METRICS_HISTOGRAM_VIEWS and has the form
+ * {"histograms": {"metric_name": [boundary, ...], ...},
+ *  "summaries": {"metric_name": [quantile, ...], ...}}; either section may be
+ * omitted. Without the variable every histogram starts with the default
+ * boundaries unless its first submission carries its own, and every summary
+ * reports the default quantiles.
+ * @throws std::runtime_error if the file cannot be read or is invalid.
+ */
+void IoTMetricsServer::loadHistogramViews() {
+    const char* path = std::getenv("IOT_METRICS_HISTOGRAM_VIEWS");
+    if (!path || !*path) {
+        return;
+    }
+
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot open histogram views file: " + std::string(path));
+    }
+
+    json views;
+    try {
+        views = json::parse(file);
+    }
+    catch (const json::parse_error& e) {
+        throw std::runtime_error("Invalid histogram views file " + std::string(path) + ": " + e.what());
+    }
+    const bool has_histograms = views.is_object() && views.contains("histograms");
+    const bool has_summaries = views.is_object() && views.contains("summaries");
+    if ((!has_histograms && !has_summaries) ||
+        (has_histograms && !views["histograms"].is_object()) ||
+        (has_summaries && !views["summaries"].is_object())) {
+        throw std::runtime_error("Histogram views file " + std::string(path) +
+            " must contain a \"histograms\" or \"summaries\" object");
+    }
+    const json none = json::object();
+    const json& histograms = has_histograms ? views["histograms"] : none;
+    const json& summaries = has_summaries ? views["summaries"] : none;
+
+    for (const auto& [name, entry] : histograms.items()) {
+        std::vector<double> boundaries;
+        std::string error_msg;
+        if (!entry.is_array()) {
+            error_msg = "boundaries must be an array of numbers";
+        }
+        else {
+            for (const auto& boundary : entry) {
+                if (!boundary.is_number()) {
+                    error_msg = "boundaries must be an array of numbers";
+                    break;
+                }
+                boundaries.push_back(boundary.get<double>());
+            }
+        }
+        if (error_msg.empty()) {
+            validateBoundaries("histogram", boundaries, error_msg);
+        }
+        if (!error_msg.empty()) {
+            throw std::runtime_error("Histogram view for " + name + ": " + error_msg);
+        }
+        histogram_views_[name] = std::move(boundaries);
+    }
+
+    for (const auto& [name, entry] : summaries.items()) {
+        std::vector<double> quantiles;
+        bool valid = entry.is_array() && !entry.empty() && entry.size() <= max_summary_quantiles_;
+        for (size_t i = 0; valid && i < entry.size(); ++i) {
+            valid = entry[i].is_number();
+            if (valid) {
+                const double quantile = entry[i].get<double>();
+                valid = quantile >= 0.0 && quantile <= 1.0 && (quantiles.empty() || quantile > quantiles.back());
+                quantiles.push_back(quantile);
+            }
+        }
+        if (!valid) {
+            throw std::runtime_error("Summary view for " + name + ": quantiles must be between 1 and " +
+                std::to_string(max_summary_quantiles_) + " strictly increasing numbers in [0, 1]");
+        }
+        summary_views_[name] = std::move(quantiles);
+    }
+    LOG_INFO("Loaded %zu histogram views and %zu summary views from %s",
+        histogram_views_.size(), summary_views_.size(), path);
+}
+
+/**
+ * @brief Reads the series limits from the environment.
+ *
+ * IOT_METRICS_MAX_SERIES_PER_METRIC caps the series of each metric,
+ * IOT_METRICS_MAX_SERIES caps the store as a whole and IOT_METRICS_MAX_METRICS
+ * caps the number of metric names; unset variables keep the defaults.
+ * @throws std::runtime_error if a value is not a positive integer.
+ */
+void IoTMetricsServer::loadCardinalityLimits() {
+    auto read_limit = [](const char* variable, size_t& limit) {
+        uint64_t parsed = 0;
+        if (!readUnsignedEnv(variable, parsed)) {
+            return;
+        }
+        if (parsed == 0) {
+            throw std::runtime_error(std::string(variable) + " must be a positive integer");
+        }
+        limit = static_cast<size_t>(parsed);
+    };
+    read_limit("IOT_METRICS_MAX_SERIES_PER_METRIC", max_series_per_metric_);
+    read_limit("IOT_METRICS_MAX_SERIES", max_series_);
+    read_limit("IOT_METRICS_MAX_METRICS", max_metrics_);
+    LOG_INFO("Series limits: %zu per metric, %zu in total, %zu metrics", max_series_per_metric_, max_series_,
+        max_metrics_);
+}
+
+/**
+ * @brief Reads the series TTLs from the environment.
+ *
+ * IOT_METRICS_SERIES_TTL sets the TTL in seconds for every instrument type and
+ * IOT_METRICS_SERIES_TTL_COUNTER, _UPDOWNCOUNTER, _HISTOGRAM,
+ * _EXPONENTIAL_HISTOGRAM, _SUMMARY and _GAUGE override it per type. 0 (the
+ * default) keeps series forever.
+ * @throws std::runtime_error if a value is not a non-negative integer.
+ */
+void IoTMetricsServer::loadSeriesTtls() {
+    static const char* const variables[family_kind_count_] = {
+        "IOT_METRICS_SERIES_TTL_COUNTER",
+        "IOT_METRICS_SERIES_TTL_UPDOWNCOUNTER",
+        "IOT_METRICS_SERIES_TTL_HISTOGRAM",
+        "IOT_METRICS_SERIES_TTL_EXPONENTIAL_HISTOGRAM",
+        "IOT_METRICS_SERIES_TTL_SUMMARY",
+        "IOT_METRICS_SERIES_TTL_GAUGE"
+    };
+
+    uint64_t ttl = 0;
+    readUnsignedEnv("IOT_METRICS_SERIES_TTL", ttl);
+    for (size_t kind = 0; kind < family_kind_count_; ++kind) {
+        uint64_t kind_ttl = ttl;
+        readUnsignedEnv(variables[kind], kind_ttl);
+        series_ttl_seconds_[kind] = static_cast<int64_t>(std::min<uint64_t>(kind_ttl, std::numeric_limits<int32_t>::max()));
+    }
+    clock_seconds_.store(steadySeconds(), std::memory_order_relaxed);
+}
+
 /**
  * @brief Initializes the OpenTelemetry metrics system and Prometheus exporter.
  */
 void IoTMetricsServer::initializeMetrics() {
-    std::cout << "Initializing Custom OpenTelemetry metrics system..." << std::endl;
+    LOG_INFO("Initializing Custom OpenTelemetry metrics system...");
 
     // Note: We're keeping the OpenTelemetry setup for compatibility but using custom export
     // Create Prometheus exporter with options (for potential future use)
@@ -61,7 +258,7 @@ void IoTMetricsServer::initializeMetrics() {
     // Create the Prometheus exporter using factory
     auto prometheus_exporter = opentelemetry::exporter::metrics::PrometheusExporterFactory::Create(options);
 
-    std::cout << "Created Prometheus exporter on port " << metrics_port_ << std::endl;
+    LOG_INFO("Created Prometheus exporter on port %d", metrics_port_);
 
     // Create MeterProvider
     auto provider = std::shared_ptr<metrics_api::MeterProvider>(
@@ -72,16 +269,17 @@ void IoTMetricsServer::initializeMetrics() {
     auto p = std::static_pointer_cast<metrics_sdk::MeterProvider>(provider);
     p->AddMetricReader(std::move(prometheus_exporter));
 
-    std::cout << "MeterProvider created and MetricReader added" << std::endl;
+    LOG_INFO("MeterProvider created and MetricReader added");
 
     // Set the global meter provider
     metrics_api::Provider::SetMeterProvider(provider);
     meter_provider_ = provider;
 
-    std::cout << "Global MeterProvider set" << std::endl;
-    std::cout << "Custom Prometheus metrics available at: http://<your-server-ip>:" << port_ << "/metrics" << std::endl;
-    std::cout << "Standard Prometheus metrics also available at: http://<your-server-ip>:" << metrics_port_ << "/metrics" << std::endl;
-    std::cout << "Supported OpenTelemetry instruments: Counter, UpDownCounter, Histogram, Gauge" << std::endl;
+    LOG_INFO("Global MeterProvider set");
+    LOG_INFO("Custom Prometheus metrics available at: http://<your-server-ip>:%d/metrics", port_);
+    LOG_INFO("Standard Prometheus metrics also available at: http://<your-server-ip>:%d/metrics", metrics_port_);
+    LOG_INFO("Supported OpenTelemetry instruments: Counter, UpDownCounter, Histogram, ExponentialHistogram, Summary, Gauge");
+    LOG_INFO("Histogram bucket kernel: %s", BucketLocator::kernelName());
 }
 
 /**
@@ -106,6 +304,17 @@ void IoTMetricsServer::setupRoutes() {
         handleMetric(req, res);
     });
 
+    // Batch metric submission endpoint
+    http_server_->Post("/api/metrics/batch", [this](const httplib::Request& req, httplib::Response& res) {
+        handleMetricBatch(req, res);
+    });
+
+    // Streaming NDJSON submission endpoint (body is consumed chunk by chunk)
+    http_server_->Post("/api/metrics/stream", [this](const httplib::Request& req, httplib::Response& res,
+        const httplib::ContentReader& content_reader) {
+        handleMetricStream(req, res, content_reader);
+    });
+
     // Health check endpoint
     http_server_->Get("/health", [this](const httplib::Request& req, httplib::Response& res) {
         handleHealth(req, res);
@@ -133,7 +342,7 @@ void IoTMetricsServer::setupRoutes() {
         response["metrics_url"] = "http://<your-server-ip>:" + std::to_string(port_) + "/metrics";
         response["standard_metrics_url"] = "http://<your-server-ip>:" + std::to_string(metrics_port_) + "/metrics";
         response["opentelemetry_instruments"] = {
-            "counter", "updowncounter", "histogram"
+            "counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge"
         };
         res.set_content(response.dump(2), "application/json");
     });
@@ -148,17 +357,20 @@ void IoTMetricsServer::setupRoutes() {
  * @return true if the server started successfully, false otherwise.
  */
 bool IoTMetricsServer::start() {
-    if (server_running_) {
-        std::cout << "Server is already running" << std::endl;
+    if (server_running_.exchange(true)) {
+        LOG_WARN("Server is already running");
         return false;
     }
 
-    std::cout << "Starting OpenTelemetry-compliant IoT Metrics API server..." << std::endl;
-    std::cout << "API server: http://<your-server-ip>:" << port_ << std::endl;
-    std::cout << "Custom Prometheus metrics: http://<your-server-ip>:" << port_ << "/metrics" << std::endl;
-    std::cout << "Standard Prometheus metrics: http://<your-server-ip>:" << metrics_port_ << "/metrics" << std::endl;
-    std::cout << "Health check: http://<your-server-ip>:" << port_ << "/health" << std::endl;
-    std::cout << "Instruments list: http://<your-server-ip>:" << port_ << "/api/metrics/list" << std::endl;
+    LOG_INFO("Starting OpenTelemetry-compliant IoT Metrics API server...");
+    LOG_INFO("API server: http://<your-server-ip>:%d", port_);
+    LOG_INFO("Custom Prometheus metrics: http://<your-server-ip>:%d/metrics", port_);
+    LOG_INFO("Standard Prometheus metrics: http://<your-server-ip>:%d/metrics", metrics_port_);
+    LOG_INFO("Health check: http://<your-server-ip>:%d/health", port_);
+    LOG_INFO("Instruments list: http://<your-server-ip>:%d/api/metrics/list", port_);
+
+    // Usage examples are printed verbatim (no level prefix) after the queued log lines
+    Logger::instance().flush();
     std::cout << "" << std::endl;
     std::cout << "OpenTelemetry Synchronous Instruments Examples:" << std::endl;
     std::cout << "" << std::endl;
@@ -178,865 +390,4847 @@ bool IoTMetricsServer::start() {
     std::cout << "  -d '{\"metric_name\":\"response_time\",\"instrument_type\":\"histogram\",\"value\":0.234,\"unit\":\"s\",\"attributes\":{\"endpoint\":\"/api/data\"}}'" << std::endl;
     std::cout << "" << std::endl;
 
-    server_running_ = true;
+    // Side listeners, the sweeper and the snapshotter run on their own threads next to the HTTP server
+    {
+        std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+        listeners_running_ = true;
+        if (!startBinaryListener() || !startStatsdListener()) {
+            listeners_running_ = false;
+            stopBinaryListener();
+            stopStatsdListener();
+            server_running_ = false;
+            return false;
+        }
+        startSweeper();
+        startSnapshotter();
+    }
 
     // Start server (this is blocking)
     bool success = http_server_->listen("0.0.0.0", port_);
 
     server_running_ = false;
+    stopServices();
     return success;
 }
 
 /**
  * @brief Stops the HTTP server if running.
+ *
+ * May be called from any thread while start() blocks; teardown of the side
+ * threads is shared with start()'s return path (see stopServices()).
  */
 void IoTMetricsServer::stop() {
-    if (server_running_) {
-        std::cout << "Stopping OpenTelemetry IoT Metrics API server..." << std::endl;
+    if (server_running_.exchange(false)) {
+        LOG_INFO("Stopping OpenTelemetry IoT Metrics API server...");
         http_server_->stop();
-        server_running_ = false;
     }
+    stopServices();
+}
+
+/**
+ * @brief Stops the side listeners, the sweeper and the snapshotter.
+ *
+ * Runs under lifecycle_mutex_, so when stop() races start()'s return path
+ * one caller joins every thread and takes the final snapshot, and the other
+ * finds them already joined.
+ */
+void IoTMetricsServer::stopServices() {
+    std::lock_guard<std::mutex> lock(lifecycle_mutex_);
+    listeners_running_ = false;
+    stopBinaryListener();
+    stopStatsdListener();
+    stopSweeper();
+    stopSnapshotter();
 }
 
 //==============================================================================
-// HTTP ENDPOINT HANDLERS
+// SERIES EXPIRY
 //==============================================================================
 
 /**
- * @brief Handles metric submission requests to /api/metrics.
- * @param req The HTTP request.
- * @param res The HTTP response.
+ * @brief Returns the steady-clock time in whole seconds.
  */
-void IoTMetricsServer::handleMetric(const httplib::Request& req, httplib::Response& res) {
-    try {
-        // Parse JSON body
-        json request_data = json::parse(req.body);
-
-        // Validate the request against OpenTelemetry standards
-        std::string error_msg;
-        if (!validateMetricRequest(request_data, error_msg)) {
-            res.status = 400;
-            res.set_content(createErrorResponse(error_msg).dump(2), "application/json");
-            return;
-        }
-
-        // Extract metric data
-        std::string metric_name = request_data["metric_name"];
-        std::string instrument_type = request_data["instrument_type"];
-        double value = request_data["value"];
-        std::string unit = request_data.value("unit", "");
-        std::string description = request_data.value("description", "");
-
-        // Extract attributes/labels
-        std::map<std::string, std::string> attributes;
-        if (request_data.contains("attributes")) {
-            for (auto& [key, val] : request_data["attributes"].items()) {
-                attributes[key] = val.get<std::string>();
-            }
-        }
-
-        // Record the metric using proper OpenTelemetry instrument
-        recordMetric(metric_name, instrument_type, value, attributes, unit, description);
-
-        // Log the measurement
-        std::cout << "OpenTelemetry metric recorded: " << metric_name
-            << " (" << instrument_type << ") = " << value;
-        if (!unit.empty()) std::cout << " " << unit;
-        std::cout << std::endl;
-
-        // Create success response
-        json response = createSuccessResponse("OpenTelemetry metric recorded successfully");
-        response["data"] = {
-            {"metric_name", metric_name},
-            {"instrument_type", instrument_type},
-            {"value", value},
-            {"unit", unit},
-            {"attributes", attributes},
-            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
-                std::chrono::system_clock::now().time_since_epoch()).count()}
-        };
-
-        res.set_content(response.dump(2), "application/json");
+int64_t IoTMetricsServer::steadySeconds() {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
 
+/**
+ * @brief Starts the sweeper thread if any instrument type has a TTL.
+ */
+void IoTMetricsServer::startSweeper() {
+    const bool enabled = std::any_of(series_ttl_seconds_.begin(), series_ttl_seconds_.end(),
+        [](int64_t ttl) { return ttl > 0; });
+    if (!enabled || sweeper_thread_.joinable()) {
+        return;
     }
-    catch (const json::parse_error& e) {
-        res.status = 400;
-        res.set_content(createErrorResponse("Invalid JSON: " + std::string(e.what())).dump(2), "application/json");
-    }
-    catch (const json::type_error& e) {
-        res.status = 400;
-        res.set_content(createErrorResponse("Invalid data type: " + std::string(e.what())).dump(2), "application/json");
-    }
-    catch (const std::exception& e) {
-        res.status = 500;
-        res.set_content(createErrorResponse("Internal server error: " + std::string(e.what())).dump(2), "application/json");
-    }
+    sweeper_thread_ = std::thread(&IoTMetricsServer::runSweeper, this);
+    LOG_INFO("Series TTL sweeper started (%zu shards every %lld ms)", sweep_shards_per_tick_,
+        static_cast<long long>(sweep_interval_.count()));
 }
 
 /**
- * @brief Handles health check requests to /health.
- * @param req The HTTP request.
- * @param res The HTTP response.
+ * @brief Joins the sweeper thread (it exits once listeners_running_ is cleared).
  */
-void IoTMetricsServer::handleHealth(const httplib::Request& req, httplib::Response& res) {
-    json response;
-    response["status"] = "healthy";
-    response["server"] = "OpenTelemetry IoT Metrics API";
-    response["version"] = "1.0.0";
-    response["opentelemetry"] = "enabled";
-    response["supported_instruments"] = { "counter", "updowncounter", "histogram" };
-    response["metrics_port"] = metrics_port_;
-    response["custom_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(port_) + "/metrics";
-    response["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-
-    res.set_content(response.dump(2), "application/json");
+void IoTMetricsServer::stopSweeper() {
+    if (sweeper_thread_.joinable()) {
+        sweeper_thread_.join();
+    }
 }
 
 /**
- * @brief Handles status requests to /api/status.
- * @param req The HTTP request.
- * @param res The HTTP response.
+ * @brief Sweeper loop.
+ *
+ * Each tick advances clock_seconds_ and sweeps the next sweep_shards_per_tick_
+ * shards, so a full pass over the store takes
+ * metric_shard_count_ / sweep_shards_per_tick_ ticks and no shard is held for
+ * longer than one eviction pass over its own families.
  */
-void IoTMetricsServer::handleStatus(const httplib::Request& req, httplib::Response& res) {
-    std::lock_guard<std::mutex> lock(instruments_mutex_);
-
-    json response;
-    response["status"] = "running";
-    response["api_port"] = port_;
-    response["metrics_port"] = metrics_port_;
-    response["custom_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(port_) + "/metrics";
-    response["standard_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(metrics_port_) + "/metrics";
-    response["opentelemetry"] = {
-        {"meter_provider", "active"},
-        {"prometheus_exporter", "active"},
-        {"custom_exporter", "active"},
-        {"meter_name", "iot_metrics_api"},
-        {"meter_version", "1.0.0"},
-        {"standard", "OpenTelemetry"}
-    };
-    response["registered_instruments"] = {
-        {"counters", counter_metrics_.size()},
-        {"updowncounters", updowncounter_metrics_.size()},
-        {"histograms", histogram_metrics_.size()},
-        {"gauges", gauge_metrics_.size()}
-    };
-    response["endpoints"] = {
-        {"submit_metric", "POST /api/metrics"},
-        {"list_metrics", "GET /api/metrics/list"},
-        {"custom_prometheus_metrics", "GET /metrics"},
-        {"health", "GET /health"},
-        {"status", "GET /api/status"},
-        {"metrics_info", "GET /metrics/info"}
-    };
-
-    res.set_content(response.dump(2), "application/json");
+void IoTMetricsServer::runSweeper() {
+    while (listeners_running_) {
+        std::this_thread::sleep_for(sweep_interval_);
+        clock_seconds_.store(steadySeconds(), std::memory_order_relaxed);
+        sweepShards(sweep_shards_per_tick_);
+    }
 }
 
 /**
- * @brief Handles requests to list all registered metrics at /api/metrics/list.
- * @param req The HTTP request.
- * @param res The HTTP response.
+ * @brief Evicts stale series from the next count shards.
+ *
+ * Counter and updowncounter series are stamped by lock-free writers, so they
+ * are marked retired before the last re-check of their timestamp; a writer
+ * that got in first keeps the series alive, and one that sees the mark
+ * re-records its value under the shard lock (see recordSumValue). An evicted
+ * series' value slot is retired, so a restart does not bring it back. Its
+ * interned label strings stay in label_pool_, which never frees.
+ * @param count Number of shards to examine.
+ * @return Number of series evicted.
  */
-void IoTMetricsServer::handleMetricsList(const httplib::Request& req, httplib::Response& res) {
-    std::lock_guard<std::mutex> lock(instruments_mutex_);
-
-    json response;
-    response["opentelemetry_standard"] = true;
-
-    json instruments_list;
-
-    auto now = std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count();
-
-    // Helper lambda to extract value from SumPointData
-    auto extract_sum_value = [](const metrics_sdk::MetricData* metric_data) -> double {
-        if (metric_data && !metric_data->point_data_attr_.empty()) {
-            const auto& point_data_attr = metric_data->point_data_attr_.front();
-            const auto* sum_point = std::get_if<metrics_sdk::SumPointData>(&point_data_attr.point_data);
-            if (sum_point) {
-                double val = 0.0;
-                std::visit([&val](const auto& v) { val = static_cast<double>(v); }, sum_point->value_);
-                return val;
+size_t IoTMetricsServer::sweepShards(size_t count) {
+    const int64_t now = clock_seconds_.load(std::memory_order_relaxed);
+    auto cutoff = [&](size_t kind) { return now - series_ttl_seconds_[kind]; };
+    auto stale_entry = [](int64_t kind_cutoff) {
+        return [kind_cutoff](const auto& entry) { return entry.updated_at < kind_cutoff; };
+    };
+    auto stale_sum = [](int64_t kind_cutoff) {
+        return [kind_cutoff](const auto& entry) {
+            SumSeries& series = *entry.value;
+            if (series.last_update.load(std::memory_order_relaxed) >= kind_cutoff) {
+                return false;
             }
-        }
-        return 0.0;
+            series.retired.store(true);
+            if (series.last_update.load() >= kind_cutoff) {
+                series.retired.store(false);
+                return false;
+            }
+            // Writers only touch the cells, so the slot can be freed now rather than when the
+            // last thread holding the series in its cache lets go of it
+            if (series.slot) {
+                series.slot.retire();
+                series.slot = SlotStore::Handle();
+            }
+            return true;
+        };
     };
-
-    // Helper lambda for histogram
-    auto extract_histogram = [](const metrics_sdk::MetricData* metric_data, json& j) {
-        if (metric_data && !metric_data->point_data_attr_.empty()) {
-            const auto& point_data_attr = metric_data->point_data_attr_.front();
-            const auto* hist_point = std::get_if<metrics_sdk::HistogramPointData>(&point_data_attr.point_data);
-            if (hist_point) {
-                double sum = 0.0;
-                std::visit([&sum](const auto& v) { sum = static_cast<double>(v); }, hist_point->sum_);
-                j["value"] = sum;
-                j["count"] = hist_point->count_;
+    auto stale_gauge = [](int64_t kind_cutoff) {
+        return [kind_cutoff](const auto& entry) {
+            if (entry.updated_at >= kind_cutoff) {
+                return false;
             }
-        }
+            if (entry.value.slot) {
+                entry.value.slot.retire();
+            }
+            return true;
+        };
     };
 
-    // List Counters
-    for (const auto& [name, metric_data_ptr] : counter_metrics_) {
-        if (metric_data_ptr) {
-            json j = {
-                {"instrument_type", "counter"},
-                {"description", metric_data_ptr->instrument_descriptor.description_},
-                {"unit", metric_data_ptr->instrument_descriptor.unit_},
-                {"semantic", "monotonically_increasing"},
-                {"timestamp", now},
-                {"value", extract_sum_value(metric_data_ptr.get())}
-            };
-            instruments_list[name] = j;
+    size_t evicted = 0;
+    for (size_t i = 0; i < count && i < shards_.size(); ++i) {
+        MetricShard& shard = shards_[sweep_cursor_];
+        sweep_cursor_ = (sweep_cursor_ + 1) % shards_.size();
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size_t sums = 0;
+        if (series_ttl_seconds_[0] > 0) sums += evictSeries(shard.counter_families, stale_sum(cutoff(0)));
+        if (series_ttl_seconds_[1] > 0) sums += evictSeries(shard.updowncounter_families, stale_sum(cutoff(1)));
+        if (sums > 0) {
+            sum_eviction_generation_.fetch_add(1, std::memory_order_relaxed);
+            evicted += sums;
         }
+        if (series_ttl_seconds_[2] > 0) evicted += evictSeries(shard.histogram_families, stale_entry(cutoff(2)));
+        if (series_ttl_seconds_[3] > 0) evicted += evictSeries(shard.exponential_histogram_families, stale_entry(cutoff(3)));
+        if (series_ttl_seconds_[4] > 0) evicted += evictSeries(shard.summary_families, stale_entry(cutoff(4)));
+        if (series_ttl_seconds_[5] > 0) evicted += evictSeries(shard.gauge_families, stale_gauge(cutoff(5)));
     }
 
-    // List UpDownCounters
-    for (const auto& [name, metric_data_ptr] : updowncounter_metrics_) {
-        if (metric_data_ptr) {
-            json j = {
-                {"instrument_type", "updowncounter"},
-                {"description", metric_data_ptr->instrument_descriptor.description_},
-                {"unit", metric_data_ptr->instrument_descriptor.unit_},
-                {"semantic", "accumulates_can_increase_decrease"},
-                {"timestamp", now},
-                {"value", extract_sum_value(metric_data_ptr.get())}
-            };
-            instruments_list[name] = j;
-        }
+    if (evicted > 0) {
+        series_count_.fetch_sub(evicted, std::memory_order_relaxed);
+        series_evicted_.fetch_add(evicted, std::memory_order_relaxed);
+        LOG_DEBUG("Evicted %zu stale series", evicted);
     }
+    return evicted;
+}
 
-    // List Histograms
-    for (const auto& [name, metric_data_ptr] : histogram_metrics_) {
-        if (metric_data_ptr) {
-            json j = {
-                {"instrument_type", "histogram"},
-                {"description", metric_data_ptr->instrument_descriptor.description_},
-                {"unit", metric_data_ptr->instrument_descriptor.unit_},
-                {"semantic", "value_distribution"},
-                {"timestamp", now}
-            };
-            extract_histogram(metric_data_ptr.get(), j);
-            instruments_list[name] = j;
+/**
+ * @brief Evicts the selected series from every family of one kind.
+ *
+ * A family that lost series has its render cache dropped (it is parallel to
+ * the series table and is rebuilt on the next scrape); a family left without
+ * series is removed, so it disappears from /metrics and /api/metrics/list.
+ * @note Caller must hold the families' shard mutex.
+ * @param families Families of one kind.
+ * @param is_stale Predicate called with each series entry.
+ * @return Number of series evicted.
+ */
+template <typename Family, typename IsStale>
+size_t IoTMetricsServer::evictSeries(std::map<std::string, Family>& families, IsStale&& is_stale) {
+    size_t evicted = 0;
+    for (auto it = families.begin(); it != families.end();) {
+        Family& family = it->second;
+        const size_t removed = family.series.eraseIf(is_stale);
+        if (removed > 0) {
+            family.render.series.clear();
+            evicted += removed;
         }
-    }
-
-    // List Gauges
-    for (const auto& [name, metric_data_ptr] : gauge_metrics_) {
-        if (metric_data_ptr) {
-            json j = {
-                {"instrument_type", "gauge"},
-                {"description", metric_data_ptr->instrument_descriptor.description_},
-                {"unit", metric_data_ptr->instrument_descriptor.unit_},
-                {"semantic", "absolute_value"},
-                {"timestamp", now},
-                {"value", extract_sum_value(metric_data_ptr.get())}
-            };
-            instruments_list[name] = j;
+        if (family.series.empty()) {
+            it = families.erase(it);
+            family_count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+        else {
+            ++it;
         }
     }
-
-    response["instruments"] = instruments_list;
-    response["total_instruments"] = instruments_list.size();
-    res.set_content(response.dump(2), "application/json");
+    return evicted;
 }
 
 //==============================================================================
-// CUSTOM PROMETHEUS EXPORT METHODS
+// BINARY INGESTION LISTENER
 //==============================================================================
 
+#ifdef _WIN32
+static void closeSocket(socket_t sock) { closesocket(sock); }
+#else
+static void closeSocket(socket_t sock) { close(sock); }
+#endif
+
 /**
- * @brief Handles requests to the custom Prometheus metrics endpoint (/metrics).
- * @param req The HTTP request.
- * @param res The HTTP response.
+ * @brief Waits until a socket is readable or the timeout expires.
+ * @param sock Socket to wait on.
+ * @param timeout_ms Timeout in milliseconds.
+ * @return true if the socket is readable.
  */
-void IoTMetricsServer::handlePrometheusMetrics(const httplib::Request& req, httplib::Response& res) {
-    try {
-        std::string prometheus_output = formatPrometheusMetrics();
-        res.set_header("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
-        res.set_content(prometheus_output, "text/plain");
-
-        std::cout << "Served Custom Prometheus metrics (" << prometheus_output.length() << " bytes)" << std::endl;
-    }
-    catch (const std::exception& e) {
-        res.status = 500;
-        res.set_content("Error generating metrics: " + std::string(e.what()), "text/plain");
-    }
+static bool waitReadable(socket_t sock, int timeout_ms) {
+#ifdef _WIN32
+    fd_set read_set;
+    FD_ZERO(&read_set);
+    FD_SET(sock, &read_set);
+    timeval timeout{ timeout_ms / 1000, (timeout_ms % 1000) * 1000 };
+    return select(0, &read_set, nullptr, nullptr, &timeout) > 0;
+#else
+    pollfd poll_fd{ sock, POLLIN, 0 };
+    return poll(&poll_fd, 1, timeout_ms) > 0;
+#endif
 }
 
 /**
- * @brief Formats all metrics for Prometheus exposition.
- * @return Formatted Prometheus metrics as a string.
+ * @brief Reads an unsigned LEB128 varint.
+ * @param cursor Read position, advanced past the varint on success.
+ * @param end End of the readable range.
+ * @param value Output value.
+ * @return true if a complete varint was read.
  */
-std::string IoTMetricsServer::formatPrometheusMetrics() {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-
-    std::ostringstream output;
-
-    // Add server info as comments
-    output << "# OpenTelemetry IoT Metrics API - Custom Export\n";
-    output << "# Server: http://<your-server-ip>:" << port_ << "\n";
-    output << "# Generated: " << std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::system_clock::now().time_since_epoch()).count() << "\n\n";
-
-    // Export Counters
-    for (const auto& [name, metric_data_ptr] : counter_metrics_) {
-        if (metric_data_ptr) {
-            output << formatCounterForPrometheus(name, *metric_data_ptr);
+static bool readVarint(const uint8_t*& cursor, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && cursor < end; shift += 7) {
+        uint8_t byte = *cursor++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
         }
     }
+    return false;
+}
 
-    // Export UpDownCounters
-    for (const auto& [name, metric_data_ptr] : updowncounter_metrics_) {
-        if (metric_data_ptr) {
-            output << formatUpDownCounterForPrometheus(name, *metric_data_ptr);
-        }
+/**
+ * @brief Reads a varint length-prefixed string.
+ * @param cursor Read position, advanced past the string on success.
+ * @param end End of the readable range.
+ * @param value Output string.
+ * @return true if a complete string was read.
+ */
+static bool readLengthPrefixedString(const uint8_t*& cursor, const uint8_t* end, std::string& value) {
+    uint64_t length = 0;
+    if (!readVarint(cursor, end, length) || length > static_cast<uint64_t>(end - cursor)) {
+        return false;
     }
+    value.assign(reinterpret_cast<const char*>(cursor), static_cast<size_t>(length));
+    cursor += length;
+    return true;
+}
 
-    // Export Histograms
-    for (const auto& [name, metric_data_ptr] : histogram_metrics_) {
-        if (metric_data_ptr) {
-            output << formatHistogramForPrometheus(name, *metric_data_ptr);
-        }
+/**
+ * @brief Reads a little-endian IEEE 754 double.
+ * @param cursor Read position, advanced past the value on success.
+ * @param end End of the readable range.
+ * @param value Output value.
+ * @return true if 8 bytes were available.
+ */
+static bool readFixedDouble(const uint8_t*& cursor, const uint8_t* end, double& value) {
+    if (end - cursor < 8) {
+        return false;
     }
-
-    // Export Gauges
-    for (const auto& [name, metric_data_ptr] : gauge_metrics_) {
-        if (metric_data_ptr) {
-            output << formatGaugeForPrometheus(name, *metric_data_ptr);
-        }
+    uint64_t bits = 0;
+    for (int i = 7; i >= 0; --i) {
+        bits = (bits << 8) | cursor[i];
     }
-    return output.str();
+    std::memcpy(&value, &bits, sizeof(value));
+    cursor += 8;
+    return true;
 }
 
 /**
- * @brief Formats a Counter metric for Prometheus.
- * @param name Metric name.
- * @param metric_data Metric data.
- * @return Prometheus-formatted string.
+ * @brief Appends a double as 8 little-endian bytes.
  */
-std::string IoTMetricsServer::formatCounterForPrometheus(const std::string& name,
-    const metrics_sdk::MetricData& metric_data) {
+static void appendFixedDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i) {
+        out.push_back(static_cast<char>(bits >> (8 * i)));
+    }
+}
 
-    std::ostringstream output;
-    std::string sanitized_name = sanitizeMetricName(name);
+/**
+ * @brief Appends a varint length-prefixed string.
+ */
+static void appendLengthPrefixedString(std::string& out, std::string_view value) {
+    ProtoWriter::writeVarint(out, value.size());
+    out.append(value.data(), value.size());
+}
 
-    // HELP comment
-    if (!metric_data.instrument_descriptor.description_.empty()) {
-        output << "# HELP " << sanitized_name << " " << metric_data.instrument_descriptor.description_ << "\n";
+/**
+ * @brief Opens the binary ingestion socket and starts the accept thread.
+ * @return true if listening (or disabled), false if the socket could not be bound.
+ */
+bool IoTMetricsServer::startBinaryListener() {
+    if (binary_port_ <= 0) {
+        return true;
     }
 
-    // TYPE comment
-    output << "# TYPE " << sanitized_name << " counter\n";
+    binary_listen_socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (binary_listen_socket_ == INVALID_SOCKET) {
+        LOG_ERROR("Failed to create binary ingestion socket");
+        return false;
+    }
 
-    // Metric data
-    for (const auto& point_data_attr : metric_data.point_data_attr_) {
-        const auto* sum_point = std::get_if<metrics_sdk::SumPointData>(&point_data_attr.point_data);
-        if (sum_point) {
-            std::string attributes_str = formatAttributes(point_data_attr.attributes);
+    int reuse = 1;
+    setsockopt(binary_listen_socket_, SOL_SOCKET, SO_REUSEADDR,
+        reinterpret_cast<const char*>(&reuse), sizeof(reuse));
 
-            // Convert value variant to string safely
-            std::string value_str;
-            std::visit([&value_str](const auto& v) {
-                value_str = std::to_string(v);
-            }, sum_point->value_);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(binary_port_));
 
-            output << sanitized_name << attributes_str << " " << value_str << "\n";
+    if (bind(binary_listen_socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(binary_listen_socket_, SOMAXCONN) != 0) {
+        LOG_ERROR("Failed to bind binary ingestion listener on port %d", binary_port_);
+        closeSocket(binary_listen_socket_);
+        binary_listen_socket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    binary_accept_thread_ = std::thread(&IoTMetricsServer::runBinaryAcceptLoop, this);
+    LOG_INFO("Binary ingestion listener: tcp://<your-server-ip>:%d", binary_port_);
+    return true;
+}
+
+/**
+ * @brief Stops the binary ingestion listener and joins its connection threads.
+ */
+void IoTMetricsServer::stopBinaryListener() {
+    if (binary_accept_thread_.joinable()) {
+        binary_accept_thread_.join();
+    }
+    for (auto& connection : binary_connections_) {
+        if (connection->thread.joinable()) {
+            connection->thread.join();
+        }
+    }
+    binary_connections_.clear();
+
+    if (binary_listen_socket_ != INVALID_SOCKET) {
+        closeSocket(binary_listen_socket_);
+        binary_listen_socket_ = INVALID_SOCKET;
+    }
+}
+
+/**
+ * @brief Accept loop for the binary ingestion listener.
+ *
+ * Each connection is served by its own thread; finished connections are reaped
+ * on the next pass through the loop. Once max_binary_connections_ are open,
+ * new connections are closed straight away and counted as rejected.
+ */
+void IoTMetricsServer::runBinaryAcceptLoop() {
+    while (listeners_running_) {
+        // Reap connections whose threads have finished
+        for (auto it = binary_connections_.begin(); it != binary_connections_.end();) {
+            if ((*it)->done) {
+                (*it)->thread.join();
+                it = binary_connections_.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+
+        if (!waitReadable(binary_listen_socket_, 200)) {
+            continue;
+        }
+
+        socket_t client = accept(binary_listen_socket_, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        if (binary_connections_.size() >= max_binary_connections_) {
+            if (binary_connections_rejected_.fetch_add(1, std::memory_order_relaxed) == 0) {
+                LOG_WARN("Binary ingestion connection limit (%zu) reached; rejecting new connections",
+                    max_binary_connections_);
+            }
+            closeSocket(client);
+            continue;
+        }
+
+        auto connection = std::make_unique<BinaryConnection>();
+        BinaryConnection* raw_connection = connection.get();
+        connection->thread = std::thread([this, client, raw_connection]() {
+            serveBinaryConnection(client);
+            raw_connection->done = true;
+        });
+        binary_connections_.push_back(std::move(connection));
+    }
+}
+
+/**
+ * @brief Reads and records frames from one binary ingestion connection.
+ *
+ * Frames are a varint body length followed by the body. Every frame completed by
+ * a read is decoded, and the resulting points are recorded as one batch. A frame
+ * that fails validation is skipped; an oversized or malformed length closes the
+ * connection.
+ * @param client Connected client socket (closed on return).
+ */
+void IoTMetricsServer::serveBinaryConnection(socket_t client) {
+    const size_t read_size = 64 * 1024;
+    std::vector<uint8_t> buffer;
+    size_t buffered = 0;
+    std::vector<MetricPoint> points;
+    bool connection_ok = true;
+
+    while (listeners_running_ && connection_ok) {
+        if (!waitReadable(client, 200)) {
+            continue;
+        }
+
+        if (buffer.size() < buffered + read_size) {
+            buffer.resize(buffered + read_size);
+        }
+        auto received = recv(client, reinterpret_cast<char*>(buffer.data() + buffered),
+            static_cast<int>(read_size), 0);
+        if (received <= 0) {
+            break;
+        }
+        buffered += static_cast<size_t>(received);
+
+        // Decode every complete frame in the buffer
+        const uint8_t* cursor = buffer.data();
+        const uint8_t* end = buffer.data() + buffered;
+        while (cursor < end) {
+            const uint8_t* frame_start = cursor;
+            uint64_t frame_length = 0;
+            if (!readVarint(cursor, end, frame_length)) {
+                if (end - frame_start >= 10) {
+                    connection_ok = false;  // Over-long varint
+                }
+                cursor = frame_start;
+                break;
+            }
+            if (frame_length > max_binary_frame_length_) {
+                connection_ok = false;
+                break;
+            }
+            if (frame_length > static_cast<uint64_t>(end - cursor)) {
+                cursor = frame_start;  // Wait for the rest of the frame
+                break;
+            }
+
+            MetricPoint point;
+            std::string error_msg;
+            if (decodeBinaryFrame(cursor, static_cast<size_t>(frame_length), point, error_msg)) {
+                points.push_back(std::move(point));
+            }
+            else {
+                binary_frames_rejected_++;
+            }
+            cursor += frame_length;
+        }
+
+        if (!points.empty()) {
+            recordMetricBatch(points);
+            binary_frames_accepted_ += points.size();
+            points.clear();
+        }
+
+        // Keep only the incomplete tail for the next read
+        size_t consumed = static_cast<size_t>(cursor - buffer.data());
+        if (consumed > 0) {
+            std::memmove(buffer.data(), cursor, buffered - consumed);
+            buffered -= consumed;
+        }
+    }
+
+    if (!connection_ok) {
+        LOG_WARN("Closing binary ingestion connection: malformed frame length");
+    }
+    closeSocket(client);
+}
+
+/**
+ * @brief Decodes one binary frame body into a MetricPoint.
+ * @param data Frame body (without the length prefix).
+ * @param length Frame body length.
+ * @param point Output metric point if valid.
+ * @param error_msg Output error message if invalid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::decodeBinaryFrame(const uint8_t* data, size_t length, MetricPoint& point, std::string& error_msg) {
+    const uint8_t* cursor = data;
+    const uint8_t* end = data + length;
+
+    if (cursor >= end) {
+        error_msg = "Empty frame";
+        return false;
+    }
+
+    switch (static_cast<BinaryInstrumentKind>(*cursor++)) {
+    case BinaryInstrumentKind::Counter: point.instrument_type = "counter"; break;
+    case BinaryInstrumentKind::UpDownCounter: point.instrument_type = "updowncounter"; break;
+    case BinaryInstrumentKind::Histogram: point.instrument_type = "histogram"; break;
+    case BinaryInstrumentKind::Gauge: point.instrument_type = "gauge"; break;
+    case BinaryInstrumentKind::ExponentialHistogram: point.instrument_type = "exponential_histogram"; break;
+    case BinaryInstrumentKind::Summary: point.instrument_type = "summary"; break;
+    default:
+        error_msg = "Unknown instrument kind";
+        return false;
+    }
+
+    if (!readLengthPrefixedString(cursor, end, point.metric_name) || point.metric_name.empty()) {
+        error_msg = "Invalid metric name";
+        return false;
+    }
+
+    uint64_t attribute_count = 0;
+    if (!readVarint(cursor, end, attribute_count) || attribute_count > length) {
+        error_msg = "Invalid attribute count";
+        return false;
+    }
+    std::string key;
+    std::string val;
+    for (uint64_t i = 0; i < attribute_count; ++i) {
+        if (!readLengthPrefixedString(cursor, end, key) || !readLengthPrefixedString(cursor, end, val)) {
+            error_msg = "Truncated attributes";
+            return false;
+        }
+        point.attributes[key] = val;
+    }
+
+    if (!readFixedDouble(cursor, end, point.value)) {
+        error_msg = "Truncated value";
+        return false;
+    }
+
+    // Optional trailing unit and description
+    if (cursor < end && !readLengthPrefixedString(cursor, end, point.unit)) {
+        error_msg = "Truncated unit";
+        return false;
+    }
+    if (cursor < end && !readLengthPrefixedString(cursor, end, point.description)) {
+        error_msg = "Truncated description";
+        return false;
+    }
+
+    // Optional trailing histogram boundaries
+    if (cursor < end) {
+        uint64_t boundary_count = 0;
+        if (!readVarint(cursor, end, boundary_count) || boundary_count > static_cast<uint64_t>(end - cursor) / 8) {
+            error_msg = "Truncated boundaries";
+            return false;
+        }
+        point.boundaries.resize(static_cast<size_t>(boundary_count));
+        for (double& boundary : point.boundaries) {
+            readFixedDouble(cursor, end, boundary);
+        }
+        if (!validateBoundaries(point.instrument_type, point.boundaries, error_msg)) {
+            return false;
+        }
+    }
+
+    return validateMetricValue(point.instrument_type, point.value, error_msg);
+}
+
+/**
+ * @brief Appends a write as a varint length-prefixed binary frame.
+ *
+ * Unit and description are always written (possibly empty) so that boundaries,
+ * when present, land in their trailing position.
+ * @param out Buffer to append to.
+ * @param metric_name Name of the metric.
+ * @param instrument_type Type of instrument.
+ * @param value Value recorded.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @param boundaries Histogram bucket boundaries (omitted if empty).
+ */
+void IoTMetricsServer::appendBinaryFrame(std::string& out, const std::string& metric_name,
+    const std::string& instrument_type, double value, const std::map<std::string, std::string>& attributes,
+    const std::string& unit, const std::string& description, const std::vector<double>& boundaries) {
+    BinaryInstrumentKind kind = BinaryInstrumentKind::Gauge;
+    if (instrument_type == "counter") kind = BinaryInstrumentKind::Counter;
+    else if (instrument_type == "updowncounter") kind = BinaryInstrumentKind::UpDownCounter;
+    else if (instrument_type == "histogram") kind = BinaryInstrumentKind::Histogram;
+    else if (instrument_type == "exponential_histogram") kind = BinaryInstrumentKind::ExponentialHistogram;
+    else if (instrument_type == "summary") kind = BinaryInstrumentKind::Summary;
+
+    thread_local std::string body;
+    body.clear();
+    body.push_back(static_cast<char>(kind));
+    appendLengthPrefixedString(body, metric_name);
+    ProtoWriter::writeVarint(body, attributes.size());
+    for (const auto& [key, val] : attributes) {
+        appendLengthPrefixedString(body, key);
+        appendLengthPrefixedString(body, val);
+    }
+    appendFixedDouble(body, value);
+    appendLengthPrefixedString(body, unit);
+    appendLengthPrefixedString(body, description);
+    if (!boundaries.empty()) {
+        ProtoWriter::writeVarint(body, boundaries.size());
+        for (double boundary : boundaries) {
+            appendFixedDouble(body, boundary);
+        }
+    }
+
+    ProtoWriter::writeVarint(out, body.size());
+    out += body;
+}
+
+//==============================================================================
+// STATSD INGESTION LISTENER
+//==============================================================================
+
+/**
+ * @brief Opens the StatsD UDP socket and starts the receive thread.
+ * @return true if listening (or disabled), false if the socket could not be bound.
+ */
+bool IoTMetricsServer::startStatsdListener() {
+    if (statsd_port_ <= 0) {
+        return true;
+    }
+
+    statsd_socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (statsd_socket_ == INVALID_SOCKET) {
+        LOG_ERROR("Failed to create StatsD socket");
+        return false;
+    }
+
+    // A larger receive buffer absorbs bursts between batched reads
+    int receive_buffer = 4 * 1024 * 1024;
+    setsockopt(statsd_socket_, SOL_SOCKET, SO_RCVBUF,
+        reinterpret_cast<const char*>(&receive_buffer), sizeof(receive_buffer));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(statsd_port_));
+
+    if (bind(statsd_socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        LOG_ERROR("Failed to bind StatsD listener on port %d", statsd_port_);
+        closeSocket(statsd_socket_);
+        statsd_socket_ = INVALID_SOCKET;
+        return false;
+    }
+
+    statsd_thread_ = std::thread(&IoTMetricsServer::runStatsdLoop, this);
+    LOG_INFO("StatsD listener: udp://<your-server-ip>:%d", statsd_port_);
+    return true;
+}
+
+/**
+ * @brief Stops the StatsD listener and joins its receive thread.
+ */
+void IoTMetricsServer::stopStatsdListener() {
+    if (statsd_thread_.joinable()) {
+        statsd_thread_.join();
+    }
+    if (statsd_socket_ != INVALID_SOCKET) {
+        closeSocket(statsd_socket_);
+        statsd_socket_ = INVALID_SOCKET;
+    }
+}
+
+/**
+ * @brief Receive loop for the StatsD listener.
+ *
+ * On Linux up to statsd_batch_size_ datagrams are read per recvmmsg call; other
+ * platforms drain the socket one recvfrom at a time. Points parsed from one read
+ * are recorded as a single batch.
+ */
+void IoTMetricsServer::runStatsdLoop() {
+    std::vector<char> buffers(statsd_batch_size_ * statsd_max_datagram_);
+    std::vector<MetricPoint> points;
+
+#ifdef __linux__
+    std::vector<mmsghdr> messages(statsd_batch_size_);
+    std::vector<iovec> vectors(statsd_batch_size_);
+#endif
+
+    while (listeners_running_) {
+        if (!waitReadable(statsd_socket_, 200)) {
+            continue;
+        }
+
+#ifdef __linux__
+        for (size_t i = 0; i < statsd_batch_size_; ++i) {
+            vectors[i].iov_base = buffers.data() + i * statsd_max_datagram_;
+            vectors[i].iov_len = statsd_max_datagram_;
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        int received = recvmmsg(statsd_socket_, messages.data(),
+            static_cast<unsigned int>(statsd_batch_size_), MSG_DONTWAIT, nullptr);
+        for (int i = 0; i < received; ++i) {
+            if (messages[i].msg_hdr.msg_flags & MSG_TRUNC) {
+                statsd_lines_rejected_++;
+                continue;
+            }
+            parseStatsdDatagram(buffers.data() + i * statsd_max_datagram_, messages[i].msg_len, points);
+        }
+#else
+        for (size_t i = 0; i < statsd_batch_size_; ++i) {
+            if (i > 0 && !waitReadable(statsd_socket_, 0)) {
+                break;
+            }
+            char* datagram = buffers.data() + i * statsd_max_datagram_;
+            auto received = recvfrom(statsd_socket_, datagram, static_cast<int>(statsd_max_datagram_), 0, nullptr, nullptr);
+            if (received <= 0) {
+                break;
+            }
+            parseStatsdDatagram(datagram, static_cast<size_t>(received), points);
+        }
+#endif
+
+        if (!points.empty()) {
+            recordMetricBatch(points);
+            statsd_lines_accepted_ += points.size();
+            points.clear();
+        }
+    }
+}
+
+/**
+ * @brief Parses every line of a StatsD datagram and appends the valid points.
+ * @param data Datagram payload.
+ * @param length Payload length.
+ * @param points Output metric points.
+ */
+void IoTMetricsServer::parseStatsdDatagram(const char* data, size_t length, std::vector<MetricPoint>& points) {
+    std::string_view payload(data, length);
+    while (!payload.empty()) {
+        size_t newline = payload.find('\n');
+        std::string_view line = payload.substr(0, newline);
+        payload = newline == std::string_view::npos ? std::string_view() : payload.substr(newline + 1);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty()) {
+            continue;
+        }
+
+        MetricPoint point;
+        if (parseStatsdLine(line, point)) {
+            points.push_back(std::move(point));
+        }
+        else {
+            statsd_lines_rejected_++;
+        }
+    }
+}
+
+/**
+ * @brief Parses one StatsD line (name:value|type[|@rate][|#tag:val,...]).
+ *
+ * Counters are scaled by 1/rate to undo client-side sampling. Relative gauge
+ * updates (an explicit leading + or -) and sets are not representable by the
+ * existing instruments and are rejected. Tags without a value become "true".
+ * @param line Line text without the trailing newline.
+ * @param point Output metric point if valid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::parseStatsdLine(std::string_view line, MetricPoint& point) {
+    size_t colon = line.find(':');
+    size_t pipe = line.find('|');
+    if (colon == 0 || colon == std::string_view::npos || pipe == std::string_view::npos || pipe < colon) {
+        return false;
+    }
+
+    std::string_view value_text = line.substr(colon + 1, pipe - colon - 1);
+    if (value_text.empty()) {
+        return false;
+    }
+    bool explicit_sign = value_text.front() == '+' || value_text.front() == '-';
+    std::string_view number_text = value_text.front() == '+' ? value_text.substr(1) : value_text;
+    double value = 0.0;
+    auto [number_end, parse_error] = std::from_chars(number_text.data(), number_text.data() + number_text.size(), value);
+    if (parse_error != std::errc() || number_end != number_text.data() + number_text.size()) {
+        return false;
+    }
+
+    std::string_view fields = line.substr(pipe + 1);
+    size_t next = fields.find('|');
+    std::string_view type = fields.substr(0, next);
+    fields = next == std::string_view::npos ? std::string_view() : fields.substr(next + 1);
+
+    if (type == "c") {
+        point.instrument_type = "counter";
+    }
+    else if (type == "g" && !explicit_sign) {
+        point.instrument_type = "gauge";
+    }
+    else if (type == "ms" || type == "h" || type == "d") {
+        point.instrument_type = "histogram";
+        if (type == "ms") {
+            point.unit = "ms";
+        }
+    }
+    else {
+        return false;
+    }
+
+    double sample_rate = 1.0;
+    while (!fields.empty()) {
+        next = fields.find('|');
+        std::string_view field = fields.substr(0, next);
+        fields = next == std::string_view::npos ? std::string_view() : fields.substr(next + 1);
+
+        if (field.size() > 1 && field.front() == '@') {
+            auto [rate_end, rate_error] = std::from_chars(field.data() + 1, field.data() + field.size(), sample_rate);
+            if (rate_error != std::errc() || sample_rate <= 0.0 || sample_rate > 1.0) {
+                return false;
+            }
+        }
+        else if (field.size() > 1 && field.front() == '#') {
+            std::string_view tags = field.substr(1);
+            while (!tags.empty()) {
+                size_t comma = tags.find(',');
+                std::string_view tag = tags.substr(0, comma);
+                tags = comma == std::string_view::npos ? std::string_view() : tags.substr(comma + 1);
+                if (tag.empty()) {
+                    continue;
+                }
+                size_t separator = tag.find(':');
+                if (separator == std::string_view::npos) {
+                    point.attributes[std::string(tag)] = "true";
+                }
+                else {
+                    point.attributes[std::string(tag.substr(0, separator))] = std::string(tag.substr(separator + 1));
+                }
+            }
+        }
+    }
+
+    point.metric_name.assign(line.data(), colon);
+    point.value = point.instrument_type == "counter" ? value / sample_rate : value;
+
+    std::string error_msg;
+    return validateMetricValue(point.instrument_type, point.value, error_msg);
+}
+
+//==============================================================================
+// HTTP ENDPOINT HANDLERS
+//==============================================================================
+
+/**
+ * @brief Handles metric submission requests to /api/metrics.
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handleMetric(const httplib::Request& req, httplib::Response& res) {
+    try {
+        // Validate the request against OpenTelemetry standards and extract metric data.
+        // The common fixed-schema payload is parsed in place; anything else goes
+        // through the JSON DOM.
+        MetricPoint point;
+        std::string error_msg;
+        MetricPointView view;
+        bool valid;
+        if (FastMetricParser::parseObject(req.body, view)) {
+            valid = parseMetricPoint(view, point, error_msg);
+        }
+        else {
+            json request_data = json::parse(req.body);
+            valid = parseMetricPoint(request_data, point, error_msg);
+        }
+        if (!valid) {
+            res.status = 400;
+            res.set_content(createErrorResponse(error_msg).dump(2), "application/json");
+            return;
+        }
+
+        // Record the metric using proper OpenTelemetry instrument
+        awaitDurable(recordMetric(point.metric_name, point.instrument_type, point.value,
+            point.attributes, point.unit, point.description, point.boundaries));
+
+        // Log the measurement
+        LOG_DEBUG("OpenTelemetry metric recorded: %s (%s) = %g%s%s", point.metric_name.c_str(),
+            point.instrument_type.c_str(), point.value, point.unit.empty() ? "" : " ", point.unit.c_str());
+
+        // Create success response
+        json response = createSuccessResponse("OpenTelemetry metric recorded successfully");
+        response["data"] = {
+            {"metric_name", point.metric_name},
+            {"instrument_type", point.instrument_type},
+            {"value", point.value},
+            {"unit", point.unit},
+            {"attributes", point.attributes},
+            {"timestamp", std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count()}
+        };
+
+        res.set_content(response.dump(2), "application/json");
+
+    }
+    catch (const json::parse_error& e) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid JSON: " + std::string(e.what())).dump(2), "application/json");
+    }
+    catch (const json::type_error& e) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid data type: " + std::string(e.what())).dump(2), "application/json");
+    }
+    catch (const std::exception& e) {
+        res.status = 500;
+        res.set_content(createErrorResponse("Internal server error: " + std::string(e.what())).dump(2), "application/json");
+    }
+}
+
+/**
+ * @brief Handles batch metric submission requests to /api/metrics/batch.
+ *
+ * Accepts either a JSON array of metric objects or an object with a "metrics" array.
+ * Invalid entries are skipped and reported by index; valid entries are recorded.
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handleMetricBatch(const httplib::Request& req, httplib::Response& res) {
+    try {
+        std::vector<MetricPoint> points;
+        json errors = json::array();
+        size_t rejected = 0;
+
+        auto add_entry = [&](size_t index, bool valid, MetricPoint& point, const std::string& error_msg) {
+            if (valid) {
+                points.push_back(std::move(point));
+            }
+            else {
+                rejected++;
+                if (errors.size() < max_batch_errors_) {
+                    errors.push_back({ {"index", index}, {"error", error_msg} });
+                }
+            }
+        };
+
+        auto reject_oversized = [&]() {
+            res.status = 413;
+            res.set_content(createErrorResponse("Batch exceeds maximum of " + std::to_string(max_batch_size_) + " metrics", 413).dump(), "application/json");
+        };
+
+        // Fast path: a plain array of fixed-schema objects, parsed in place
+        thread_local std::vector<MetricPointView> views;
+        if (FastMetricParser::parseArray(req.body, views)) {
+            if (views.size() > max_batch_size_) {
+                reject_oversized();
+                return;
+            }
+
+            points.reserve(views.size());
+            for (size_t i = 0; i < views.size(); ++i) {
+                MetricPoint point;
+                std::string error_msg;
+                bool valid = parseMetricPoint(views[i], point, error_msg);
+                add_entry(i, valid, point, error_msg);
+            }
+        }
+        else {
+            json request_data = json::parse(req.body);
+
+            const json* entries = &request_data;
+            if (request_data.is_object() && request_data.contains("metrics")) {
+                entries = &request_data["metrics"];
+            }
+
+            if (!entries->is_array()) {
+                res.status = 400;
+                res.set_content(createErrorResponse("Batch body must be a JSON array of metrics or an object with a \"metrics\" array").dump(), "application/json");
+                return;
+            }
+
+            if (entries->size() > max_batch_size_) {
+                reject_oversized();
+                return;
+            }
+
+            points.reserve(entries->size());
+            for (size_t i = 0; i < entries->size(); ++i) {
+                MetricPoint point;
+                std::string error_msg;
+                bool valid = false;
+                try {
+                    const json& entry = (*entries)[i];
+                    if (!entry.is_object()) {
+                        error_msg = "Metric entry must be a JSON object";
+                    }
+                    else {
+                        valid = parseMetricPoint(entry, point, error_msg);
+                    }
+                }
+                catch (const json::exception& e) {
+                    error_msg = "Invalid data type: " + std::string(e.what());
+                }
+                add_entry(i, valid, point, error_msg);
+            }
+        }
+
+        awaitDurable(recordMetricBatch(points));
+
+        LOG_DEBUG("OpenTelemetry metric batch recorded: %zu accepted, %zu rejected",
+            points.size(), rejected);
+
+        json response = createSuccessResponse("OpenTelemetry metric batch processed");
+        response["success"] = rejected == 0;
+        response["accepted"] = points.size();
+        response["rejected"] = rejected;
+        response["errors"] = std::move(errors);
+        if (rejected > max_batch_errors_) {
+            response["errors_truncated"] = true;
+        }
+
+        if (points.empty() && rejected > 0) {
+            res.status = 400;
+        }
+        res.set_content(response.dump(), "application/json");
+    }
+    catch (const json::parse_error& e) {
+        res.status = 400;
+        res.set_content(createErrorResponse("Invalid JSON: " + std::string(e.what())).dump(), "application/json");
+    }
+    catch (const std::exception& e) {
+        res.status = 500;
+        res.set_content(createErrorResponse("Internal server error: " + std::string(e.what()), 500).dump(), "application/json");
+    }
+}
+
+/**
+ * @brief Handles streaming NDJSON submission requests to /api/metrics/stream.
+ *
+ * Each line of the body is one metric object. Complete lines are parsed and
+ * recorded as soon as the chunk containing them arrives; only a partial trailing
+ * line is carried over between chunks, so memory stays bounded by the chunk size
+ * plus max_stream_line_length_ regardless of upload size. If the body ends
+ * early (client abort or read error), the points already recorded are kept, the
+ * partial trailing line is dropped, and the response reports the counts so far.
+ * @param req The HTTP request (unused; the body arrives through content_reader).
+ * @param res The HTTP response.
+ * @param content_reader Reader delivering the request body in chunks.
+ */
+void IoTMetricsServer::handleMetricStream(const httplib::Request& req, httplib::Response& res,
+    const httplib::ContentReader& content_reader) {
+    (void)req;
+    size_t accepted = 0;
+    size_t rejected = 0;
+    size_t line_number = 0;
+    json errors = json::array();
+
+    std::string pending;        // Partial line carried over from the previous chunk
+    bool pending_overflow = false;
+    std::vector<MetricPoint> points;
+    MetricPointView line_view;  // Reused across lines
+    uint64_t logged = 0;        // Write-ahead log sequence number of the last chunk logged
+
+    auto reject = [&](const std::string& error_msg) {
+        rejected++;
+        if (errors.size() < max_batch_errors_) {
+            errors.push_back({ {"line", line_number}, {"error", error_msg} });
+        }
+    };
+
+    auto process_line = [&](const char* begin, const char* end) {
+        line_number++;
+        if (end > begin && *(end - 1) == '\r') {
+            --end;
+        }
+        if (begin == end) {
+            return;
+        }
+
+        MetricPoint point;
+        std::string error_msg;
+
+        // Fast path for the fixed-schema line; the DOM handles everything else
+        if (FastMetricParser::parseObject(std::string_view(begin, static_cast<size_t>(end - begin)), line_view)) {
+            if (!parseMetricPoint(line_view, point, error_msg)) {
+                reject(error_msg);
+                return;
+            }
+            points.push_back(std::move(point));
+            return;
+        }
+
+        json line_data = json::parse(begin, end, nullptr, false);
+        if (line_data.is_discarded()) {
+            reject("Invalid JSON");
+            return;
+        }
+        if (!line_data.is_object()) {
+            reject("Metric entry must be a JSON object");
+            return;
+        }
+
+        try {
+            if (!parseMetricPoint(line_data, point, error_msg)) {
+                reject(error_msg);
+                return;
+            }
+        }
+        catch (const json::exception& e) {
+            reject("Invalid data type: " + std::string(e.what()));
+            return;
+        }
+        points.push_back(std::move(point));
+    };
+
+    auto finish_pending = [&]() {
+        if (pending_overflow) {
+            line_number++;
+            reject("Line exceeds maximum length of " + std::to_string(max_stream_line_length_) + " bytes");
+        }
+        else {
+            process_line(pending.data(), pending.data() + pending.size());
+        }
+        pending.clear();
+        pending_overflow = false;
+    };
+
+    auto flush_points = [&]() {
+        if (!points.empty()) {
+            logged = std::max(logged, recordMetricBatch(points));
+            accepted += points.size();
+            points.clear();
+        }
+    };
+
+    bool complete = false;
+    try {
+        complete = content_reader([&](const char* data, size_t data_length) {
+            const char* cursor = data;
+            const char* chunk_end = data + data_length;
+
+            while (cursor < chunk_end) {
+                const char* newline = static_cast<const char*>(
+                    std::memchr(cursor, '\n', static_cast<size_t>(chunk_end - cursor)));
+                const char* segment_end = newline ? newline : chunk_end;
+
+                if (pending.empty() && !pending_overflow && newline) {
+                    // Whole line inside this chunk: parse straight from the buffer
+                    process_line(cursor, segment_end);
+                }
+                else {
+                    size_t segment_length = static_cast<size_t>(segment_end - cursor);
+                    if (!pending_overflow && pending.size() + segment_length <= max_stream_line_length_) {
+                        pending.append(cursor, segment_length);
+                    }
+                    else {
+                        pending.clear();
+                        pending_overflow = true;
+                    }
+                    if (newline) {
+                        finish_pending();
+                    }
+                }
+
+                cursor = newline ? newline + 1 : chunk_end;
+            }
+
+            // Apply what this chunk produced before reading the next one
+            flush_points();
+            return true;
+        });
+
+        // A truncated body may end mid-line; only a complete one has a last line to parse
+        if (complete && (!pending.empty() || pending_overflow)) {
+            finish_pending();
+        }
+        flush_points();
+        awaitDurable(logged);
+    }
+    catch (const std::exception& e) {
+        json response = createErrorResponse("Internal server error: " + std::string(e.what()), 500);
+        response["accepted"] = accepted;
+        response["rejected"] = rejected;
+        response["lines"] = line_number;
+        res.status = 500;
+        res.set_content(response.dump(), "application/json");
+        return;
+    }
+
+    if (!complete) {
+        LOG_WARN("OpenTelemetry metric stream aborted after %zu lines: %zu accepted, %zu rejected",
+            line_number, accepted, rejected);
+        json response = createErrorResponse("Stream ended before the request body was complete", 400);
+        response["accepted"] = accepted;
+        response["rejected"] = rejected;
+        response["lines"] = line_number;
+        res.status = 400;
+        res.set_content(response.dump(), "application/json");
+        return;
+    }
+
+    LOG_DEBUG("OpenTelemetry metric stream recorded: %zu accepted, %zu rejected (%zu lines)",
+        accepted, rejected, line_number);
+
+    json response = createSuccessResponse("OpenTelemetry metric stream processed");
+    response["success"] = rejected == 0;
+    response["accepted"] = accepted;
+    response["rejected"] = rejected;
+    response["lines"] = line_number;
+    response["errors"] = std::move(errors);
+    if (rejected > max_batch_errors_) {
+        response["errors_truncated"] = true;
+    }
+
+    if (accepted == 0 && rejected > 0) {
+        res.status = 400;
+    }
+    res.set_content(response.dump(), "application/json");
+}
+
+/**
+ * @brief Handles health check requests to /health.
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handleHealth(const httplib::Request& req, httplib::Response& res) {
+    json response;
+    response["status"] = "healthy";
+    response["server"] = "OpenTelemetry IoT Metrics API";
+    response["version"] = "1.0.0";
+    response["opentelemetry"] = "enabled";
+    response["supported_instruments"] = { "counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge" };
+    response["metrics_port"] = metrics_port_;
+    response["custom_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(port_) + "/metrics";
+    response["timestamp"] = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    res.set_content(response.dump(2), "application/json");
+}
+
+/**
+ * @brief Handles status requests to /api/status.
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handleStatus(const httplib::Request& req, httplib::Response& res) {
+    size_t counters = 0, updowncounters = 0, histograms = 0, exponential_histograms = 0, summaries = 0, gauges = 0;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        counters += shard.counter_families.size();
+        updowncounters += shard.updowncounter_families.size();
+        histograms += shard.histogram_families.size();
+        exponential_histograms += shard.exponential_histogram_families.size();
+        summaries += shard.summary_families.size();
+        gauges += shard.gauge_families.size();
+    }
+
+    json response;
+    response["status"] = "running";
+    response["api_port"] = port_;
+    response["metrics_port"] = metrics_port_;
+    response["custom_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(port_) + "/metrics";
+    response["standard_metrics_endpoint"] = "http://<your-server-ip>:" + std::to_string(metrics_port_) + "/metrics";
+    response["opentelemetry"] = {
+        {"meter_provider", "active"},
+        {"prometheus_exporter", "active"},
+        {"custom_exporter", "active"},
+        {"meter_name", "iot_metrics_api"},
+        {"meter_version", "1.0.0"},
+        {"standard", "OpenTelemetry"}
+    };
+    response["binary_ingestion"] = {
+        {"enabled", binary_port_ > 0},
+        {"port", binary_port_},
+        {"frames_accepted", binary_frames_accepted_.load()},
+        {"frames_rejected", binary_frames_rejected_.load()},
+        {"max_connections", max_binary_connections_},
+        {"connections_rejected", binary_connections_rejected_.load()}
+    };
+    response["statsd_ingestion"] = {
+        {"enabled", statsd_port_ > 0},
+        {"port", statsd_port_},
+        {"lines_accepted", statsd_lines_accepted_.load()},
+        {"lines_rejected", statsd_lines_rejected_.load()}
+    };
+    response["registered_instruments"] = {
+        {"counters", counters},
+        {"updowncounters", updowncounters},
+        {"histograms", histograms},
+        {"exponential_histograms", exponential_histograms},
+        {"summaries", summaries},
+        {"gauges", gauges}
+    };
+    response["metric_shards"] = metric_shard_count_;
+    response["label_pool"] = {
+        {"strings", label_pool_.size()},
+        {"arena_bytes", label_pool_.arenaBytes()}
+    };
+    response["histogram_bucket_kernel"] = BucketLocator::kernelName();
+    response["histogram_views"] = histogram_views_.size();
+    response["summary_views"] = summary_views_.size();
+    response["histogram_boundary_conflicts"] = histogram_boundary_conflicts_.load();
+    json ttl = json::object();
+    static const char* const kind_names[family_kind_count_] = {
+        "counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge"
+    };
+    for (size_t kind = 0; kind < family_kind_count_; ++kind) {
+        ttl[kind_names[kind]] = series_ttl_seconds_[kind];
+    }
+    response["series_expiry"] = {
+        {"ttl_seconds", ttl},
+        {"enabled", std::any_of(series_ttl_seconds_.begin(), series_ttl_seconds_.end(), [](int64_t t) { return t > 0; })},
+        {"evicted", series_evicted_.load()}
+    };
+    size_t top_count = memory_top_families_;
+    if (req.has_param("top")) {
+        const std::string top = req.get_param_value("top");
+        size_t parsed = 0;
+        auto [ptr, ec] = std::from_chars(top.data(), top.data() + top.size(), parsed);
+        if (ec == std::errc() && ptr == top.data() + top.size()) {
+            top_count = std::min(parsed, max_memory_top_families_);
+        }
+    }
+    const MemoryUsage memory = collectMemoryUsage(top_count);
+    json top_families = json::array();
+    for (const FamilyMemory& family : memory.top_families) {
+        top_families.push_back({
+            {"metric", family.name},
+            {"instrument_type", family.instrument_type},
+            {"series", family.series},
+            {"series_bytes", family.series_bytes},
+            {"label_bytes", family.label_bytes},
+            {"bucket_bytes", family.bucket_bytes},
+            {"render_bytes", family.render_bytes},
+            {"total_bytes", family.totalBytes()}
+        });
+    }
+    response["memory"] = {
+        {"approximate_bytes", memory.totals.totalBytes() + label_pool_.arenaBytes()},
+        {"families", memory.families},
+        {"series_bytes", memory.totals.series_bytes},
+        {"label_bytes", memory.totals.label_bytes},
+        {"bucket_bytes", memory.totals.bucket_bytes},
+        {"render_bytes", memory.totals.render_bytes},
+        {"label_pool_bytes", label_pool_.arenaBytes()},
+        {"top_families", top_families}
+    };
+    response["cardinality"] = {
+        {"series", series_count_.load()},
+        {"max_series", max_series_},
+        {"max_series_per_metric", max_series_per_metric_},
+        {"overflow_points", overflow_points_.load()},
+        {"rejected_series", rejected_series_.estimate()},
+        {"metrics", family_count_.load()},
+        {"max_metrics", max_metrics_},
+        {"overflow_metric_points", overflow_metric_points_.load()},
+        {"rejected_metrics", rejected_metrics_.estimate()}
+    };
+    json persistence = {
+        {"enabled", wal_ != nullptr},
+        {"data_directory", data_directory_}
+    };
+    if (wal_) {
+        persistence["snapshot_interval_seconds"] = snapshot_interval_.count();
+        persistence["wal"] = {
+            {"segment", wal_->segment()},
+            {"records", wal_->records()},
+            {"bytes", wal_->bytes()},
+            {"commits", wal_->commits()},
+            {"errors", wal_->errors()},
+            {"async", wal_async_}
+        };
+        persistence["snapshots"] = {
+            {"written", snapshots_written_.load()},
+            {"failed", snapshot_failures_.load()},
+            {"last_segment", snapshot_segment_.load()},
+            {"last_series", snapshot_series_.load()},
+            {"last_bytes", snapshot_bytes_.load()},
+            {"last_pause_ms", static_cast<double>(snapshot_pause_us_.load()) / 1000.0}
+        };
+        persistence["slots"] = {
+            {"enabled", slots_ != nullptr},
+            {"capacity", slots_ ? slots_->capacity() : size_t{ 0 }},
+            {"used", slots_ ? slots_->used() : size_t{ 0 }},
+            {"exhausted", slots_ ? slots_->exhausted() : uint64_t{ 0 }},
+            {"catalog_errors", slots_ ? slots_->catalogErrors() : uint64_t{ 0 }},
+            {"file_bytes", slots_ ? slots_->fileBytes() : size_t{ 0 }}
+        };
+        persistence["restored"] = {
+            {"slot_series", restore_stats_.slot_series},
+            {"snapshot", restore_stats_.snapshot},
+            {"snapshot_series", restore_stats_.snapshot_series},
+            {"segments", restore_stats_.segments},
+            {"records", restore_stats_.records},
+            {"points", restore_stats_.points},
+            {"torn_segments", restore_stats_.torn_segments},
+            {"milliseconds", restore_stats_.milliseconds}
+        };
+    }
+    response["persistence"] = persistence;
+    response["logging"] = {
+        {"level", Logger::levelName(Logger::instance().level())},
+        {"dropped_messages", Logger::instance().dropped()}
+    };
+    // Negotiated by httplib from Accept-Encoding / Content-Encoding when compiled in
+    response["compression"] = {
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+        {"gzip", true},
+#else
+        {"gzip", false},
+#endif
+#ifdef CPPHTTPLIB_BROTLI_SUPPORT
+        {"brotli", true}
+#else
+        {"brotli", false}
+#endif
+    };
+    response["endpoints"] = {
+        {"submit_metric", "POST /api/metrics"},
+        {"submit_metric_batch", "POST /api/metrics/batch"},
+        {"submit_metric_stream", "POST /api/metrics/stream"},
+        {"list_metrics", "GET /api/metrics/list"},
+        {"custom_prometheus_metrics", "GET /metrics"},
+        {"health", "GET /health"},
+        {"status", "GET /api/status"},
+        {"metrics_info", "GET /metrics/info"}
+    };
+
+    res.set_content(response.dump(2), "application/json");
+}
+
+//==============================================================================
+// MEMORY ACCOUNTING
+//==============================================================================
+
+/**
+ * @brief Measures one family.
+ *
+ * Sizes are approximate: container capacities times element sizes, without
+ * allocator overhead. Label strings are interned and shared, so only each
+ * series' id array is charged to the family.
+ * @note Caller must hold the family's shard mutex.
+ * @param name Metric name.
+ * @param instrument_type Instrument type.
+ * @param family Family to measure.
+ * @param value_bytes Called with each series value; returns its heap bytes outside the table.
+ * @param extra_bucket_bytes Family-level bucket bytes (boundaries, quantiles).
+ * @return The family's memory.
+ */
+template <typename Family, typename ValueBytes>
+IoTMetricsServer::FamilyMemory IoTMetricsServer::measureFamily(const std::string& name,
+    const char* instrument_type, const Family& family, ValueBytes&& value_bytes, size_t extra_bucket_bytes) {
+    FamilyMemory memory;
+    memory.name = name;
+    memory.instrument_type = instrument_type;
+    memory.series = family.series.size();
+    memory.series_bytes = family.series.memoryBytes() + (family.rejected_series ? sizeof(DistinctCounter) : 0);
+    memory.bucket_bytes = extra_bucket_bytes;
+    for (const auto& entry : family.series) {
+        memory.label_bytes += entry.labels.capacity() * sizeof(LabelPair);
+        memory.bucket_bytes += value_bytes(entry.value);
+    }
+
+    const FamilyRender& render = family.render;
+    memory.render_bytes = render.sanitized_name.capacity() + render.description.capacity() +
+        render.headers[0].capacity() + render.headers[1].capacity() + render.series.capacity() * sizeof(SeriesRender);
+    for (const SeriesRender& cached : render.series) {
+        memory.render_bytes += cached.labels.capacity() + cached.lines.capacity() + cached.proto_labels.capacity();
+    }
+    return memory;
+}
+
+/**
+ * @brief Measures every family, locking one shard at a time.
+ * @param top_count Number of largest families to keep.
+ * @return The totals and the top_count largest families, largest first.
+ */
+IoTMetricsServer::MemoryUsage IoTMetricsServer::collectMemoryUsage(size_t top_count) {
+    // A counter series is a shared_ptr allocation (the series plus the control block) and a
+    // separate allocation of padded cells (a slot-backed series keeps them too, for its writers)
+    auto sum_series_bytes = [](const SumFamily& family) {
+        size_t bytes = family.series.size() * (sizeof(SumSeries) + 2 * sizeof(void*));
+        for (const auto& entry : family.series) {
+            bytes += entry.value->cells ? sizeof(*entry.value->cells) : 0;
+        }
+        return bytes;
+    };
+    auto no_heap = [](const auto&) { return size_t{ 0 }; };
+
+    std::vector<FamilyMemory> families;
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [name, family] : shard.counter_families) {
+            families.push_back(measureFamily(name, "counter", family, no_heap, 0));
+            families.back().series_bytes += sum_series_bytes(family);
+        }
+        for (const auto& [name, family] : shard.updowncounter_families) {
+            families.push_back(measureFamily(name, "updowncounter", family, no_heap, 0));
+            families.back().series_bytes += sum_series_bytes(family);
+        }
+        for (const auto& [name, family] : shard.histogram_families) {
+            families.push_back(measureFamily(name, "histogram", family,
+                [](const HistogramState& state) { return state.bucket_counts.capacity() * sizeof(uint64_t); },
+                family.boundaries.capacity() * sizeof(double)));
+        }
+        for (const auto& [name, family] : shard.exponential_histogram_families) {
+            families.push_back(measureFamily(name, "exponential_histogram", family,
+                [](const ExponentialHistogram& state) {
+                    return (state.positive().counts.capacity() + state.negative().counts.capacity()) * sizeof(uint64_t);
+                }, 0));
+        }
+        for (const auto& [name, family] : shard.summary_families) {
+            families.push_back(measureFamily(name, "summary", family,
+                [](const QuantileSketch& state) { return state.bucketBytes(); },
+                family.quantiles.capacity() * sizeof(double)));
+        }
+        for (const auto& [name, family] : shard.gauge_families) {
+            families.push_back(measureFamily(name, "gauge", family, no_heap, 0));
+        }
+    }
+
+    MemoryUsage usage;
+    usage.families = families.size();
+    usage.totals.name = "total";
+    for (const FamilyMemory& memory : families) {
+        usage.totals.series += memory.series;
+        usage.totals.series_bytes += memory.series_bytes;
+        usage.totals.label_bytes += memory.label_bytes;
+        usage.totals.bucket_bytes += memory.bucket_bytes;
+        usage.totals.render_bytes += memory.render_bytes;
+    }
+
+    const size_t kept = std::min(top_count, families.size());
+    std::partial_sort(families.begin(), families.begin() + static_cast<std::ptrdiff_t>(kept), families.end(),
+        [](const FamilyMemory& a, const FamilyMemory& b) { return a.totalBytes() > b.totalBytes(); });
+    families.resize(kept);
+    usage.top_families = std::move(families);
+    return usage;
+}
+
+/**
+ * @brief Appends the memory self-metrics to the exposition.
+ *
+ * iot_metrics_memory_bytes{component} carries the store-wide totals (including
+ * the label pool arena) and iot_metrics_family_memory_bytes{metric,
+ * instrument_type,component} the memory_top_families_ largest families.
+ * @param format Exposition format.
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::appendMemorySelfMetrics(ExpositionFormat format, std::string& output) {
+    const MemoryUsage usage = collectMemoryUsage(memory_top_families_);
+    static const char* const components[] = { "series", "labels", "buckets", "render" };
+    auto component_bytes = [](const FamilyMemory& memory, size_t component) {
+        switch (component) {
+        case 0: return memory.series_bytes;
+        case 1: return memory.label_bytes;
+        case 2: return memory.bucket_bytes;
+        default: return memory.render_bytes;
+        }
+    };
+
+    // Each sample is a list of label pairs and a value
+    using Labels = std::vector<std::pair<const char*, std::string>>;
+    std::vector<std::pair<Labels, double>> totals, per_family;
+    for (size_t c = 0; c < 4; ++c) {
+        totals.push_back({ { { "component", components[c] } }, static_cast<double>(component_bytes(usage.totals, c)) });
+    }
+    totals.push_back({ { { "component", "label_pool" } }, static_cast<double>(label_pool_.arenaBytes()) });
+    for (const FamilyMemory& memory : usage.top_families) {
+        for (size_t c = 0; c < 4; ++c) {
+            per_family.push_back({ { { "metric", memory.name }, { "instrument_type", memory.instrument_type },
+                { "component", components[c] } }, static_cast<double>(component_bytes(memory, c)) });
+        }
+    }
+
+    auto append_family = [&](const char* name, const char* help, const std::vector<std::pair<Labels, double>>& samples) {
+        if (format == ExpositionFormat::Protobuf) {
+            std::string metrics, metric, pair, gauge;
+            for (const auto& [labels, value] : samples) {
+                metric.clear();
+                for (const auto& [key, label_value] : labels) {
+                    pair.clear();
+                    ProtoWriter::writeString(pair, 1, key);
+                    ProtoWriter::writeString(pair, 2, label_value);
+                    ProtoWriter::writeMessage(metric, 1, pair);
+                }
+                gauge.clear();
+                ProtoWriter::writeDouble(gauge, 1, value);
+                ProtoWriter::writeMessage(metric, 2, gauge);
+                ProtoWriter::writeMessage(metrics, 4, metric);
+            }
+            std::string header;
+            ProtoWriter::writeString(header, 1, name);
+            ProtoWriter::writeString(header, 2, help);
+            // MetricType GAUGE = 1
+            ProtoWriter::writeUint64(header, 3, 1);
+            ProtoWriter::writeVarint(output, header.size() + metrics.size());
+            output += header;
+            output += metrics;
+            return;
+        }
+
+        TextWriter::append(output, "# HELP ");
+        TextWriter::append(output, name);
+        TextWriter::append(output, " ");
+        if (format == ExpositionFormat::OpenMetricsText) TextWriter::appendOpenMetricsHelp(output, help);
+        else TextWriter::appendHelp(output, help);
+        TextWriter::append(output, "\n# TYPE ");
+        TextWriter::append(output, name);
+        TextWriter::append(output, " gauge\n");
+        std::string labels_str;
+        for (const auto& [labels, value] : samples) {
+            labels_str.clear();
+            TextWriter::append(labels_str, "{");
+            for (size_t i = 0; i < labels.size(); ++i) {
+                if (i > 0) {
+                    TextWriter::append(labels_str, ",");
+                }
+                TextWriter::append(labels_str, labels[i].first);
+                TextWriter::append(labels_str, "=\"");
+                TextWriter::appendLabelValue(labels_str, labels[i].second);
+                TextWriter::append(labels_str, "\"");
+            }
+            TextWriter::append(labels_str, "}");
+            appendSample(output, name, labels_str, value);
+        }
+        if (format == ExpositionFormat::PrometheusText) {
+            TextWriter::append(output, "\n");
+        }
+    };
+
+    append_family("iot_metrics_memory_bytes",
+        "Approximate bytes held by the metric store, by component.", totals);
+    if (!per_family.empty()) {
+        append_family("iot_metrics_family_memory_bytes",
+            "Approximate bytes held by the largest metric families, by component.", per_family);
+    }
+}
+
+/**
+ * @brief Handles requests to list all registered metrics at /api/metrics/list.
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handleMetricsList(const httplib::Request& req, httplib::Response& res) {
+    json response;
+    response["opentelemetry_standard"] = true;
+
+    json instruments_list;
+
+    auto now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // Helper lambda to total a counter/updowncounter family across its series
+    auto sum_family_value = [](const SumFamily& family) -> double {
+        double total = 0.0;
+        for (const auto& entry : family.series) {
+            total += entry.value->read();
+        }
+        return total;
+    };
+
+    // Walk the shards one at a time so listing never blocks the whole store
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        // List Counters (value is the total across all series)
+        for (const auto& [name, family] : shard.counter_families) {
+            json j = {
+                {"instrument_type", "counter"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "monotonically_increasing"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", sum_family_value(family)}
+            };
+            instruments_list[name] = j;
+        }
+
+        // List UpDownCounters (value is the total across all series)
+        for (const auto& [name, family] : shard.updowncounter_families) {
+            json j = {
+                {"instrument_type", "updowncounter"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "accumulates_can_increase_decrease"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", sum_family_value(family)}
+            };
+            instruments_list[name] = j;
+        }
+
+        // List Histograms (value and count are totals across all series)
+        for (const auto& [name, family] : shard.histogram_families) {
+            double sum = 0.0;
+            uint64_t count = 0;
+            for (const auto& entry : family.series) {
+                sum += entry.value.sum;
+                count += entry.value.count;
+            }
+            json j = {
+                {"instrument_type", "histogram"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "value_distribution"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", sum},
+                {"count", count}
+            };
+            instruments_list[name] = j;
+        }
+
+        // List exponential Histograms (value and count are totals across all series)
+        for (const auto& [name, family] : shard.exponential_histogram_families) {
+            double sum = 0.0;
+            uint64_t count = 0;
+            for (const auto& entry : family.series) {
+                sum += entry.value.sum();
+                count += entry.value.count();
+            }
+            json j = {
+                {"instrument_type", "exponential_histogram"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "value_distribution"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", sum},
+                {"count", count}
+            };
+            instruments_list[name] = j;
+        }
+
+        // List Summaries (value and count are totals; quantiles come from the series sketches merged)
+        for (const auto& [name, family] : shard.summary_families) {
+            QuantileSketch merged;
+            for (const auto& entry : family.series) {
+                merged.merge(entry.value);
+            }
+            json quantiles = json::object();
+            for (double quantile : family.quantiles) {
+                std::string key;
+                TextWriter::appendDouble(key, quantile);
+                const double estimate = merged.quantile(quantile);
+                quantiles[key] = std::isnan(estimate) ? json(nullptr) : json(estimate);
+            }
+            json j = {
+                {"instrument_type", "summary"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "value_distribution"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", merged.sum()},
+                {"count", merged.count()},
+                {"quantiles", quantiles}
+            };
+            instruments_list[name] = j;
+        }
+
+        // List Gauges (value is the most recently set)
+        for (const auto& [name, family] : shard.gauge_families) {
+            json j = {
+                {"instrument_type", "gauge"},
+                {"description", family.descriptor.description_},
+                {"unit", family.descriptor.unit_},
+                {"semantic", "absolute_value"},
+                {"timestamp", now},
+                {"series", family.series.size()},
+                {"overflow_points", family.overflow_points},
+                {"rejected_series", family.rejected_series ? family.rejected_series->estimate() : uint64_t{ 0 }},
+                {"value", family.last_value}
+            };
+            instruments_list[name] = j;
+        }
+    }
+
+    response["instruments"] = instruments_list;
+    response["total_instruments"] = instruments_list.size();
+    res.set_content(response.dump(2), "application/json");
+}
+
+//==============================================================================
+// CUSTOM PROMETHEUS EXPORT METHODS
+//==============================================================================
+
+/**
+ * @brief Handles requests to the custom Prometheus metrics endpoint (/metrics).
+ * @param req The HTTP request.
+ * @param res The HTTP response.
+ */
+void IoTMetricsServer::handlePrometheusMetrics(const httplib::Request& req, httplib::Response& res) {
+    // State shared across provider calls; the buffer is reused for every chunk
+    struct Stream {
+        ExpositionCursor cursor;
+        std::string buffer;
+        size_t bytes = 0;
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+        std::unique_ptr<httplib::detail::gzip_compressor> gzip;
+#endif
+    };
+    auto stream = std::make_shared<Stream>();
+    stream->cursor.format = negotiateExpositionFormat(req.get_header_value("Accept"));
+    stream->buffer.reserve(exposition_chunk_size_ * 2);
+
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+    // httplib compresses text/* itself, but not the OpenMetrics or protobuf content types
+    if (stream->cursor.format != ExpositionFormat::PrometheusText &&
+        acceptsGzip(req.get_header_value("Accept-Encoding"))) {
+        stream->gzip = std::make_unique<httplib::detail::gzip_compressor>();
+        res.set_header("Content-Encoding", "gzip");
+        res.set_header("Vary", "Accept-Encoding");
+    }
+#endif
+
+    res.set_chunked_content_provider(expositionContentType(stream->cursor.format),
+        [this, stream](size_t /*offset*/, httplib::DataSink& sink) {
+            // Passes bytes to the sink, through gzip when this handler compresses the response
+            auto write = [&](const char* data, size_t length, bool last) {
+#ifdef CPPHTTPLIB_ZLIB_SUPPORT
+                if (stream->gzip) {
+                    return stream->gzip->compress(data, length, last,
+                        [&](const char* compressed, size_t compressed_length) {
+                            return sink.write(compressed, compressed_length);
+                        });
+                }
+#endif
+                (void)last;  // Only the compressor needs to know the stream is ending
+                return length == 0 || sink.write(data, length);
+            };
+            try {
+                if (!renderMetricsChunk(stream->cursor, stream->buffer)) {
+                    if (!write(nullptr, 0, true)) {
+                        return false;
+                    }
+                    sink.done();
+                    LOG_DEBUG("Served Custom Prometheus metrics (%zu bytes)", stream->bytes);
+                    return true;
+                }
+                stream->bytes += stream->buffer.size();
+                return write(stream->buffer.data(), stream->buffer.size(), false);
+            }
+            catch (const std::exception& e) {
+                LOG_ERROR("Error generating metrics: %s", e.what());
+                return false;
+            }
+        });
+}
+
+/**
+ * @brief Picks the exposition format from an Accept header.
+ *
+ * The recognized media type with the highest q wins, the first listed on a
+ * tie (Prometheus sends its preference both ways); q=0 rules a type out.
+ * "*" wildcards stand for the 0.0.4 text format. If nothing recognized is
+ * acceptable, the 0.0.4 text format is served anyway.
+ * @param accept Accept header value.
+ * @return Negotiated format.
+ */
+IoTMetricsServer::ExpositionFormat IoTMetricsServer::negotiateExpositionFormat(const std::string& accept) {
+    ExpositionFormat best = ExpositionFormat::PrometheusText;
+    double best_quality = 0.0;
+    std::string_view remaining = accept;
+    while (!remaining.empty()) {
+        size_t comma = remaining.find(',');
+        std::string_view media_range = remaining.substr(0, comma);
+        remaining = comma == std::string_view::npos ? std::string_view() : remaining.substr(comma + 1);
+
+        ExpositionFormat format;
+        if (media_range.find("application/vnd.google.protobuf") != std::string_view::npos &&
+            media_range.find("io.prometheus.client.MetricFamily") != std::string_view::npos &&
+            media_range.find("encoding=delimited") != std::string_view::npos) {
+            format = ExpositionFormat::Protobuf;
+        }
+        else if (media_range.find("application/openmetrics-text") != std::string_view::npos) {
+            format = ExpositionFormat::OpenMetricsText;
+        }
+        else if (media_range.find("text/plain") != std::string_view::npos ||
+            media_range.find("*/*") != std::string_view::npos || media_range.find("text/*") != std::string_view::npos) {
+            format = ExpositionFormat::PrometheusText;
+        }
+        else {
+            continue;
+        }
+
+        const double quality = acceptQuality(media_range);
+        if (quality > best_quality) {
+            best = format;
+            best_quality = quality;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Reads the q parameter of one element of an Accept or Accept-Encoding header.
+ * @param element Media range or content coding with its parameters.
+ * @return The quality, clamped to [0, 1] (1 if absent or malformed).
+ */
+double IoTMetricsServer::acceptQuality(std::string_view element) {
+    size_t semicolon = element.find(';');
+    while (semicolon != std::string_view::npos) {
+        element.remove_prefix(semicolon + 1);
+        semicolon = element.find(';');
+        std::string_view parameter = element.substr(0, semicolon);
+        while (!parameter.empty() && (parameter.front() == ' ' || parameter.front() == '\t')) {
+            parameter.remove_prefix(1);
+        }
+        while (!parameter.empty() && (parameter.back() == ' ' || parameter.back() == '\t')) {
+            parameter.remove_suffix(1);
+        }
+        if (parameter.size() < 2 || (parameter[0] != 'q' && parameter[0] != 'Q') || parameter[1] != '=') {
+            continue;
+        }
+        double quality = 1.0;
+        auto [end, error] = std::from_chars(parameter.data() + 2, parameter.data() + parameter.size(), quality);
+        if (error != std::errc() || end != parameter.data() + parameter.size()) {
+            return 1.0;
+        }
+        return std::clamp(quality, 0.0, 1.0);
+    }
+    return 1.0;
+}
+
+/**
+ * @brief Checks whether an Accept-Encoding header allows gzip.
+ *
+ * An explicit gzip (or x-gzip) entry decides; otherwise a "*" entry does.
+ * @param accept_encoding Accept-Encoding header value.
+ * @return True if gzip is acceptable.
+ */
+bool IoTMetricsServer::acceptsGzip(const std::string& accept_encoding) {
+    double wildcard = 0.0;
+    std::string_view remaining = accept_encoding;
+    while (!remaining.empty()) {
+        size_t comma = remaining.find(',');
+        std::string_view element = remaining.substr(0, comma);
+        remaining = comma == std::string_view::npos ? std::string_view() : remaining.substr(comma + 1);
+
+        std::string_view coding = element.substr(0, element.find(';'));
+        while (!coding.empty() && (coding.front() == ' ' || coding.front() == '\t')) {
+            coding.remove_prefix(1);
+        }
+        while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) {
+            coding.remove_suffix(1);
+        }
+        auto is = [&](std::string_view name) {
+            return coding.size() == name.size() && std::equal(coding.begin(), coding.end(), name.begin(),
+                [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == b; });
+        };
+        if (is("gzip") || is("x-gzip")) {
+            return acceptQuality(element) > 0.0;
+        }
+        if (is("*")) {
+            wildcard = acceptQuality(element);
+        }
+    }
+    return wildcard > 0.0;
+}
+
+/**
+ * @brief Returns the Content-Type of an exposition format.
+ * @param format Exposition format.
+ * @return Content-Type header value.
+ */
+const char* IoTMetricsServer::expositionContentType(ExpositionFormat format) {
+    switch (format) {
+    case ExpositionFormat::Protobuf:
+        return "application/vnd.google.protobuf; proto=io.prometheus.client.MetricFamily; encoding=delimited";
+    case ExpositionFormat::OpenMetricsText:
+        return "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    default:
+        return "text/plain; version=0.0.4; charset=utf-8";
+    }
+}
+
+/**
+ * @brief Formats all metrics for Prometheus exposition.
+ * @return Formatted Prometheus metrics as a string.
+ */
+std::string IoTMetricsServer::formatPrometheusMetrics() {
+    std::string output;
+    std::string chunk;
+    ExpositionCursor cursor;
+    while (renderMetricsChunk(cursor, chunk)) {
+        output += chunk;
+    }
+    return output;
+}
+
+/**
+ * @brief Renders the next chunk of the exposition.
+ *
+ * Families are written whole, shard by shard and kind by kind, until the chunk
+ * reaches exposition_chunk_size_. The cursor remembers the last family written
+ * by name, so families added or removed between chunks never invalidate it.
+ * @param cursor Position to continue from; advanced past the rendered families.
+ * @param buffer Reusable buffer, cleared and filled with the chunk.
+ * @return False once the exposition is complete and nothing was rendered.
+ */
+bool IoTMetricsServer::renderMetricsChunk(ExpositionCursor& cursor, std::string& buffer) {
+    buffer.clear();
+    if (cursor.finished) {
+        return false;
+    }
+
+    // Only the 0.0.4 text format allows free-form comments
+    if (!cursor.preamble_written && cursor.format == ExpositionFormat::PrometheusText) {
+        // Add server info as comments
+        buffer += "# OpenTelemetry IoT Metrics API - Custom Export\n";
+        buffer += "# Server: http://<your-server-ip>:";
+        TextWriter::appendUint(buffer, static_cast<uint64_t>(port_));
+        buffer += "\n# Generated: ";
+        TextWriter::appendUint(buffer, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()));
+        buffer += "\n\n";
+    }
+    cursor.preamble_written = true;
+
+    const ExpositionFormat format = cursor.format;
+
+    // Append the families of one kind from where the cursor left off; true if the chunk filled up
+    auto drain = [&](auto& families, auto render) {
+        auto it = cursor.resuming ? families.upper_bound(cursor.last_family) : families.begin();
+        for (; it != families.end(); ++it) {
+            render(it->first, it->second);
+            if (format == ExpositionFormat::PrometheusText) {
+                buffer += "\n";
+            }
+            if (buffer.size() >= exposition_chunk_size_) {
+                cursor.last_family = it->first;
+                cursor.resuming = true;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (; cursor.shard < shards_.size(); ++cursor.shard, cursor.kind = 0) {
+        MetricShard& shard = shards_[cursor.shard];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        for (; cursor.kind < static_cast<int>(family_kind_count_); ++cursor.kind, cursor.resuming = false) {
+            bool full = false;
+            switch (cursor.kind) {
+            case 0:
+                // Export Counters (per-thread cells are summed here)
+                full = drain(shard.counter_families, [&](const std::string& name, SumFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatSumFamilyAsProtobuf(name, family, true, buffer);
+                    else if (format == ExpositionFormat::OpenMetricsText) formatCounterForOpenMetrics(name, family, buffer);
+                    else formatCounterForPrometheus(name, family, buffer);
+                });
+                break;
+            case 1:
+                // Export UpDownCounters
+                full = drain(shard.updowncounter_families, [&](const std::string& name, SumFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatSumFamilyAsProtobuf(name, family, false, buffer);
+                    else formatUpDownCounterForPrometheus(name, family, format, buffer);
+                });
+                break;
+            case 2:
+                // Export Histograms
+                full = drain(shard.histogram_families, [&](const std::string& name, HistogramFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatHistogramAsProtobuf(name, family, buffer);
+                    else formatHistogramForPrometheus(name, family, format, buffer);
+                });
+                break;
+            case 3:
+                // Export exponential Histograms
+                full = drain(shard.exponential_histogram_families, [&](const std::string& name, ExponentialHistogramFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatExponentialHistogramAsProtobuf(name, family, buffer);
+                    else formatExponentialHistogramForPrometheus(name, family, format, buffer);
+                });
+                break;
+            case 4:
+                // Export Summaries
+                full = drain(shard.summary_families, [&](const std::string& name, SummaryFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatSummaryAsProtobuf(name, family, buffer);
+                    else formatSummaryForPrometheus(name, family, format, buffer);
+                });
+                break;
+            default:
+                // Export Gauges
+                full = drain(shard.gauge_families, [&](const std::string& name, GaugeFamily& family) {
+                    if (format == ExpositionFormat::Protobuf) formatGaugeAsProtobuf(name, family, buffer);
+                    else formatGaugeForPrometheus(name, family, format, buffer);
+                });
+                break;
+            }
+            if (full) {
+                return true;
+            }
+        }
+    }
+
+    appendMemorySelfMetrics(format, buffer);
+    if (format == ExpositionFormat::OpenMetricsText) {
+        buffer += "# EOF\n";
+    }
+    cursor.finished = true;
+    return !buffer.empty();
+}
+
+/**
+ * @brief Appends a family's HELP/TYPE lines.
+ *
+ * The sanitized name and each format's header are rendered on the first scrape
+ * in that format and again only if the family's description has changed since.
+ * The formats are cached apart because OpenMetrics also escapes quotes in HELP
+ * and names a counter family without its _total suffix.
+ * @param render Family render cache.
+ * @param name Metric name.
+ * @param descriptor Family descriptor.
+ * @param prometheus_type Prometheus TYPE of the family.
+ * @param format PrometheusText or OpenMetricsText.
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::appendFamilyHeader(FamilyRender& render, const std::string& name,
+    const metrics_sdk::InstrumentDescriptor& descriptor, const char* prometheus_type,
+    ExpositionFormat format, std::string& output) {
+
+    if (render.description != descriptor.description_) {
+        render.description = descriptor.description_;
+        for (std::string& header : render.headers) {
+            header.clear();
+        }
+    }
+
+    const bool openmetrics = format == ExpositionFormat::OpenMetricsText;
+    std::string& header = render.headers[openmetrics ? 1 : 0];
+    if (header.empty()) {
+        std::string_view family_name = familyName(render, name);
+        if (openmetrics && std::strcmp(prometheus_type, "counter") == 0 && family_name.size() > 6 &&
+            family_name.substr(family_name.size() - 6) == "_total") {
+            family_name.remove_suffix(6);
+        }
+
+        // HELP comment
+        if (!render.description.empty()) {
+            TextWriter::append(header, "# HELP ");
+            TextWriter::append(header, family_name);
+            TextWriter::append(header, " ");
+            if (openmetrics) TextWriter::appendOpenMetricsHelp(header, render.description);
+            else TextWriter::appendHelp(header, render.description);
+            TextWriter::append(header, "\n");
+        }
+
+        // TYPE comment
+        TextWriter::append(header, "# TYPE ");
+        TextWriter::append(header, family_name);
+        TextWriter::append(header, " ");
+        TextWriter::append(header, prometheus_type);
+        TextWriter::append(header, "\n");
+    }
+    output += header;
+}
+
+/**
+ * @brief Appends the samples of a counter/updowncounter family.
+ *
+ * Each series is summed across its cells; its line is re-rendered only when
+ * that total differs from the one rendered at the previous scrape. OpenMetrics
+ * counter samples must end in _total; when the metric name does not, the cached
+ * line is written with the suffixed name in front of its labels and value.
+ * @param family Sum family (caller holds its shard's mutex).
+ * @param format PrometheusText, or OpenMetricsText for a counter family.
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::appendSumSamples(SumFamily& family, ExpositionFormat format, std::string& output) {
+    FamilyRender& render = family.render;
+    render.series.resize(family.series.size());
+    const std::string& sanitized_name = render.sanitized_name;
+    const bool add_total = format == ExpositionFormat::OpenMetricsText &&
+        !(sanitized_name.size() > 6 && sanitized_name.compare(sanitized_name.size() - 6, 6, "_total") == 0);
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        double value = entry.value->read();
+        uint64_t key;
+        std::memcpy(&key, &value, sizeof(key));
+
+        if (!cached.valid || cached.rendered_key != key) {
+            cached.lines.clear();
+            appendSample(cached.lines, sanitized_name, seriesLabels(cached, entry.labels), value);
+            cached.rendered_key = key;
+            cached.valid = true;
+        }
+        if (add_total) {
+            output += sanitized_name;
+            output += "_total";
+            output.append(cached.lines, sanitized_name.size(), std::string::npos);
+        }
+        else {
+            output += cached.lines;
+        }
+    }
+}
+
+/**
+ * @brief Appends a Counter metric in Prometheus format.
+ * @param name Metric name.
+ * @param family Counter family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatCounterForPrometheus(const std::string& name,
+    SumFamily& family, std::string& output) {
+
+    appendFamilyHeader(family.render, name, family.descriptor, "counter", ExpositionFormat::PrometheusText, output);
+    appendSumSamples(family, ExpositionFormat::PrometheusText, output);
+}
+
+/**
+ * @brief Appends an UpDownCounter metric in Prometheus format.
+ * @param name Metric name.
+ * @param family UpDownCounter family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatUpDownCounterForPrometheus(const std::string& name,
+    SumFamily& family, ExpositionFormat format, std::string& output) {
+
+    // UpDownCounter becomes gauge in Prometheus
+    appendFamilyHeader(family.render, name, family.descriptor, "gauge", format, output);
+    appendSumSamples(family, ExpositionFormat::PrometheusText, output);
+}
+
+/**
+ * @brief Appends a Histogram metric in Prometheus format.
+ *
+ * Bucket counts are made cumulative here, at export time, rather than on every
+ * write. A series is re-rendered only if its count moved since the last scrape.
+ * @param name Metric name.
+ * @param family Histogram family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatHistogramForPrometheus(const std::string& name,
+    HistogramFamily& family, ExpositionFormat format, std::string& output) {
+
+    FamilyRender& render = family.render;
+    appendFamilyHeader(render, name, family.descriptor, "histogram", format, output);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const HistogramState& state = entry.value;
+        if (cached.valid && cached.rendered_key == state.count) {
+            output += cached.lines;
+            continue;
+        }
+
+        const std::string& sanitized_name = render.sanitized_name;
+        const std::string& attributes_str = seriesLabels(cached, entry.labels);
+        std::string& lines = cached.lines;
+        lines.clear();
+
+        // Histogram buckets (cumulative counts are summed here, at export time)
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i <= family.boundaries.size(); ++i) {
+            cumulative += state.bucket_counts[i];
+            const double upper_bound = i < family.boundaries.size()
+                ? family.boundaries[i] : std::numeric_limits<double>::infinity();
+            appendBucketSample(lines, sanitized_name, attributes_str, upper_bound, cumulative);
+        }
+        appendCountAndSum(lines, sanitized_name, attributes_str, state.count, state.sum);
+
+        cached.rendered_key = state.count;
+        cached.valid = true;
+        output += cached.lines;
+    }
+}
+
+/**
+ * @brief Appends an exponential Histogram metric in Prometheus format.
+ *
+ * Text formats have no native histograms, so each series is written as a
+ * classic histogram with power-of-two bounds (see ExponentialHistogram::classicBuckets).
+ * @param name Metric name.
+ * @param family Exponential histogram family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatExponentialHistogramForPrometheus(const std::string& name,
+    ExponentialHistogramFamily& family, ExpositionFormat format, std::string& output) {
+
+    FamilyRender& render = family.render;
+    appendFamilyHeader(render, name, family.descriptor, "histogram", format, output);
+    render.series.resize(family.series.size());
+
+    thread_local std::vector<ExponentialHistogram::ClassicBucket> buckets;
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const ExponentialHistogram& state = entry.value;
+        if (cached.valid && cached.rendered_key == state.count()) {
+            output += cached.lines;
+            continue;
+        }
+
+        const std::string& sanitized_name = render.sanitized_name;
+        const std::string& attributes_str = seriesLabels(cached, entry.labels);
+        std::string& lines = cached.lines;
+        lines.clear();
+
+        state.classicBuckets(buckets);
+        for (const auto& bucket : buckets) {
+            appendBucketSample(lines, sanitized_name, attributes_str, bucket.upper_bound, bucket.cumulative_count);
+        }
+        appendBucketSample(lines, sanitized_name, attributes_str, std::numeric_limits<double>::infinity(), state.count());
+        appendCountAndSum(lines, sanitized_name, attributes_str, state.count(), state.sum());
+
+        cached.rendered_key = state.count();
+        cached.valid = true;
+        output += cached.lines;
+    }
+}
+
+/**
+ * @brief Appends a Summary metric in Prometheus format.
+ *
+ * Each series is written as one quantile sample per configured quantile,
+ * estimated from its sketch, followed by _count and _sum.
+ * @param name Metric name.
+ * @param family Summary family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatSummaryForPrometheus(const std::string& name,
+    SummaryFamily& family, ExpositionFormat format, std::string& output) {
+
+    FamilyRender& render = family.render;
+    appendFamilyHeader(render, name, family.descriptor, "summary", format, output);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const QuantileSketch& state = entry.value;
+        if (cached.valid && cached.rendered_key == state.count()) {
+            output += cached.lines;
+            continue;
+        }
+
+        const std::string& sanitized_name = render.sanitized_name;
+        const std::string& attributes_str = seriesLabels(cached, entry.labels);
+        std::string& lines = cached.lines;
+        lines.clear();
+
+        for (double quantile : family.quantiles) {
+            appendQuantileSample(lines, sanitized_name, attributes_str, quantile, state.quantile(quantile));
+        }
+        appendCountAndSum(lines, sanitized_name, attributes_str, state.count(), state.sum());
+
+        cached.rendered_key = state.count();
+        cached.valid = true;
+        output += cached.lines;
+    }
+}
+
+/**
+ * @brief Appends a Gauge metric in Prometheus format.
+ * @param name Metric name.
+ * @param family Gauge family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatGaugeForPrometheus(const std::string& name,
+    GaugeFamily& family, ExpositionFormat format, std::string& output) {
+
+    FamilyRender& render = family.render;
+    appendFamilyHeader(render, name, family.descriptor, "gauge", format, output);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const double current = entry.value.read();
+        uint64_t key;
+        std::memcpy(&key, &current, sizeof(key));
+
+        if (!cached.valid || cached.rendered_key != key) {
+            cached.lines.clear();
+            appendSample(cached.lines, render.sanitized_name, seriesLabels(cached, entry.labels), current);
+            cached.rendered_key = key;
+            cached.valid = true;
+        }
+        output += cached.lines;
+    }
+}
+
+/**
+ * @brief Appends a Counter metric in OpenMetrics text format.
+ *
+ * OpenMetrics names the family without the _total suffix and requires it on
+ * the sample, so a metric submitted as "requests_total" and one submitted as
+ * "requests" both expose requests_total samples under family "requests". The
+ * samples come from the same per-series cache as the 0.0.4 text format.
+ * @param name Metric name.
+ * @param family Counter family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatCounterForOpenMetrics(const std::string& name,
+    SumFamily& family, std::string& output) {
+
+    appendFamilyHeader(family.render, name, family.descriptor, "counter", ExpositionFormat::OpenMetricsText, output);
+    appendSumSamples(family, ExpositionFormat::OpenMetricsText, output);
+}
+
+/**
+ * @brief Appends a counter/updowncounter family as a delimited protobuf MetricFamily.
+ * @param name Metric name.
+ * @param family Sum family (caller holds its shard's mutex).
+ * @param is_monotonic True for counters (COUNTER), false for updowncounters (GAUGE).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatSumFamilyAsProtobuf(const std::string& name,
+    SumFamily& family, bool is_monotonic, std::string& output) {
+
+    // Reused across families; encoding a Metric needs its body before its length
+    thread_local std::string metrics, metric, value;
+    metrics.clear();
+
+    FamilyRender& render = family.render;
+    familyName(render, name);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        metric = seriesProtoLabels(cached, entry.labels);
+        value.clear();
+        ProtoWriter::writeDouble(value, 1, entry.value->read());
+        // Metric.counter = 3, Metric.gauge = 2
+        ProtoWriter::writeMessage(metric, is_monotonic ? 3 : 2, value);
+        ProtoWriter::writeMessage(metrics, 4, metric);
+    }
+
+    // MetricType COUNTER = 0, GAUGE = 1
+    appendProtobufFamily(render, family.descriptor, is_monotonic ? 0 : 1, metrics, output);
+}
+
+/**
+ * @brief Appends a histogram family as a delimited protobuf MetricFamily.
+ *
+ * Buckets are sent with cumulative counts for every finite boundary; the +Inf
+ * bucket is implied by sample_count, as in the Prometheus client libraries.
+ * @param name Metric name.
+ * @param family Histogram family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatHistogramAsProtobuf(const std::string& name,
+    HistogramFamily& family, std::string& output) {
+
+    thread_local std::string metrics, metric, histogram, bucket;
+    metrics.clear();
+
+    FamilyRender& render = family.render;
+    familyName(render, name);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const HistogramState& state = entry.value;
+
+        histogram.clear();
+        ProtoWriter::writeUint64(histogram, 1, state.count);
+        ProtoWriter::writeDouble(histogram, 2, state.sum);
+        uint64_t cumulative = 0;
+        for (size_t i = 0; i < family.boundaries.size(); ++i) {
+            cumulative += state.bucket_counts[i];
+            bucket.clear();
+            ProtoWriter::writeUint64(bucket, 1, cumulative);
+            ProtoWriter::writeDouble(bucket, 2, family.boundaries[i]);
+            ProtoWriter::writeMessage(histogram, 3, bucket);
+        }
+
+        metric = seriesProtoLabels(cached, entry.labels);
+        ProtoWriter::writeMessage(metric, 7, histogram);
+        ProtoWriter::writeMessage(metrics, 4, metric);
+    }
+
+    // MetricType HISTOGRAM = 4
+    appendProtobufFamily(render, family.descriptor, 4, metrics, output);
+}
+
+/**
+ * @brief Appends an exponential histogram family as a delimited protobuf MetricFamily.
+ *
+ * Series are written as Prometheus native histograms: schema is the scale
+ * (downscaled to 8 if finer, the finest Prometheus accepts; histograms never
+ * go coarser than -4, the coarsest it accepts), and each sign is
+ * written as spans of delta-encoded counts. Prometheus indexes bucket (base^(i-1), base^i]
+ * as i, one above the OpenTelemetry index. The classic power-of-two buckets are
+ * included as well for scrapers with native histograms disabled.
+ * @param name Metric name.
+ * @param family Exponential histogram family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatExponentialHistogramAsProtobuf(const std::string& name,
+    ExponentialHistogramFamily& family, std::string& output) {
+
+    thread_local std::string metrics, metric, histogram, bucket, span;
+    thread_local std::vector<ExponentialHistogram::ClassicBucket> classic;
+    thread_local ExponentialHistogram::Buckets positive, negative;
+    metrics.clear();
+
+    FamilyRender& render = family.render;
+    familyName(render, name);
+    render.series.resize(family.series.size());
+
+    // Appends spans of non-empty buckets (gaps of up to two empty buckets stay inside a span) and their delta-encoded counts
+    auto append_buckets = [&](const ExponentialHistogram::Buckets& buckets, uint32_t span_field, uint32_t delta_field) {
+        const std::vector<uint64_t>& counts = buckets.counts;
+        size_t start = 0, last = counts.size();
+        while (start < last && counts[start] == 0) ++start;
+        while (last > start && counts[last - 1] == 0) --last;
+        if (start == last) {
+            return false;
+        }
+
+        size_t previous_end = 0;
+        int64_t previous_count = 0;
+        bool first_span = true;
+        while (start < last) {
+            size_t end = start + 1;
+            while (end < last) {
+                size_t gap_end = end;
+                while (counts[gap_end] == 0) ++gap_end;
+                if (gap_end - end > 2) {
+                    break;
+                }
+                end = gap_end + 1;
+            }
+
+            span.clear();
+            ProtoWriter::writeSint64(span, 1, first_span
+                ? buckets.offset + static_cast<int64_t>(start) + 1
+                : static_cast<int64_t>(start - previous_end));
+            ProtoWriter::writeUint64(span, 2, end - start);
+            ProtoWriter::writeMessage(histogram, span_field, span);
+            for (size_t i = start; i < end; ++i) {
+                const int64_t count = static_cast<int64_t>(counts[i]);
+                ProtoWriter::writeSint64(histogram, delta_field, count - previous_count);
+                previous_count = count;
+            }
+
+            previous_end = end;
+            first_span = false;
+            start = end;
+            while (start < last && counts[start] == 0) ++start;
+        }
+        return true;
+    };
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const ExponentialHistogram& state = entry.value;
+
+        histogram.clear();
+        ProtoWriter::writeUint64(histogram, 1, state.count());
+        ProtoWriter::writeDouble(histogram, 2, state.sum());
+        state.classicBuckets(classic);
+        for (const auto& classic_bucket : classic) {
+            bucket.clear();
+            ProtoWriter::writeUint64(bucket, 1, classic_bucket.cumulative_count);
+            ProtoWriter::writeDouble(bucket, 2, classic_bucket.upper_bound);
+            ProtoWriter::writeMessage(histogram, 3, bucket);
+        }
+
+        const int32_t change = state.scale() > 8 ? state.scale() - 8 : 0;
+        ExponentialHistogram::downscale(state.positive(), change, positive);
+        ExponentialHistogram::downscale(state.negative(), change, negative);
+        ProtoWriter::writeSint64(histogram, 5, state.scale() - change);
+        ProtoWriter::writeDouble(histogram, 6, 0.0);
+        ProtoWriter::writeUint64(histogram, 7, state.zeroCount());
+        const bool has_negative = append_buckets(negative, 9, 10);
+        const bool has_positive = append_buckets(positive, 12, 13);
+        if (!has_negative && !has_positive && state.zeroCount() == 0) {
+            // An empty span marks the histogram as native even with no observations
+            span.clear();
+            ProtoWriter::writeSint64(span, 1, 0);
+            ProtoWriter::writeUint64(span, 2, 0);
+            ProtoWriter::writeMessage(histogram, 12, span);
+        }
+
+        metric = seriesProtoLabels(cached, entry.labels);
+        ProtoWriter::writeMessage(metric, 7, histogram);
+        ProtoWriter::writeMessage(metrics, 4, metric);
+    }
+
+    // MetricType HISTOGRAM = 4
+    appendProtobufFamily(render, family.descriptor, 4, metrics, output);
+}
+
+/**
+ * @brief Appends a summary family as a delimited protobuf MetricFamily.
+ * @param name Metric name.
+ * @param family Summary family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatSummaryAsProtobuf(const std::string& name,
+    SummaryFamily& family, std::string& output) {
+
+    thread_local std::string metrics, metric, summary, quantile;
+    metrics.clear();
+
+    FamilyRender& render = family.render;
+    familyName(render, name);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        const QuantileSketch& state = entry.value;
+
+        summary.clear();
+        ProtoWriter::writeUint64(summary, 1, state.count());
+        ProtoWriter::writeDouble(summary, 2, state.sum());
+        for (double q : family.quantiles) {
+            quantile.clear();
+            ProtoWriter::writeDouble(quantile, 1, q);
+            ProtoWriter::writeDouble(quantile, 2, state.quantile(q));
+            ProtoWriter::writeMessage(summary, 3, quantile);
+        }
+
+        metric = seriesProtoLabels(cached, entry.labels);
+        ProtoWriter::writeMessage(metric, 4, summary);
+        ProtoWriter::writeMessage(metrics, 4, metric);
+    }
+
+    // MetricType SUMMARY = 2
+    appendProtobufFamily(render, family.descriptor, 2, metrics, output);
+}
+
+/**
+ * @brief Appends a gauge family as a delimited protobuf MetricFamily.
+ * @param name Metric name.
+ * @param family Gauge family (caller holds its shard's mutex).
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::formatGaugeAsProtobuf(const std::string& name,
+    GaugeFamily& family, std::string& output) {
+
+    thread_local std::string metrics, metric, value;
+    metrics.clear();
+
+    FamilyRender& render = family.render;
+    familyName(render, name);
+    render.series.resize(family.series.size());
+
+    size_t index = 0;
+    for (const auto& entry : family.series) {
+        SeriesRender& cached = render.series[index++];
+        metric = seriesProtoLabels(cached, entry.labels);
+        value.clear();
+        ProtoWriter::writeDouble(value, 1, entry.value.read());
+        ProtoWriter::writeMessage(metric, 2, value);
+        ProtoWriter::writeMessage(metrics, 4, metric);
+    }
+
+    // MetricType GAUGE = 1
+    appendProtobufFamily(render, family.descriptor, 1, metrics, output);
+}
+
+/**
+ * @brief Wraps encoded Metric messages into a length-prefixed MetricFamily.
+ * @param render Family render cache (supplies the sanitized name).
+ * @param descriptor Family descriptor (supplies the help text).
+ * @param type Prometheus MetricType enum value.
+ * @param metrics Encoded repeated Metric fields.
+ * @param output Exposition buffer to append to.
+ */
+void IoTMetricsServer::appendProtobufFamily(const FamilyRender& render,
+    const metrics_sdk::InstrumentDescriptor& descriptor, uint64_t type,
+    const std::string& metrics, std::string& output) {
+
+    thread_local std::string header;
+    header.clear();
+    ProtoWriter::writeString(header, 1, render.sanitized_name);
+    if (!descriptor.description_.empty()) {
+        ProtoWriter::writeString(header, 2, descriptor.description_);
+    }
+    ProtoWriter::writeUint64(header, 3, type);
+
+    ProtoWriter::writeVarint(output, header.size() + metrics.size());
+    output += header;
+    output += metrics;
+}
+
+/**
+ * @brief Returns the sanitized family name, computing it on first use.
+ * @param render Family render cache.
+ * @param name Metric name.
+ * @return Sanitized name.
+ */
+const std::string& IoTMetricsServer::familyName(FamilyRender& render, const std::string& name) {
+    if (render.sanitized_name.empty()) {
+        render.sanitized_name = sanitizeMetricName(name);
+    }
+    return render.sanitized_name;
+}
+
+/**
+ * @brief Returns the formatted text labels of a series, rendering them on first use.
+ * @param cached Series render cache.
+ * @param labels Interned series attributes.
+ * @return Labels as {k="v",...}, or empty.
+ */
+const std::string& IoTMetricsServer::seriesLabels(SeriesRender& cached, const LabelSet& labels) {
+    if (!cached.labels_valid) {
+        cached.labels.clear();
+        formatAttributes(labels, cached.labels);
+        cached.labels_valid = true;
+    }
+    return cached.labels;
+}
+
+/**
+ * @brief Returns a series' labels as protobuf LabelPair fields, encoding them on first use.
+ * @param cached Series render cache.
+ * @param labels Interned series attributes.
+ * @return Encoded repeated Metric.label fields.
+ */
+const std::string& IoTMetricsServer::seriesProtoLabels(SeriesRender& cached, const LabelSet& labels) {
+    if (!cached.proto_labels_valid) {
+        std::string pair, key;
+        for (const auto& label : labels) {
+            pair.clear();
+            key.clear();
+            TextWriter::appendLabelName(key, label_pool_.view(label.key));
+            ProtoWriter::writeString(pair, 1, key);
+            ProtoWriter::writeString(pair, 2, label_pool_.view(label.value));
+            ProtoWriter::writeMessage(cached.proto_labels, 1, pair);
+        }
+        cached.proto_labels_valid = true;
+    }
+    return cached.proto_labels;
+}
+
+/**
+ * @brief Appends interned series attributes in Prometheus label syntax.
+ *
+ * Label names are sanitized and values escaped; nothing is written for an
+ * empty label set.
+ * @param labels Interned attributes, in key order.
+ * @param output Buffer to append {k="v",...} to.
+ */
+void IoTMetricsServer::formatAttributes(const LabelSet& labels, std::string& output) {
+    if (labels.empty()) {
+        return;
+    }
+
+    TextWriter::append(output, "{");
+    bool first = true;
+    for (const auto& label : labels) {
+        if (!first) {
+            TextWriter::append(output, ",");
+        }
+        TextWriter::appendLabelName(output, label_pool_.view(label.key));
+        TextWriter::append(output, "=\"");
+        TextWriter::appendLabelValue(output, label_pool_.view(label.value));
+        TextWriter::append(output, "\"");
+        first = false;
+    }
+    TextWriter::append(output, "}");
+}
+
+/**
+ * @brief Appends one sample line: name, labels, a space, the value and a newline.
+ * @param output Buffer to append to.
+ * @param name Sample name (may be empty if the caller already wrote it).
+ * @param labels Formatted labels (may be empty).
+ * @param value Sample value.
+ */
+void IoTMetricsServer::appendSample(std::string& output, std::string_view name,
+    std::string_view labels, double value) {
+    TextWriter::append(output, name);
+    TextWriter::append(output, labels);
+    TextWriter::append(output, " ");
+    TextWriter::appendDouble(output, value);
+    TextWriter::append(output, "\n");
+}
+
+/**
+ * @brief Appends one histogram bucket line.
+ *
+ * The le label goes first, followed by the series labels.
+ * @param output Buffer to append to.
+ * @param name Sanitized metric name.
+ * @param labels Formatted series labels (may be empty).
+ * @param upper_bound Bucket bound (+Inf for the last bucket).
+ * @param cumulative_count Observations at or below the bound.
+ */
+void IoTMetricsServer::appendBucketSample(std::string& output, std::string_view name,
+    std::string_view labels, double upper_bound, uint64_t cumulative_count) {
+    TextWriter::append(output, name);
+    TextWriter::append(output, "_bucket{le=\"");
+    TextWriter::appendDouble(output, upper_bound);
+    if (labels.empty()) {
+        TextWriter::append(output, "\"}");
+    }
+    else {
+        // Series labels without their opening brace
+        TextWriter::append(output, "\",");
+        TextWriter::append(output, labels.substr(1));
+    }
+    TextWriter::append(output, " ");
+    TextWriter::appendUint(output, cumulative_count);
+    TextWriter::append(output, "\n");
+}
+
+/**
+ * @brief Appends one summary quantile line.
+ *
+ * The quantile label goes first, followed by the series labels.
+ * @param output Buffer to append to.
+ * @param name Sanitized metric name.
+ * @param labels Formatted series labels (may be empty).
+ * @param quantile Quantile in [0, 1].
+ * @param value Estimated value at the quantile (NaN for an empty series).
+ */
+void IoTMetricsServer::appendQuantileSample(std::string& output, std::string_view name,
+    std::string_view labels, double quantile, double value) {
+    TextWriter::append(output, name);
+    TextWriter::append(output, "{quantile=\"");
+    TextWriter::appendDouble(output, quantile);
+    if (labels.empty()) {
+        TextWriter::append(output, "\"}");
+    }
+    else {
+        TextWriter::append(output, "\",");
+        TextWriter::append(output, labels.substr(1));
+    }
+    appendSample(output, "", "", value);
+}
+
+/**
+ * @brief Appends a histogram's _count and _sum lines.
+ * @param output Buffer to append to.
+ * @param name Sanitized metric name.
+ * @param labels Formatted series labels (may be empty).
+ * @param count Number of observations.
+ * @param sum Sum of observations.
+ */
+void IoTMetricsServer::appendCountAndSum(std::string& output, std::string_view name,
+    std::string_view labels, uint64_t count, double sum) {
+    TextWriter::append(output, name);
+    TextWriter::append(output, "_count");
+    TextWriter::append(output, labels);
+    TextWriter::append(output, " ");
+    TextWriter::appendUint(output, count);
+    TextWriter::append(output, "\n");
+    TextWriter::append(output, name);
+    TextWriter::append(output, "_sum");
+    appendSample(output, "", labels, sum);
+}
+/**
+ * @brief Sanitizes a metric name for Prometheus compatibility.
+ * @param name Metric name.
+ * @return Sanitized metric name.
+ */
+std::string IoTMetricsServer::sanitizeMetricName(const std::string& name) {
+    std::string sanitized = name;
+
+    // Replace invalid characters with underscores
+    for (char& c : sanitized) {
+        if (!std::isalnum(c) && c != '_' && c != ':') {
+            c = '_';
+        }
+    }
+
+    return sanitized;
+}
+
+//==============================================================================
+// METRIC RECORDING METHODS - USING UNIQUE_PTR STORAGE
+//==============================================================================
+
+/**
+ * @brief Records a metric of any supported type.
+ * @param metric_name Name of the metric.
+ * @param instrument_type Type of instrument ("counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge").
+ * @param value Value to record.
+ * @param attributes Key-value attributes for the metric.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @param boundaries Histogram bucket boundaries to register (empty for the configured ones).
+ * @return Write-ahead log sequence number of the write (0 if it was not logged).
+ * @note With persistence on, the write is also appended to the write-ahead log (unless it went to a value slot).
+ */
+uint64_t IoTMetricsServer::recordMetric(const std::string& metric_name,
+    const std::string& instrument_type,
+    double value,
+    const std::map<std::string, std::string>& attributes,
+    const std::string& unit,
+    const std::string& description,
+    const std::vector<double>& boundaries) {
+
+    // Log what we're recording (the attribute list is only built when debug logging is on)
+    if (Logger::instance().enabled(LogLevel::Debug)) {
+        std::string attributes_str;
+        for (const auto& [key, val] : attributes) {
+            attributes_str += attributes_str.empty() ? " with attributes: {" : ", ";
+            attributes_str += key + "=" + val;
+        }
+        if (!attributes_str.empty()) attributes_str += "}";
+        LOG_DEBUG("Creating MetricData: %s (%s) = %g%s%s%s", metric_name.c_str(), instrument_type.c_str(),
+            value, unit.empty() ? "" : " ", unit.c_str(), attributes_str.c_str());
+    }
+
+    // With persistence on, a snapshot cannot cut the log between applying and logging the write
+    std::shared_lock<std::shared_mutex> persistence_lock = lockForWrite();
+
+    MetricShard& shard = shardFor(metric_name);
+    std::unique_lock<std::mutex> shard_lock(shard.mutex, std::defer_lock);
+    const bool in_slot =
+        applyMetric(shard, shard_lock, metric_name, instrument_type, value, attributes, unit, description, boundaries);
+
+    if (wal_ && !in_slot) {
+        thread_local std::string record;
+        record.clear();
+        appendBinaryFrame(record, metric_name, instrument_type, value, attributes, unit, description, boundaries);
+        return wal_->append(record);
+    }
+    return 0;
+}
+
+/**
+ * @brief Gets the shard that owns a metric name.
+ * @param name Metric name.
+ * @return The owning shard.
+ */
+IoTMetricsServer::MetricShard& IoTMetricsServer::shardFor(std::string_view name) {
+    return shards_[std::hash<std::string_view>{}(name) % metric_shard_count_];
+}
+
+/**
+ * @brief Records a batch of metrics, applying each metric name's points under one lock acquisition.
+ *
+ * Points for the same metric keep their submission order, so gauges end on the last value sent.
+ * With persistence on, the batch is then logged as one write-ahead log record
+ * (leaving out points that went to value slots).
+ * @param points Validated metric points.
+ * @return Write-ahead log sequence number of the batch (0 if nothing was logged).
+ */
+uint64_t IoTMetricsServer::recordMetricBatch(const std::vector<MetricPoint>& points) {
+    std::shared_lock<std::shared_mutex> persistence_lock = lockForWrite();
+
+    // Group points by metric name (views into the points, which outlive the map)
+    std::unordered_map<std::string_view, std::vector<const MetricPoint*>> groups;
+    groups.reserve(points.size());
+    for (const auto& point : points) {
+        groups[point.metric_name].push_back(&point);
+    }
+
+    // Frames of the points that did not go to a value slot; the whole batch is one log record,
+    // so it is replayed all or nothing
+    thread_local std::string record;
+    record.clear();
+    auto log_point = [&](const MetricPoint& point) {
+        if (wal_) {
+            appendBinaryFrame(record, point.metric_name, point.instrument_type, point.value, point.attributes,
+                point.unit, point.description, point.boundaries);
+        }
+    };
+
+    thread_local std::vector<double> histogram_values;
+    for (const auto& [name, group] : groups) {
+        MetricShard& shard = shardFor(name);
+        std::unique_lock<std::mutex> shard_lock(shard.mutex, std::defer_lock);
+        for (size_t i = 0; i < group.size();) {
+            const MetricPoint* point = group[i];
+            if (point->instrument_type != "histogram") {
+                if (!applyMetric(shard, shard_lock, point->metric_name, point->instrument_type, point->value,
+                    point->attributes, point->unit, point->description, point->boundaries)) {
+                    log_point(*point);
+                }
+                ++i;
+                continue;
+            }
+
+            // Consecutive observations of one histogram series are binned together
+            histogram_values.clear();
+            size_t run_end = i;
+            while (run_end < group.size() && group[run_end]->instrument_type == "histogram" &&
+                group[run_end]->attributes == point->attributes &&
+                group[run_end]->boundaries == point->boundaries) {
+                histogram_values.push_back(group[run_end]->value);
+                ++run_end;
+            }
+            if (!shard_lock.owns_lock()) shard_lock.lock();
+            if (admitFamily(shard.histogram_families, point->metric_name)) {
+                recordHistogramMetricData(shard, point->metric_name, histogram_values.data(), histogram_values.size(),
+                    point->attributes, point->unit, point->description, point->boundaries);
+            }
+            else {
+                for (double value : histogram_values) {
+                    applyOverflowMetric(shard_lock, point->instrument_type, value, point->boundaries);
+                }
+            }
+            for (; i < run_end; ++i) {
+                log_point(*group[i]);
+            }
+        }
+    }
+
+    if (!record.empty()) {
+        return wal_->append(record);
+    }
+    return 0;
+}
+
+/**
+ * @brief Waits until logged writes are synced to disk.
+ *
+ * HTTP handlers call this before acknowledging, so a 2xx response means the
+ * writes survive a crash. Writes to value slots are not logged (sequence 0) and
+ * are persisted through the mapping. With IOT_METRICS_WAL_ASYNC set, it returns
+ * at once and up to one commit interval of acknowledged writes can be lost.
+ * @param sequence Largest sequence number returned for the request's writes.
+ * @throws std::runtime_error if the commit holding the writes failed.
+ */
+void IoTMetricsServer::awaitDurable(uint64_t sequence) {
+    if (sequence == 0 || !wal_ || wal_async_) {
+        return;
+    }
+    if (!wal_->waitFor(sequence)) {
+        throw std::runtime_error("the write was applied but could not be written to the write-ahead log");
+    }
+}
+
+/**
+ * @brief Dispatches a metric to the recorder for its instrument type.
+ *
+ * shard_lock is acquired on first need and left held for the caller's next point.
+ * Counter and updowncounter writes to series already in the calling thread's
+ * cache never take it. A write to a new metric past max_metrics_ goes to the
+ * type's overflow metric instead (which may release shard_lock).
+ * @param shard Shard owning the metric.
+ * @param shard_lock Deferred lock on shard.mutex.
+ * @param metric_name Name of the metric.
+ * @param instrument_type Type of instrument ("counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge").
+ * @param value Value to record.
+ * @param attributes Key-value attributes for the metric.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @param boundaries Histogram bucket boundaries to register (empty for the configured ones).
+ * @return True if the write went to a series held in a value slot.
+ */
+bool IoTMetricsServer::applyMetric(MetricShard& shard,
+    std::unique_lock<std::mutex>& shard_lock,
+    const std::string& metric_name,
+    const std::string& instrument_type,
+    double value,
+    const std::map<std::string, std::string>& attributes,
+    const std::string& unit,
+    const std::string& description,
+    const std::vector<double>& boundaries) {
+
+    if (instrument_type == "counter") {
+        return recordCounterMetricData(shard, shard_lock, metric_name, value, attributes, unit, description);
+    }
+    else if (instrument_type == "updowncounter") {
+        return recordUpDownCounterMetricData(shard, shard_lock, metric_name, value, attributes, unit, description);
+    }
+    else if (instrument_type == "histogram") {
+        if (!shard_lock.owns_lock()) shard_lock.lock();
+        if (!admitFamily(shard.histogram_families, metric_name)) {
+            return applyOverflowMetric(shard_lock, instrument_type, value, boundaries);
+        }
+        recordHistogramMetricData(shard, metric_name, &value, 1, attributes, unit, description, boundaries);
+    }
+    else if (instrument_type == "exponential_histogram") {
+        if (!shard_lock.owns_lock()) shard_lock.lock();
+        if (!admitFamily(shard.exponential_histogram_families, metric_name)) {
+            return applyOverflowMetric(shard_lock, instrument_type, value, boundaries);
+        }
+        recordExponentialHistogramMetricData(shard, metric_name, value, attributes, unit, description);
+    }
+    else if (instrument_type == "summary") {
+        if (!shard_lock.owns_lock()) shard_lock.lock();
+        if (!admitFamily(shard.summary_families, metric_name)) {
+            return applyOverflowMetric(shard_lock, instrument_type, value, boundaries);
+        }
+        recordSummaryMetricData(shard, metric_name, value, attributes, unit, description);
+    }
+    else if (instrument_type == "gauge") {
+        if (!shard_lock.owns_lock()) shard_lock.lock();
+        if (!admitFamily(shard.gauge_families, metric_name)) {
+            return applyOverflowMetric(shard_lock, instrument_type, value, boundaries);
+        }
+        return recordGaugeMetricData(shard, metric_name, value, attributes, unit, description);
+    }
+    else {
+        throw std::invalid_argument("Unsupported OpenTelemetry instrument type: " + instrument_type);
+    }
+    return false;
+}
+
+/**
+ * @brief Records one value into a histogram series.
+ * @param value Value to record.
+ * @param boundaries The family's bucket boundaries.
+ * @return Index of the bucket the value fell into.
+ */
+size_t IoTMetricsServer::HistogramState::observe(double value, const std::vector<double>& boundaries) {
+    count++;
+    sum += value;
+    min = std::min(min, value);
+    max = std::max(max, value);
+
+    size_t bucket_index = BucketLocator::locate(value, boundaries.data(), boundaries.size());
+    bucket_counts[bucket_index]++;
+    return bucket_index;
+}
+
+/**
+ * @brief Records an array of values into a histogram series.
+ *
+ * Bucket counts stay per-bucket; cumulative counts are only formed at export.
+ * @param values Values to record.
+ * @param value_count Number of values.
+ * @param boundaries The family's bucket boundaries.
+ */
+void IoTMetricsServer::HistogramState::observeMany(const double* values, size_t value_count,
+    const std::vector<double>& boundaries) {
+    for (size_t i = 0; i < value_count; ++i) {
+        sum += values[i];
+        min = std::min(min, values[i]);
+        max = std::max(max, values[i]);
+    }
+    count += value_count;
+    BucketLocator::binMany(values, value_count, boundaries.data(), boundaries.size(), bucket_counts.data());
+}
+
+/**
+ * @brief Constructs an in-memory series with zeroed cells.
+ */
+IoTMetricsServer::SumSeries::SumSeries()
+    : cells(std::make_unique<std::array<SumCell, sum_cell_count_>>())
+{
+}
+
+/**
+ * @brief Constructs a series whose total lives in a slot, with zeroed cells.
+ * @param value_slot Slot holding the total.
+ */
+IoTMetricsServer::SumSeries::SumSeries(SlotStore::Handle value_slot)
+    : cells(std::make_unique<std::array<SumCell, sum_cell_count_>>())
+    , slot(std::move(value_slot))
+    , slot_backed(static_cast<bool>(slot))
+{
+}
+
+/**
+ * @brief Moves the total into a slot.
+ * @note Caller holds the shard lock.
+ * @param value_slot Slot to hold the total.
+ */
+void IoTMetricsServer::SumSeries::moveToSlot(SlotStore::Handle value_slot) {
+    value_slot.store(0.0);
+    slot = std::move(value_slot);
+    slot_backed = true;
+    fold();
+}
+
+/**
+ * @brief Adds a value to the calling thread's cell.
+ *
+ * Threads are assigned cells round-robin on first use, so with up to
+ * sum_cell_count_ workers no two threads share a cache line. Slot-backed
+ * series stripe their writes the same way; fold() moves them into the slot.
+ * The last-update stamp is only written when the coarse clock has moved, so
+ * steady writes do not bounce its cache line between threads.
+ * @param value Value to add.
+ * @param now Coarse time of the write, in seconds.
+ */
+void IoTMetricsServer::SumSeries::add(double value, int64_t now) {
+    static std::atomic<size_t> next_cell{ 0 };
+    thread_local const size_t cell_index = next_cell.fetch_add(1, std::memory_order_relaxed) % sum_cell_count_;
+
+    std::atomic<double>& cell = (*cells)[cell_index].value;
+    double current = cell.load(std::memory_order_relaxed);
+    while (!cell.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+    if (last_update.load(std::memory_order_relaxed) != now) {
+        last_update.store(now);
+    }
+}
+
+/**
+ * @brief Moves what the cells hold into the slot.
+ *
+ * Each cell is swapped with zero, so a write racing the fold lands either in
+ * this fold or in the next one. Cells that are already zero are only read,
+ * which leaves idle series' cache lines alone.
+ * @note Caller holds the shard lock.
+ */
+void IoTMetricsServer::SumSeries::fold() {
+    if (!slot) {
+        return;
+    }
+    double folded = 0.0;
+    for (auto& cell : *cells) {
+        if (cell.value.load(std::memory_order_relaxed) != 0.0) {
+            folded += cell.value.exchange(0.0, std::memory_order_relaxed);
         }
     }
+    if (folded != 0.0) {
+        slot.add(folded);
+    }
+}
+
+/**
+ * @brief Sums the slot (if any) and all cells of the series.
+ * @note Caller holds the shard lock.
+ * @return The current total.
+ */
+double IoTMetricsServer::SumSeries::read() const {
+    double total = slot ? slot.load() : 0.0;
+    for (const auto& cell : *cells) {
+        total += cell.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Finds a series, creating it if the series limits allow.
+ *
+ * Once the family has max_series_per_metric_ series, or the store has
+ * max_series_, a write for a new series goes to the family's
+ * otel.metric.overflow="true" series instead and is counted in overflow_points;
+ * the refused series itself is counted (approximately, in fixed memory) in
+ * rejected_series. The overflow series is created on demand and exempt from the
+ * limits, so every write is still recorded and memory stays bounded. The
+ * returned entry is stamped with the current coarse time.
+ * @note Caller must hold the family's shard mutex.
+ * @param family Family to look in.
+ * @param name Metric name.
+ * @param attributes Key-value attributes.
+ * @param make_value Called to build the state of a new series.
+ * @param overflowed Set to true if the write was redirected (may be null).
+ * @return The series entry to update.
+ */
+template <typename Family, typename MakeValue>
+auto& IoTMetricsServer::findOrCreateSeries(Family& family, const std::string& name,
+    const std::map<std::string, std::string>& attributes, MakeValue&& make_value, bool* overflowed) {
+    const uint64_t fingerprint = fingerprintAttributes(attributes);
+    const int64_t now = clock_seconds_.load(std::memory_order_relaxed);
+    auto* entry = family.series.find(fingerprint,
+        [&](const LabelSet& labels) { return labelsMatch(labels, attributes); });
+    if (entry) {
+        entry->updated_at = now;
+        return *entry;
+    }
+    if (admitSeries(family.series.size())) {
+        LOG_DEBUG("Created series for %s (%zu in family)", name.c_str(), family.series.size() + 1);
+        auto& created = family.series.insert(fingerprint, internAttributes(attributes), make_value());
+        created.updated_at = now;
+        return created;
+    }
+
+    family.overflow_points++;
+    overflow_points_.fetch_add(1, std::memory_order_relaxed);
+    if (!family.rejected_series) {
+        family.rejected_series = std::make_unique<DistinctCounter>();
+    }
+    family.rejected_series->add(fingerprint);
+    rejected_series_.add(fingerprint ^ std::hash<std::string>{}(name));
+    if (overflowed) {
+        *overflowed = true;
+    }
+
+    const uint64_t overflow_fingerprint = fingerprintAttributes(overflow_attributes_);
+    entry = family.series.find(overflow_fingerprint,
+        [&](const LabelSet& labels) { return labelsMatch(labels, overflow_attributes_); });
+    if (!entry) {
+        LOG_WARN("Series limit reached for %s; further new series go to otel.metric.overflow", name.c_str());
+        series_count_.fetch_add(1, std::memory_order_relaxed);
+        entry = &family.series.insert(overflow_fingerprint, internAttributes(overflow_attributes_), make_value());
+    }
+    entry->updated_at = now;
+    return *entry;
+}
+
+/**
+ * @brief Reserves room for one new series under the per-metric and global limits.
+ * @param family_size Number of series the family already has.
+ * @return False if either limit has been reached.
+ */
+bool IoTMetricsServer::admitSeries(size_t family_size) {
+    if (family_size >= max_series_per_metric_) {
+        return false;
+    }
+    if (series_count_.fetch_add(1, std::memory_order_relaxed) >= max_series_) {
+        series_count_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks a metric against the metric limit, reserving room for it if it is new.
+ *
+ * The overflow metrics are exempt from the limit but still counted.
+ * @note Caller must hold the families' shard mutex and create the family if this returns true.
+ * @param families Families of the metric's type.
+ * @param name Metric name.
+ * @return False if the metric is new and max_metrics_ metrics already exist.
+ */
+template <typename Family>
+bool IoTMetricsServer::admitFamily(const std::map<std::string, Family>& families, const std::string& name) {
+    if (families.find(name) != families.end()) {
+        return true;
+    }
+    if (family_count_.fetch_add(1, std::memory_order_relaxed) < max_metrics_ ||
+        name.compare(0, 21, "otel_metric_overflow_") == 0) {
+        return true;
+    }
+    family_count_.fetch_sub(1, std::memory_order_relaxed);
+    rejected_metrics_.add(std::hash<std::string>{}(name));
+    return false;
+}
+
+/**
+ * @brief Gets a family for restored state, creating it if needed.
+ *
+ * Restored metrics were admitted when first written, so they are counted but
+ * not held to max_metrics_.
+ * @note Caller must hold the families' shard mutex.
+ * @param families Families of the metric's type.
+ * @param name Metric name.
+ * @return The family.
+ */
+template <typename Family>
+Family& IoTMetricsServer::restoredFamily(std::map<std::string, Family>& families, const std::string& name) {
+    auto [it, created] = families.try_emplace(name);
+    if (created) {
+        family_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return it->second;
+}
+
+/**
+ * @brief Gets the name of the metric that absorbs a type's writes to new metrics past max_metrics_.
+ *
+ * There is one such metric per instrument type, so all refused names share one
+ * family (and, within it, one otel.metric.overflow="true" series).
+ * @param instrument_type Instrument type of the refused write.
+ * @return The overflow metric name (empty for an unknown type).
+ */
+const std::string& IoTMetricsServer::overflowMetricName(const std::string& instrument_type) {
+    static const std::map<std::string, std::string, std::less<>> names = {
+        {"counter", "otel_metric_overflow_counter"},
+        {"updowncounter", "otel_metric_overflow_updowncounter"},
+        {"histogram", "otel_metric_overflow_histogram"},
+        {"exponential_histogram", "otel_metric_overflow_exponential_histogram"},
+        {"summary", "otel_metric_overflow_summary"},
+        {"gauge", "otel_metric_overflow_gauge"}
+    };
+    static const std::string none;
+    auto it = names.find(instrument_type);
+    return it != names.end() ? it->second : none;
+}
+
+/**
+ * @brief Records a write refused by the metric limit in its type's overflow metric.
+ *
+ * The overflow metric usually lives on another shard; the refused metric's
+ * shard lock is released before that one is taken, so no thread ever holds two.
+ * The callers take their lock again on their next point.
+ * @param shard_lock Lock on the refused metric's shard (held or not).
+ * @param instrument_type Instrument type of the write.
+ * @param value Value to record.
+ * @param boundaries Histogram bucket boundaries of the write (they register only
+ *        if the overflow histogram does not exist yet).
+ * @return True if the overflow series is held in a value slot.
+ */
+bool IoTMetricsServer::applyOverflowMetric(std::unique_lock<std::mutex>& shard_lock,
+    const std::string& instrument_type, double value, const std::vector<double>& boundaries) {
+    overflow_metric_points_.fetch_add(1, std::memory_order_relaxed);
+    const std::string& name = overflowMetricName(instrument_type);
+    MetricShard& shard = shardFor(name);
+    if (shard_lock.mutex() == &shard.mutex) {
+        return applyMetric(shard, shard_lock, name, instrument_type, value, overflow_attributes_, "",
+            overflow_metric_description_, boundaries);
+    }
+    if (shard_lock.owns_lock()) {
+        shard_lock.unlock();
+    }
+    std::unique_lock<std::mutex> overflow_lock(shard.mutex, std::defer_lock);
+    return applyMetric(shard, overflow_lock, name, instrument_type, value, overflow_attributes_, "",
+        overflow_metric_description_, boundaries);
+}
+
+/**
+ * @brief Records a key in the bitmap.
+ *
+ * The hash is remixed first (the splitmix64 finalizer), since the estimate
+ * assumes bits are picked at random and fingerprints of similar attributes are
+ * not. A bit that is already set is only read, so repeats of a key do not write
+ * the shared cache line.
+ * @param hash 64-bit hash of the key.
+ */
+void IoTMetricsServer::DistinctCounter::add(uint64_t hash) {
+    hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9ull;
+    hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBull;
+    const uint64_t index = (hash ^ (hash >> 31)) & 4095;
+    const uint64_t mask = uint64_t{ 1 } << (index & 63);
+    std::atomic<uint64_t>& word = bits[index >> 6];
+    if ((word.load(std::memory_order_relaxed) & mask) == 0) {
+        word.fetch_or(mask, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Estimates the number of distinct keys recorded.
+ *
+ * Linear counting: with m bits of which z are still clear, about
+ * m * ln(m / z) keys were seen. A full bitmap reports the saturation value.
+ * @return The estimate.
+ */
+uint64_t IoTMetricsServer::DistinctCounter::estimate() const {
+    constexpr double bit_count = 4096.0;
+    size_t set = 0;
+    for (const auto& word : bits) {
+        set += std::bitset<64>(word.load(std::memory_order_relaxed)).count();
+    }
+    const double clear = std::max(bit_count - static_cast<double>(set), 1.0);
+    return static_cast<uint64_t>(std::llround(bit_count * std::log(bit_count / clear)));
+}
 
-    output << "\n";
-    return output.str();
+/**
+ * @brief Returns the calling thread's series cache.
+ */
+IoTMetricsServer::SumSeriesCache& IoTMetricsServer::sumSeriesCache() {
+    thread_local SumSeriesCache cache;
+    return cache;
 }
 
 /**
- * @brief Formats an UpDownCounter metric for Prometheus.
+ * @brief Finds or creates a counter/updowncounter series.
+ *
+ * Each thread keeps its own map of the series it has written to, so repeat
+ * writes resolve without touching the shard. On a miss the shard is locked and
+ * the series is registered (the descriptor is filled in from the first write
+ * that carries a unit or description).
+ * @param shard Shard owning the metric.
+ * @param shard_lock Deferred lock on shard.mutex, taken on a cache miss.
+ * @param type kCounter or kUpDownCounter.
  * @param name Metric name.
- * @param metric_data Metric data.
- * @return Prometheus-formatted string.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @return The series to add into, or null if the metric is new and the metric
+ *         limit has been reached. The thread's cache holds a reference until
+ *         the series is retired; an overflowed series is not cached and is
+ *         returned with shard_lock held.
  */
-std::string IoTMetricsServer::formatUpDownCounterForPrometheus(const std::string& name,
-    const metrics_sdk::MetricData& metric_data) {
+IoTMetricsServer::SumSeries* IoTMetricsServer::findSumSeries(MetricShard& shard,
+    std::unique_lock<std::mutex>& shard_lock,
+    metrics_sdk::InstrumentType type,
+    const std::string& name,
+    const std::map<std::string, std::string>& attributes,
+    const std::string& unit,
+    const std::string& description) {
+
+    SumSeriesCache& cache = sumSeriesCache();
+    if (cache.owner != instance_id_) {
+        cache.entries[0].clear();
+        cache.entries[1].clear();
+        cache.owner = instance_id_;
+    }
+    const uint64_t generation = sum_eviction_generation_.load(std::memory_order_relaxed);
+    if (cache.generation != generation) {
+        // The sweeper evicted series since the last prune: release the ones this thread still holds
+        for (auto& by_name : cache.entries) {
+            for (auto it = by_name.begin(); it != by_name.end();) {
+                it->second.eraseIf([](const auto& entry) { return entry.value->retired.load(std::memory_order_relaxed); });
+                it = it->second.empty() ? by_name.erase(it) : std::next(it);
+            }
+        }
+        cache.generation = generation;
+    }
 
-    std::ostringstream output;
-    std::string sanitized_name = sanitizeMetricName(name);
+    const uint64_t fingerprint = fingerprintAttributes(attributes);
+    auto matches = [&](const LabelSet& labels) { return labelsMatch(labels, attributes); };
 
-    // HELP comment
-    if (!metric_data.instrument_descriptor.description_.empty()) {
-        output << "# HELP " << sanitized_name << " " << metric_data.instrument_descriptor.description_ << "\n";
+    auto& by_name = cache.entries[type == metrics_sdk::InstrumentType::kCounter ? 0 : 1];
+    auto cached_name = by_name.find(name);
+    if (cached_name != by_name.end()) {
+        if (auto* cached = cached_name->second.find(fingerprint, matches)) {
+            if (!cached->value->retired.load(std::memory_order_relaxed)) {
+                return cached->value.get();
+            }
+            // The sweeper evicted a series of this metric: forget the metric's cached series
+            by_name.erase(cached_name);
+        }
     }
 
-    // TYPE comment (UpDownCounter becomes gauge in Prometheus)
-    output << "# TYPE " << sanitized_name << " gauge\n";
+    if (!shard_lock.owns_lock()) shard_lock.lock();
 
-    // Metric data
-    for (const auto& point_data_attr : metric_data.point_data_attr_) {
-        const auto* sum_point = std::get_if<metrics_sdk::SumPointData>(&point_data_attr.point_data);
-        if (sum_point) {
-            std::string attributes_str = formatAttributes(point_data_attr.attributes);
+    auto& families = type == metrics_sdk::InstrumentType::kCounter
+        ? shard.counter_families : shard.updowncounter_families;
+    if (!admitFamily(families, name)) {
+        return nullptr;
+    }
+    SumFamily& family = families[name];
+    updateDescriptor(family.descriptor, type, name, unit, description);
+
+    bool overflowed = false;
+    bool created = false;
+    auto& entry = findOrCreateSeries(family, name, attributes, [&] {
+        auto series = std::make_shared<SumSeries>();
+        series->last_update.store(clock_seconds_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        created = true;
+        return series;
+    }, &overflowed);
+    if (created && slots_) {
+        const auto kind = type == metrics_sdk::InstrumentType::kCounter
+            ? BinaryInstrumentKind::Counter : BinaryInstrumentKind::UpDownCounter;
+        if (SlotStore::Handle slot = allocateSlot(kind, name, entry.labels, family.descriptor)) {
+            entry.value->moveToSlot(std::move(slot));
+        }
+    }
 
-            // Convert value variant to string safely
-            std::string value_str;
-            std::visit([&value_str](const auto& v) {
-                value_str = std::to_string(v);
-            }, sum_point->value_);
+    // Overflowed writes are not cached, so each one is counted under the shard lock
+    if (!overflowed) {
+        by_name[name].insert(fingerprint, entry.labels, entry.value);
+    }
+    return entry.value.get();
+}
 
-            output << sanitized_name << attributes_str << " " << value_str << "\n";
+/**
+ * @brief Adds a value to a counter/updowncounter series.
+ *
+ * The write stamps the series and then checks its retired mark. If the sweeper
+ * evicted the series in between, the shard lock settles whether the eviction
+ * stood; if it did, the value went to the dropped series and is added again to
+ * the series found (or created) afresh. A write to a new metric past
+ * max_metrics_ goes to the type's overflow metric.
+ * @param shard Shard owning the metric.
+ * @param shard_lock Deferred lock on shard.mutex, taken on a cache miss or after an eviction.
+ * @param type kCounter or kUpDownCounter.
+ * @param name Metric name.
+ * @param value Value to add.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @return True if the series the value ended up in is held in a value slot.
+ */
+bool IoTMetricsServer::recordSumValue(MetricShard& shard, std::unique_lock<std::mutex>& shard_lock,
+    metrics_sdk::InstrumentType type, const std::string& name, double value,
+    const std::map<std::string, std::string>& attributes, const std::string& unit,
+    const std::string& description) {
+    const int64_t now = clock_seconds_.load(std::memory_order_relaxed);
+    const char* instrument_type = type == metrics_sdk::InstrumentType::kCounter ? "counter" : "updowncounter";
+    SumSeries* series = findSumSeries(shard, shard_lock, type, name, attributes, unit, description);
+    if (!series) {
+        return applyOverflowMetric(shard_lock, instrument_type, value, {});
+    }
+    series->add(value, now);
+
+    if (series->retired.load()) {
+        if (!shard_lock.owns_lock()) shard_lock.lock();
+        if (series->retired.load(std::memory_order_relaxed)) {
+            // series may be released by this lookup; only fresh is used from here on
+            SumSeries* fresh = findSumSeries(shard, shard_lock, type, name, attributes, unit, description);
+            if (!fresh) {
+                return applyOverflowMetric(shard_lock, instrument_type, value, {});
+            }
+            fresh->add(value, now);
+            return fresh->slot_backed;
         }
     }
+    return series->slot_backed;
+}
+
+/**
+ * @brief Records a Counter metric.
+ *
+ * The value is added to the series total in the calling thread's cell; no lock
+ * is taken once the thread has seen the series.
+ * @param shard Shard owning the metric.
+ * @param shard_lock Deferred lock on shard.mutex, taken only to register a new series.
+ * @param name Metric name.
+ * @param value Value to record.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @return True if the series is held in a value slot.
+ */
+bool IoTMetricsServer::recordCounterMetricData(MetricShard& shard, std::unique_lock<std::mutex>& shard_lock, const std::string& name, double value, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description) {
+    const bool in_slot = recordSumValue(shard, shard_lock, metrics_sdk::InstrumentType::kCounter,
+        name, value, attributes, unit, description);
+
+    LOG_DEBUG("Counter incremented: %s += %g", name.c_str(), value);
+    return in_slot;
+}
+
+/**
+ * @brief Records an UpDownCounter metric.
+ *
+ * Uses the same per-thread cells as counters; the value may be negative.
+ * @param shard Shard owning the metric.
+ * @param shard_lock Deferred lock on shard.mutex, taken only to register a new series.
+ * @param name Metric name.
+ * @param value Value to record.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @return True if the series is held in a value slot.
+ */
+bool IoTMetricsServer::recordUpDownCounterMetricData(MetricShard& shard, std::unique_lock<std::mutex>& shard_lock, const std::string& name, double value, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description) {
+    const bool in_slot = recordSumValue(shard, shard_lock, metrics_sdk::InstrumentType::kUpDownCounter,
+        name, value, attributes, unit, description);
+
+    LOG_DEBUG("UpDownCounter updated: %s += %g", name.c_str(), value);
+    return in_slot;
+}
+
+/**
+ * @brief Records one or more values into a Histogram series.
+ *
+ * The series state is updated in place; no MetricData is built on the write path.
+ * @note Caller must hold shard.mutex.
+ * @param shard Shard owning the metric.
+ * @param name Metric name.
+ * @param values Values to record.
+ * @param value_count Number of values.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @param boundaries Bucket boundaries to register; used only when the family is created.
+ */
+void IoTMetricsServer::recordHistogramMetricData(MetricShard& shard, const std::string& name, const double* values, size_t value_count, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description, const std::vector<double>& boundaries) {
+    HistogramFamily& family = shard.histogram_families[name];
+    updateDescriptor(family.descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+
+    // Boundaries are fixed by the first write; later ones may repeat but not change them
+    if (family.boundaries.empty()) {
+        family.boundaries = resolveHistogramBoundaries(name, boundaries);
+    }
+    else if (!boundaries.empty() && boundaries != family.boundaries) {
+        histogram_boundary_conflicts_.fetch_add(1, std::memory_order_relaxed);
+        LOG_DEBUG("Ignoring boundaries for %s: they differ from the registered ones", name.c_str());
+    }
+
+    auto& entry = findOrCreateSeries(family, name, attributes,
+        [&] { return HistogramState(family.boundaries.size()); });
 
-    output << "\n";
-    return output.str();
+    // Update histogram state
+    HistogramState& state = entry.value;
+    if (value_count == 1) {
+        size_t bucket_index = state.observe(values[0], family.boundaries);
+        LOG_DEBUG("Histogram recorded: %s = %g (count=%llu, sum=%g, bucket=%zu)", name.c_str(), values[0],
+            static_cast<unsigned long long>(state.count), state.sum, bucket_index);
+    }
+    else {
+        state.observeMany(values, value_count, family.boundaries);
+        LOG_DEBUG("Histogram recorded: %s x%zu (count=%llu, sum=%g)", name.c_str(), value_count,
+            static_cast<unsigned long long>(state.count), state.sum);
+    }
 }
 
 /**
- * @brief Formats a Histogram metric for Prometheus.
+ * @brief Records a value into an exponential Histogram series.
+ * @note Caller must hold shard.mutex.
+ * @param shard Shard owning the metric.
  * @param name Metric name.
- * @param metric_data Metric data.
- * @return Prometheus-formatted string.
+ * @param value Value to record.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
  */
-std::string IoTMetricsServer::formatHistogramForPrometheus(const std::string& name,
-    const metrics_sdk::MetricData& metric_data) {
+void IoTMetricsServer::recordExponentialHistogramMetricData(MetricShard& shard, const std::string& name,
+    double value, const std::map<std::string, std::string>& attributes, const std::string& unit,
+    const std::string& description) {
+    ExponentialHistogramFamily& family = shard.exponential_histogram_families[name];
+    updateDescriptor(family.descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+
+    auto& entry = findOrCreateSeries(family, name, attributes, [] { return ExponentialHistogram(); });
+    ExponentialHistogram& state = entry.value;
+    state.record(value);
 
-    std::ostringstream output;
-    std::string sanitized_name = sanitizeMetricName(name);
+    LOG_DEBUG("Exponential histogram recorded: %s = %g (count=%llu, scale=%d)", name.c_str(), value,
+        static_cast<unsigned long long>(state.count()), state.scale());
+}
 
-    // HELP comment
-    if (!metric_data.instrument_descriptor.description_.empty()) {
-        output << "# HELP " << sanitized_name << " " << metric_data.instrument_descriptor.description_ << "\n";
+/**
+ * @brief Records a value into a Summary series.
+ *
+ * A new family reports the quantiles of its view, or the defaults.
+ * @note Caller must hold shard.mutex.
+ * @param shard Shard owning the metric.
+ * @param name Metric name.
+ * @param value Value to record.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ */
+void IoTMetricsServer::recordSummaryMetricData(MetricShard& shard, const std::string& name,
+    double value, const std::map<std::string, std::string>& attributes, const std::string& unit,
+    const std::string& description) {
+    SummaryFamily& family = shard.summary_families[name];
+    updateDescriptor(family.descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+    if (family.quantiles.empty()) {
+        auto view = summary_views_.find(name);
+        family.quantiles = view != summary_views_.end() ? view->second : default_summary_quantiles_;
     }
 
-    // TYPE comment
-    output << "# TYPE " << sanitized_name << " histogram\n";
+    auto& entry = findOrCreateSeries(family, name, attributes, [] { return QuantileSketch(); });
+    QuantileSketch& state = entry.value;
+    state.record(value);
 
-    // Metric data
-    for (const auto& point_data_attr : metric_data.point_data_attr_) {
-        const auto* hist_point = std::get_if<metrics_sdk::HistogramPointData>(&point_data_attr.point_data);
-        if (hist_point) {
-            std::string attributes_str = formatAttributes(point_data_attr.attributes);
+    LOG_DEBUG("Summary recorded: %s = %g (count=%llu)", name.c_str(), value,
+        static_cast<unsigned long long>(state.count()));
+}
 
-            // Histogram buckets
-            for (size_t i = 0; i < hist_point->boundaries_.size(); ++i) {
-                output << sanitized_name << "_bucket" << "{le=\"" << hist_point->boundaries_[i] << "\"";
-                if (!attributes_str.empty()) {
-                    // Remove the opening { and add comma
-                    output << "," << attributes_str.substr(1);
-                }
-                else {
-                    output << "}";
-                }
-                output << " " << hist_point->counts_[i] << "\n";
-            }
+/**
+ * @brief Picks the boundaries a new histogram family starts with.
+ * @param name Metric name.
+ * @param requested Boundaries from the submission (may be empty).
+ * @return The submitted boundaries, else the configured view, else the defaults.
+ */
+const std::vector<double>& IoTMetricsServer::resolveHistogramBoundaries(const std::string& name,
+    const std::vector<double>& requested) const {
+    if (!requested.empty()) {
+        return requested;
+    }
+    auto view = histogram_views_.find(name);
+    if (view != histogram_views_.end()) {
+        return view->second;
+    }
+    return default_histogram_boundaries_;
+}
 
-            // +Inf bucket
-            output << sanitized_name << "_bucket" << "{le=\"+Inf\"";
-            if (!attributes_str.empty()) {
-                output << "," << attributes_str.substr(1);
-            }
-            else {
-                output << "}";
-            }
-            output << " " << hist_point->counts_.back() << "\n";
+/**
+ * @brief Records a Gauge metric.
+ * @note Caller must hold shard.mutex.
+ * @param shard Shard owning the metric.
+ * @param name Metric name.
+ * @param value Value to record.
+ * @param attributes Key-value attributes.
+ * @param unit Unit of measurement.
+ * @param description Metric description.
+ * @return True if the series is held in a value slot.
+ */
+bool IoTMetricsServer::recordGaugeMetricData(MetricShard& shard, const std::string& name, double value,
+    const std::map<std::string, std::string>& attributes, const std::string& unit,
+    const std::string& description) {
+
+    GaugeFamily& family = shard.gauge_families[name];
+    updateDescriptor(family.descriptor, metrics_sdk::InstrumentType::kUpDownCounter, name, unit, description);
 
-            // Count and sum - handle variant types
-            output << sanitized_name << "_count" << attributes_str << " " << hist_point->count_ << "\n";
+    bool created = false;
+    auto& entry = findOrCreateSeries(family, name, attributes, [&] {
+        created = true;
+        return GaugeSeries();
+    });
+    if (created && slots_) {
+        entry.value.slot = allocateSlot(BinaryInstrumentKind::Gauge, name, entry.labels, family.descriptor);
+    }
+
+    // Set absolute value (no accumulation)
+    entry.value.set(value);
+    family.last_value = value;
+
+    LOG_DEBUG("Gauge set: %s = %g", name.c_str(), value);
+    return static_cast<bool>(entry.value.slot);
+}
+
+//==============================================================================
+// PERSISTENCE
+//==============================================================================
+
+/// @brief First bytes of every snapshot file (the "1" is the format version).
+static constexpr std::string_view snapshot_magic = "IOTSNAP1";
+
+/**
+ * @brief Appends a zigzag-encoded signed varint.
+ */
+static void appendSignedVarint(std::string& out, int64_t value) {
+    ProtoWriter::writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+/**
+ * @brief Reads a zigzag-encoded signed varint.
+ * @return true if a complete varint was read.
+ */
+static bool readSignedVarint(const uint8_t*& cursor, const uint8_t* end, int64_t& value) {
+    uint64_t raw = 0;
+    if (!readVarint(cursor, end, raw)) {
+        return false;
+    }
+    value = static_cast<int64_t>(raw >> 1) ^ -static_cast<int64_t>(raw & 1);
+    return true;
+}
+
+/**
+ * @brief Appends a list of doubles as a varint count followed by little-endian doubles.
+ */
+static void appendDoubles(std::string& out, const std::vector<double>& values) {
+    ProtoWriter::writeVarint(out, values.size());
+    for (double value : values) {
+        appendFixedDouble(out, value);
+    }
+}
+
+/**
+ * @brief Reads a list written by appendDoubles.
+ * @return true if the whole list was read.
+ */
+static bool readDoubles(const uint8_t*& cursor, const uint8_t* end, std::vector<double>& values) {
+    uint64_t count = 0;
+    if (!readVarint(cursor, end, count) || count > static_cast<uint64_t>(end - cursor) / 8) {
+        return false;
+    }
+    values.resize(static_cast<size_t>(count));
+    for (double& value : values) {
+        readFixedDouble(cursor, end, value);
+    }
+    return true;
+}
 
-            // Convert sum variant to string safely
-            std::string sum_str;
-            std::visit([&sum_str](const auto& v) {
-                sum_str = std::to_string(v);
-            }, hist_point->sum_);
+/**
+ * @brief Appends a bucket window as its zigzag offset, a varint count and a varint per bucket.
+ */
+static void appendBuckets(std::string& out, int32_t offset, const std::vector<uint64_t>& counts) {
+    appendSignedVarint(out, offset);
+    ProtoWriter::writeVarint(out, counts.size());
+    for (uint64_t count : counts) {
+        ProtoWriter::writeVarint(out, count);
+    }
+}
 
-            output << sanitized_name << "_sum" << attributes_str << " " << sum_str << "\n";
+/**
+ * @brief Reads a bucket window written by appendBuckets.
+ * @return true if the whole window was read.
+ */
+static bool readBuckets(const uint8_t*& cursor, const uint8_t* end, int32_t& offset, std::vector<uint64_t>& counts) {
+    int64_t raw_offset = 0;
+    uint64_t size = 0;
+    if (!readSignedVarint(cursor, end, raw_offset) || raw_offset < std::numeric_limits<int32_t>::min() ||
+        raw_offset > std::numeric_limits<int32_t>::max() ||
+        !readVarint(cursor, end, size) || size > static_cast<uint64_t>(end - cursor)) {
+        return false;
+    }
+    offset = static_cast<int32_t>(raw_offset);
+    counts.resize(static_cast<size_t>(size));
+    for (uint64_t& count : counts) {
+        if (!readVarint(cursor, end, count)) {
+            return false;
         }
     }
+    return true;
+}
 
-    output << "\n";
-    return output.str();
+/**
+ * @brief Parses a segment number from a file name of the form snapshot-<number>.bin.
+ * @return False if the name is not a snapshot name.
+ */
+static bool parseSnapshotName(const std::string& file_name, uint64_t& segment) {
+    const std::string_view prefix = "snapshot-", suffix = ".bin";
+    if (file_name.size() <= prefix.size() + suffix.size() ||
+        file_name.compare(0, prefix.size(), prefix) != 0 ||
+        file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    const char* first = file_name.data() + prefix.size();
+    const char* last = file_name.data() + file_name.size() - suffix.size();
+    auto [ptr, ec] = std::from_chars(first, last, segment);
+    return ec == std::errc() && ptr == last;
 }
 
 /**
- * @brief Formats a Gauge metric for Prometheus.
- * @param name Metric name.
- * @param metric_data Metric data.
- * @return Prometheus-formatted string.
+ * @brief Reads the persistence settings, restores the saved state and opens the write-ahead log.
+ *
+ * IOT_METRICS_DATA_DIR names the directory (created if missing); without it
+ * nothing is persisted. IOT_METRICS_SNAPSHOT_INTERVAL sets the seconds between
+ * snapshots and IOT_METRICS_WAL_COMMIT_MS the longest a write waits before it
+ * is synced to disk; HTTP writes are acknowledged once synced unless
+ * IOT_METRICS_WAL_ASYNC is non-zero. IOT_METRICS_SERIES_SLOTS sizes the
+ * memory-mapped value slots of counter, updowncounter and gauge series
+ * (default: twice the global series limit, leaving room for overflow series and
+ * for evicted series whose last writer has not let go yet); 0 logs those writes
+ * like the rest.
+ * @throws std::runtime_error if a setting is invalid or the directory cannot be used.
  */
-std::string IoTMetricsServer::formatGaugeForPrometheus(const std::string& name,
-    const metrics_sdk::MetricData& metric_data) {
+void IoTMetricsServer::loadPersistence() {
+    const char* directory = std::getenv("IOT_METRICS_DATA_DIR");
+    if (!directory || !*directory) {
+        return;
+    }
 
-    std::ostringstream output;
-    std::string sanitized_name = sanitizeMetricName(name);
+    uint64_t interval = default_snapshot_interval_seconds_;
+    readUnsignedEnv("IOT_METRICS_SNAPSHOT_INTERVAL", interval);
+    if (interval == 0) {
+        throw std::runtime_error("IOT_METRICS_SNAPSHOT_INTERVAL must be a positive integer");
+    }
+    uint64_t commit_ms = default_wal_commit_ms_;
+    readUnsignedEnv("IOT_METRICS_WAL_COMMIT_MS", commit_ms);
+    uint64_t wal_async = 0;
+    readUnsignedEnv("IOT_METRICS_WAL_ASYNC", wal_async);
+    uint64_t slot_capacity = 2 * static_cast<uint64_t>(max_series_);
+    readUnsignedEnv("IOT_METRICS_SERIES_SLOTS", slot_capacity);
+
+    data_directory_ = directory;
+    std::error_code error;
+    std::filesystem::create_directories(data_directory_, error);
+    if (error) {
+        throw std::runtime_error("Cannot create IOT_METRICS_DATA_DIR " + data_directory_ + ": " + error.message());
+    }
+    snapshot_interval_ = std::chrono::seconds(interval);
+    wal_async_ = wal_async != 0;
 
-    // HELP comment
-    if (!metric_data.instrument_descriptor.description_.empty()) {
-        output << "# HELP " << sanitized_name << " " << metric_data.instrument_descriptor.description_ << "\n";
+    if (slot_capacity > 0 && SlotStore::supported()) {
+        slots_ = SlotStore::open(data_directory_, static_cast<size_t>(slot_capacity));
+    }
+    else if (slot_capacity > 0) {
+        LOG_WARN("Memory-mapped series slots are not supported on this platform; counters and gauges are logged");
     }
 
-    // TYPE comment
-    output << "# TYPE " << sanitized_name << " gauge\n";
+    const uint64_t segment = restoreState();
+    wal_ = std::make_unique<WriteAheadLog>(data_directory_, segment, std::chrono::milliseconds(commit_ms));
+    LOG_INFO("Persistence: %s (snapshot every %llu s, log synced every %llu ms%s, segment %llu, %zu value slots)",
+        data_directory_.c_str(), static_cast<unsigned long long>(interval),
+        static_cast<unsigned long long>(commit_ms), wal_async_ ? " asynchronously" : "",
+        static_cast<unsigned long long>(segment), slots_ ? slots_->capacity() : size_t{ 0 });
+
+    // Series restored from a snapshot or the log were moved into slots; a snapshot now supersedes
+    // those files, so a crash cannot restore them a second time on top of their slots
+    if (slots_ && (restore_stats_.snapshot > 0 || restore_stats_.records > 0)) {
+        writeSnapshot();
+    }
+}
 
-    // Metric data
-    for (const auto& point_data_attr : metric_data.point_data_attr_) {
-        const auto* sum_point = std::get_if<metrics_sdk::SumPointData>(&point_data_attr.point_data);
-        if (sum_point) {
-            std::string attributes_str = formatAttributes(point_data_attr.attributes);
+/**
+ * @brief Adopts the live value slots, then loads the newest intact snapshot and replays the log segments it does not cover.
+ *
+ * snapshot-N holds every write logged in segments below N, so only segments N
+ * and up are replayed, in order. If the newest snapshot cannot be read the next
+ * older one is tried (its segments are normally gone, so writes are lost and an
+ * error is logged). Counter, updowncounter and gauge series restored from the
+ * files (written before the slot store was enabled) are then moved into slots.
+ * @return Number of the segment the log continues with.
+ */
+uint64_t IoTMetricsServer::restoreState() {
+    const auto started = std::chrono::steady_clock::now();
+    if (slots_) {
+        restore_stats_.slot_series = recoverSlots();
+    }
 
-            // Convert value variant to string safely
-            std::string value_str;
-            std::visit([&value_str](const auto& v) {
-                value_str = std::to_string(v);
-            }, sum_point->value_);
+    std::vector<uint64_t> snapshots;
+    std::vector<uint64_t> segments;
+    for (const auto& entry : std::filesystem::directory_iterator(data_directory_)) {
+        const std::string file_name = entry.path().filename().string();
+        uint64_t number = 0;
+        if (WriteAheadLog::parseSegmentName(file_name, number)) {
+            segments.push_back(number);
+        }
+        else if (parseSnapshotName(file_name, number)) {
+            snapshots.push_back(number);
+        }
+    }
+    std::sort(snapshots.rbegin(), snapshots.rend());
+    std::sort(segments.begin(), segments.end());
+
+    uint64_t covered = 0;
+    for (uint64_t snapshot : snapshots) {
+        size_t series = 0;
+        if (loadSnapshot(snapshotPath(snapshot), series)) {
+            covered = snapshot;
+            restore_stats_.snapshot = snapshot;
+            restore_stats_.snapshot_series = series;
+            break;
+        }
+        LOG_ERROR("Snapshot %s is unreadable or corrupt; trying an older one", snapshotPath(snapshot).c_str());
+    }
+    if (!snapshots.empty() && covered != snapshots.front()) {
+        LOG_ERROR("Restored from an older snapshot than the newest; writes since then may be lost");
+    }
 
-            output << sanitized_name << attributes_str << " " << value_str << "\n";
+    uint64_t next_segment = std::max<uint64_t>(covered, 1);
+    for (uint64_t segment : segments) {
+        if (segment >= covered) {
+            replaySegment(WriteAheadLog::segmentPath(data_directory_, segment));
         }
+        next_segment = std::max(next_segment, segment + 1);
     }
+    if (slots_) {
+        moveSeriesToSlots();
+    }
+
+    restore_stats_.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+    if (restore_stats_.slot_series > 0 || restore_stats_.snapshot > 0 || restore_stats_.records > 0) {
+        LOG_INFO("Restored %zu series from value slots and %zu from snapshot %llu, and replayed %zu writes from %zu log segments in %.1f ms",
+            restore_stats_.slot_series, restore_stats_.snapshot_series,
+            static_cast<unsigned long long>(restore_stats_.snapshot),
+            restore_stats_.points, restore_stats_.segments, restore_stats_.milliseconds);
+    }
+    return next_segment;
+}
+
+/**
+ * @brief Registers every live slot of the slot store as the series it was allocated for.
+ *
+ * A slot's catalog identity is the binary frame of its metric, labels and
+ * descriptor, so it is decoded as the binary listener would. Series go through
+ * findOrCreateSeries, so the series limits apply; a slot whose series already
+ * exists (tighter limits sending several to an overflow series) is added into
+ * it and freed.
+ * @return Number of series adopted.
+ */
+size_t IoTMetricsServer::recoverSlots() {
+    const int64_t now = clock_seconds_.load(std::memory_order_relaxed);
+    return slots_->recover([&](SlotStore::Handle& slot, uint8_t, std::string_view identity) {
+        const uint8_t* cursor = reinterpret_cast<const uint8_t*>(identity.data());
+        const uint8_t* end = cursor + identity.size();
+        uint64_t frame_length = 0;
+        MetricPoint point;
+        std::string error_msg;
+        if (!readVarint(cursor, end, frame_length) || frame_length != static_cast<uint64_t>(end - cursor) ||
+            !decodeBinaryFrame(cursor, static_cast<size_t>(frame_length), point, error_msg)) {
+            LOG_WARN("Dropping value slot %u: its catalog identity is unreadable", slot.index());
+            return false;
+        }
 
-    output << "\n";
-    return output.str();
+        MetricShard& shard = shardFor(point.metric_name);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        bool adopted = false;
+        if (point.instrument_type == "counter" || point.instrument_type == "updowncounter") {
+            const bool counter = point.instrument_type == "counter";
+            SumFamily& family = restoredFamily(counter ? shard.counter_families : shard.updowncounter_families,
+                point.metric_name);
+            updateDescriptor(family.descriptor,
+                counter ? metrics_sdk::InstrumentType::kCounter : metrics_sdk::InstrumentType::kUpDownCounter,
+                point.metric_name, point.unit, point.description);
+            auto& entry = findOrCreateSeries(family, point.metric_name, point.attributes, [&] {
+                adopted = true;
+                auto series = std::make_shared<SumSeries>(std::move(slot));
+                series->last_update.store(now, std::memory_order_relaxed);
+                return series;
+            });
+            if (!adopted) {
+                entry.value->add(slot.load(), now);
+            }
+        }
+        else if (point.instrument_type == "gauge") {
+            GaugeFamily& family = restoredFamily(shard.gauge_families, point.metric_name);
+            updateDescriptor(family.descriptor, metrics_sdk::InstrumentType::kUpDownCounter,
+                point.metric_name, point.unit, point.description);
+            auto& entry = findOrCreateSeries(family, point.metric_name, point.attributes, [&] {
+                adopted = true;
+                GaugeSeries series;
+                series.slot = std::move(slot);
+                return series;
+            });
+            if (!adopted) {
+                entry.value.set(slot.load());
+            }
+            family.last_value = entry.value.read();
+        }
+        return adopted;
+    });
 }
 
 /**
- * @brief Formats metric attributes for Prometheus.
- * @param attributes Point attributes.
- * @return Prometheus-formatted attribute string.
+ * @brief Moves every in-memory counter, updowncounter and gauge series into a slot.
+ *
+ * Used at startup for series restored from a snapshot; no other thread can
+ * reach them yet. Series that find no free slot stay in memory.
+ * @return Number of series moved.
  */
-std::string IoTMetricsServer::formatAttributes(const metrics_sdk::PointAttributes& attributes) {
-    if (attributes.empty()) {
-        return "";
+size_t IoTMetricsServer::moveSeriesToSlots() {
+    size_t moved = 0;
+    auto move_sums = [&](BinaryInstrumentKind kind, std::map<std::string, SumFamily>& families) {
+        for (auto& item : families) {
+            for (auto& entry : item.second.series) {
+                if (entry.value->slot) {
+                    continue;
+                }
+                if (SlotStore::Handle slot = allocateSlot(kind, item.first, entry.labels, item.second.descriptor)) {
+                    entry.value->moveToSlot(std::move(slot));
+                    ++moved;
+                }
+            }
+        }
+    };
+
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        move_sums(BinaryInstrumentKind::Counter, shard.counter_families);
+        move_sums(BinaryInstrumentKind::UpDownCounter, shard.updowncounter_families);
+        for (auto& item : shard.gauge_families) {
+            for (auto& entry : item.second.series) {
+                if (entry.value.slot) {
+                    continue;
+                }
+                if (SlotStore::Handle slot = allocateSlot(BinaryInstrumentKind::Gauge, item.first, entry.labels,
+                    item.second.descriptor)) {
+                    slot.store(entry.value.value);
+                    entry.value.slot = std::move(slot);
+                    ++moved;
+                }
+            }
+        }
     }
+    return moved;
+}
 
-    std::ostringstream output;
-    output << "{";
+/**
+ * @brief Restores every family of a snapshot file into the store.
+ *
+ * The checksum is verified and the whole file is decoded into scratch values
+ * before anything is restored. Series go through findOrCreateSeries, so the
+ * series limits apply and restored series are stamped as just written; state is
+ * merged into the series found, which only matters when tighter limits route
+ * several saved series to an overflow series.
+ * @param path Snapshot file.
+ * @param series Output number of series restored.
+ * @return False if the file is unreadable, fails its checksum or does not decode (the store is untouched).
+ */
+bool IoTMetricsServer::loadSnapshot(const std::string& path, size_t& series) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < snapshot_magic.size() + 4 || data.compare(0, snapshot_magic.size(), snapshot_magic) != 0) {
+        return false;
+    }
+    const size_t body_size = data.size() - 4;
+    const uint8_t* begin = reinterpret_cast<const uint8_t*>(data.data());
+    const uint32_t stored_checksum = static_cast<uint32_t>(begin[body_size]) |
+        (static_cast<uint32_t>(begin[body_size + 1]) << 8) | (static_cast<uint32_t>(begin[body_size + 2]) << 16) |
+        (static_cast<uint32_t>(begin[body_size + 3]) << 24);
+    if (WriteAheadLog::checksum(data.data(), body_size) != stored_checksum) {
+        return false;
+    }
 
-    bool first = true;
-    for (const auto& [key, value] : attributes) {
-        if (!first) {
-            output << ",";
+    const uint8_t* const body = begin + snapshot_magic.size();
+    const uint8_t* const end = begin + body_size;
+    const uint8_t* cursor = body;
+    const int64_t now = clock_seconds_.load(std::memory_order_relaxed);
+    std::string name, unit, description, key, val;
+    std::map<std::string, std::string> attributes;
+
+    // Reads a family's series: attributes, then state into the series found or created for them
+    // (or, while checking the file, into a scratch value that is thrown away)
+    auto read_series = [&](auto* family, auto&& make_value, auto&& read_state) {
+        uint64_t count = 0;
+        if (!readVarint(cursor, end, count)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t attribute_count = 0;
+            if (!readVarint(cursor, end, attribute_count) || attribute_count > static_cast<uint64_t>(end - cursor)) {
+                return false;
+            }
+            attributes.clear();
+            for (uint64_t j = 0; j < attribute_count; ++j) {
+                if (!readLengthPrefixedString(cursor, end, key) || !readLengthPrefixedString(cursor, end, val)) {
+                    return false;
+                }
+                attributes[key] = val;
+            }
+            if (!family) {
+                auto scratch = make_value();
+                if (!read_state(scratch)) {
+                    return false;
+                }
+                continue;
+            }
+            auto& entry = findOrCreateSeries(*family, name, attributes, make_value);
+            if (!read_state(entry.value)) {
+                return false;
+            }
+            ++series;
         }
+        return true;
+    };
+
+    // Decodes the whole body; the store is only touched when apply is set
+    auto parse = [&](bool apply) {
+        cursor = body;
+        series = 0;
+        while (cursor < end) {
+            const auto kind = static_cast<BinaryInstrumentKind>(*cursor++);
+            if (!readLengthPrefixedString(cursor, end, name) || name.empty() ||
+                !readLengthPrefixedString(cursor, end, unit) || !readLengthPrefixedString(cursor, end, description)) {
+                return false;
+            }
 
-        // Convert value to string (handle each type in the variant explicitly)
-        std::string value_str;
-        std::visit([&value_str](const auto& v) {
-            using T = std::decay_t<decltype(v)>;
-            if constexpr (std::is_same_v<T, std::string>) {
-                value_str = v;
+            MetricShard& shard = shardFor(name);
+            std::unique_lock<std::mutex> lock(shard.mutex, std::defer_lock);
+            if (apply) {
+                lock.lock();
+            }
+            bool ok = false;
+            switch (kind) {
+            case BinaryInstrumentKind::Counter:
+            case BinaryInstrumentKind::UpDownCounter: {
+                const auto type = kind == BinaryInstrumentKind::Counter
+                    ? metrics_sdk::InstrumentType::kCounter : metrics_sdk::InstrumentType::kUpDownCounter;
+                SumFamily* family = nullptr;
+                if (apply) {
+                    family = &restoredFamily(kind == BinaryInstrumentKind::Counter
+                        ? shard.counter_families : shard.updowncounter_families, name);
+                    updateDescriptor(family->descriptor, type, name, unit, description);
+                }
+                ok = read_series(family,
+                    [&] {
+                        auto created = std::make_shared<SumSeries>();
+                        created->last_update.store(now, std::memory_order_relaxed);
+                        return created;
+                    },
+                    [&](std::shared_ptr<SumSeries>& state) {
+                        double value = 0.0;
+                        if (!readFixedDouble(cursor, end, value)) {
+                            return false;
+                        }
+                        state->add(value, now);
+                        return true;
+                    });
+                break;
             }
-            else if constexpr (std::is_same_v<T, const char*>) {
-                value_str = std::string(v);
+            case BinaryInstrumentKind::Histogram: {
+                std::vector<double> boundaries;
+                if (!readDoubles(cursor, end, boundaries) || boundaries.empty()) {
+                    return false;
+                }
+                HistogramFamily* family = nullptr;
+                if (apply) {
+                    family = &restoredFamily(shard.histogram_families, name);
+                    updateDescriptor(family->descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+                    if (family->boundaries.empty()) {
+                        family->boundaries = boundaries;
+                    }
+                }
+                const size_t boundary_count = (family ? family->boundaries : boundaries).size();
+                ok = read_series(family,
+                    [&] { return HistogramState(boundary_count); },
+                    [&](HistogramState& state) {
+                        uint64_t count = 0, saved_buckets = 0;
+                        double sum = 0.0, min = 0.0, max = 0.0;
+                        if (!readVarint(cursor, end, count) || !readFixedDouble(cursor, end, sum) ||
+                            !readFixedDouble(cursor, end, min) || !readFixedDouble(cursor, end, max) ||
+                            !readVarint(cursor, end, saved_buckets) || saved_buckets != state.bucket_counts.size()) {
+                            return false;
+                        }
+                        for (uint64_t& bucket : state.bucket_counts) {
+                            uint64_t added = 0;
+                            if (!readVarint(cursor, end, added)) {
+                                return false;
+                            }
+                            bucket += added;
+                        }
+                        state.count += count;
+                        state.sum += sum;
+                        state.min = std::min(state.min, min);
+                        state.max = std::max(state.max, max);
+                        return true;
+                    });
+                break;
             }
-            else if constexpr (std::is_same_v<T, bool>) {
-                value_str = v ? "true" : "false";
+            case BinaryInstrumentKind::ExponentialHistogram: {
+                ExponentialHistogramFamily* family = nullptr;
+                if (apply) {
+                    family = &restoredFamily(shard.exponential_histogram_families, name);
+                    updateDescriptor(family->descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+                }
+                ok = read_series(family,
+                    [] { return ExponentialHistogram(); },
+                    [&](ExponentialHistogram& state) {
+                        int64_t scale = 0;
+                        uint64_t count = 0, zero_count = 0;
+                        double sum = 0.0, min = 0.0, max = 0.0;
+                        ExponentialHistogram::Buckets positive, negative;
+                        if (!readSignedVarint(cursor, end, scale) || !readVarint(cursor, end, count) ||
+                            !readFixedDouble(cursor, end, sum) || !readFixedDouble(cursor, end, min) ||
+                            !readFixedDouble(cursor, end, max) || !readVarint(cursor, end, zero_count) ||
+                            !readBuckets(cursor, end, positive.offset, positive.counts) ||
+                            !readBuckets(cursor, end, negative.offset, negative.counts)) {
+                            return false;
+                        }
+                        if (scale < ExponentialHistogram::min_scale || scale > ExponentialHistogram::max_scale) {
+                            return false;
+                        }
+                        // Two saved series only meet in an overflow series; the first one's state is kept
+                        if (state.count() > 0) {
+                            return true;
+                        }
+                        return state.restore(static_cast<int32_t>(scale), count, sum, min, max, zero_count,
+                            std::move(positive), std::move(negative));
+                    });
+                break;
             }
-            else if constexpr (std::is_same_v<T, int32_t>) {
-                value_str = std::to_string(v);
+            case BinaryInstrumentKind::Summary: {
+                std::vector<double> quantiles;
+                if (!readDoubles(cursor, end, quantiles) || quantiles.empty()) {
+                    return false;
+                }
+                SummaryFamily* family = nullptr;
+                if (apply) {
+                    family = &restoredFamily(shard.summary_families, name);
+                    updateDescriptor(family->descriptor, metrics_sdk::InstrumentType::kHistogram, name, unit, description);
+                    if (family->quantiles.empty()) {
+                        family->quantiles = std::move(quantiles);
+                    }
+                }
+                ok = read_series(family,
+                    [] { return QuantileSketch(); },
+                    [&](QuantileSketch& state) {
+                        uint64_t count = 0, zero_count = 0;
+                        double sum = 0.0, min = 0.0, max = 0.0;
+                        QuantileSketch::Buckets positive, negative;
+                        if (!readVarint(cursor, end, count) || !readFixedDouble(cursor, end, sum) ||
+                            !readFixedDouble(cursor, end, min) || !readFixedDouble(cursor, end, max) ||
+                            !readVarint(cursor, end, zero_count) ||
+                            !readBuckets(cursor, end, positive.offset, positive.counts) ||
+                            !readBuckets(cursor, end, negative.offset, negative.counts)) {
+                            return false;
+                        }
+                        QuantileSketch saved;
+                        return saved.restore(count, sum, min, max, zero_count, std::move(positive), std::move(negative)) &&
+                            state.merge(saved);
+                    });
+                break;
             }
-            else if constexpr (std::is_same_v<T, int64_t>) {
-                value_str = std::to_string(v);
+            case BinaryInstrumentKind::Gauge: {
+                double last_value = 0.0;
+                if (!readFixedDouble(cursor, end, last_value)) {
+                    return false;
+                }
+                GaugeFamily* family = nullptr;
+                if (apply) {
+                    family = &restoredFamily(shard.gauge_families, name);
+                    updateDescriptor(family->descriptor, metrics_sdk::InstrumentType::kUpDownCounter, name, unit, description);
+                    family->last_value = last_value;
+                }
+                ok = read_series(family,
+                    [] { return GaugeSeries(); },
+                    [&](GaugeSeries& state) {
+                        double value = 0.0;
+                        if (!readFixedDouble(cursor, end, value)) {
+                            return false;
+                        }
+                        state.set(value);
+                        return true;
+                    });
+                break;
             }
-            else if constexpr (std::is_same_v<T, uint32_t>) {
-                value_str = std::to_string(v);
+            default:
+                break;
             }
-            else if constexpr (std::is_same_v<T, uint64_t>) {
-                value_str = std::to_string(v);
+            if (!ok) {
+                return false;
             }
-            else if constexpr (std::is_same_v<T, double>) {
-                value_str = std::to_string(v);
+        }
+        return true;
+    };
+
+    // A file that does not decode to the end is rejected before anything is restored,
+    // so recovery can fall back to an older snapshot instead of keeping part of this one
+    if (!parse(false)) {
+        LOG_ERROR("Snapshot %s passes its checksum but is malformed", path.c_str());
+        return false;
+    }
+    if (!parse(true)) {
+        LOG_ERROR("Snapshot %s could not be merged into the store after %zu series", path.c_str(), series);
+    }
+    return true;
+}
+
+/**
+ * @brief Applies every intact record of a log segment.
+ *
+ * A record holds the frames of one write or batch; each is decoded and
+ * recorded exactly as the binary listener would. A torn tail (a crash during a
+ * commit) ends the segment.
+ * @param path Segment file.
+ */
+void IoTMetricsServer::replaySegment(const std::string& path) {
+    std::vector<MetricPoint> points;
+    bool torn = false;
+    const size_t records = WriteAheadLog::replay(path, [&](std::string_view record) {
+        points.clear();
+        const uint8_t* cursor = reinterpret_cast<const uint8_t*>(record.data());
+        const uint8_t* end = cursor + record.size();
+        while (cursor < end) {
+            uint64_t frame_length = 0;
+            if (!readVarint(cursor, end, frame_length) || frame_length > static_cast<uint64_t>(end - cursor)) {
+                LOG_WARN("Skipping the rest of a malformed record in %s", path.c_str());
+                break;
             }
-            else if constexpr (std::is_same_v<T, float>) {
-                value_str = std::to_string(v);
+            MetricPoint point;
+            std::string error_msg;
+            if (decodeBinaryFrame(cursor, static_cast<size_t>(frame_length), point, error_msg)) {
+                points.push_back(std::move(point));
             }
             else {
-                value_str = "unknown_type";
+                LOG_WARN("Skipping a logged write in %s: %s", path.c_str(), error_msg.c_str());
             }
-        }, value);
-
-        output << key << "=\"" << value_str << "\"";
-        first = false;
+            cursor += frame_length;
+        }
+        recordMetricBatch(points);
+        restore_stats_.points += points.size();
+    }, torn);
+
+    restore_stats_.segments++;
+    restore_stats_.records += records;
+    if (torn) {
+        restore_stats_.torn_segments++;
+        LOG_WARN("Log segment %s ends in a torn or corrupt record after %zu records", path.c_str(), records);
     }
-
-    output << "}";
-    return output.str();
 }
 
 /**
- * @brief Sanitizes a metric name for Prometheus compatibility.
- * @param name Metric name.
- * @return Sanitized metric name.
+ * @brief Returns the path of the snapshot that covers every segment before a given one.
+ * @param segment First segment the snapshot does not cover.
  */
-std::string IoTMetricsServer::sanitizeMetricName(const std::string& name) {
-    std::string sanitized = name;
+std::string IoTMetricsServer::snapshotPath(uint64_t segment) const {
+    char name[48];
+    std::snprintf(name, sizeof(name), "snapshot-%020llu.bin", static_cast<unsigned long long>(segment));
+    return data_directory_ + "/" + name;
+}
 
-    // Replace invalid characters with underscores
-    for (char& c : sanitized) {
-        if (!std::isalnum(c) && c != '_' && c != ':') {
-            c = '_';
-        }
+/**
+ * @brief Takes persistence_mutex_ shared for one write or batch.
+ * @return The held lock, or an empty one when persistence is disabled.
+ */
+std::shared_lock<std::shared_mutex> IoTMetricsServer::lockForWrite() {
+    if (!wal_) {
+        return {};
     }
-
-    return sanitized;
+    if (snapshot_pending_.load(std::memory_order_acquire)) {
+        // Queue behind the snapshot rather than keep the shared lock busy
+        std::lock_guard<std::mutex> wait(snapshot_gate_);
+    }
+    return std::shared_lock<std::shared_mutex>(persistence_mutex_);
 }
 
-//==============================================================================
-// METRIC RECORDING METHODS - USING UNIQUE_PTR STORAGE
-//==============================================================================
+/**
+ * @brief Allocates a slot for a new series, recording its identity in the catalog.
+ *
+ * When every slot is in use, or its catalog record cannot be written, the
+ * series stays in memory: it keeps counting but is not persisted. The first
+ * such series of either kind is logged.
+ * @note Caller must hold the series' shard mutex.
+ * @param kind Counter, UpDownCounter or Gauge.
+ * @param name Metric name.
+ * @param labels Series labels.
+ * @param descriptor Family descriptor (its unit and description are recorded).
+ * @return The slot, or an empty handle if the slot store is disabled, full or cannot write its catalog.
+ */
+SlotStore::Handle IoTMetricsServer::allocateSlot(BinaryInstrumentKind kind, const std::string& name,
+    const LabelSet& labels, const metrics_sdk::InstrumentDescriptor& descriptor) {
+    if (!slots_) {
+        return {};
+    }
+    thread_local std::string identity;
+    identity.clear();
+    appendSlotIdentity(identity, kind, name, labels, descriptor);
+    SlotStore::Handle slot = slots_->allocate(static_cast<uint8_t>(kind), identity);
+    if (!slot && slots_->exhausted() == 1) {
+        LOG_WARN("All %zu value slots are in use; new counter and gauge series are not persisted "
+            "(raise IOT_METRICS_SERIES_SLOTS)", slots_->capacity());
+    }
+    else if (!slot && slots_->catalogErrors() == 1) {
+        LOG_ERROR("Cannot append to the series catalog; new counter and gauge series are not persisted");
+    }
+    return slot;
+}
 
 /**
- * @brief Records a metric of any supported type.
- * @param metric_name Name of the metric.
- * @param instrument_type Type of instrument ("counter", "updowncounter", "histogram", "gauge").
- * @param value Value to record.
- * @param attributes Key-value attributes for the metric.
- * @param unit Unit of measurement.
- * @param description Metric description.
+ * @brief Appends the identity a slot is cataloged with: a binary frame (value 0) of the series.
+ * @param out Buffer to append to.
+ * @param kind Counter, UpDownCounter or Gauge.
+ * @param name Metric name.
+ * @param labels Series labels.
+ * @param descriptor Family descriptor.
  */
-void IoTMetricsServer::recordMetric(const std::string& metric_name,
-    const std::string& instrument_type,
-    double value,
-    const std::map<std::string, std::string>& attributes,
-    const std::string& unit,
-    const std::string& description) {
+void IoTMetricsServer::appendSlotIdentity(std::string& out, BinaryInstrumentKind kind, const std::string& name,
+    const LabelSet& labels, const metrics_sdk::InstrumentDescriptor& descriptor) const {
+    std::map<std::string, std::string> attributes;
+    for (const auto& label : labels) {
+        attributes.emplace(label_pool_.view(label.key), label_pool_.view(label.value));
+    }
+    const std::string instrument_type = kind == BinaryInstrumentKind::Counter ? "counter"
+        : kind == BinaryInstrumentKind::UpDownCounter ? "updowncounter" : "gauge";
+    appendBinaryFrame(out, name, instrument_type, 0.0, attributes, descriptor.unit_, descriptor.description_, {});
+}
 
-    // Log what we're recording
-    std::cout << "Creating MetricData: " << metric_name << " (" << instrument_type << ") = " << value;
-    if (!unit.empty()) std::cout << " " << unit;
-    if (!attributes.empty()) {
-        std::cout << " with attributes: {";
-        bool first = true;
-        for (const auto& [key, val] : attributes) {
-            if (!first) std::cout << ", ";
-            std::cout << key << "=" << val;
-            first = false;
+/**
+ * @brief Folds the striped cells of every slot-backed counter and updowncounter series into its slot.
+ *
+ * Writers add into per-thread cells, so a slot holds what was folded last;
+ * the snapshot thread folds before every sync, which bounds what a crash can
+ * take from these series to one poll interval.
+ */
+void IoTMetricsServer::foldSumCells() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto* families : { &shard.counter_families, &shard.updowncounter_families }) {
+            for (auto& item : *families) {
+                for (auto& entry : item.second.series) {
+                    entry.value->fold();
+                }
+            }
         }
-        std::cout << "}";
     }
-    std::cout << std::endl;
+}
 
-    if (instrument_type == "counter") {
-        recordCounterMetricData(metric_name, value, attributes, unit, description);
-    }
-    else if (instrument_type == "updowncounter") {
-        recordUpDownCounterMetricData(metric_name, value, attributes, unit, description);
-    }
-    else if (instrument_type == "histogram") {
-        recordHistogramMetricData(metric_name, value, attributes, unit, description);
+/**
+ * @brief Folds and syncs the slots, then drops every slot handle.
+ *
+ * Series cached by other threads (an HTTP worker, or the thread that replayed
+ * the log) may outlive the server; once their handles are gone they no longer
+ * keep the slot file mapped. The slots stay live on disk, so the next start
+ * adopts them.
+ */
+void IoTMetricsServer::releaseSlots() {
+    SumSeriesCache& cache = sumSeriesCache();
+    if (cache.owner == instance_id_) {
+        cache.entries[0].clear();
+        cache.entries[1].clear();
+        cache.owner = 0;
     }
-    else if (instrument_type == "gauge") {
-        recordGaugeMetricData(metric_name, value, attributes, unit, description);
+    if (!slots_) {
+        return;
     }
-    else {
-        throw std::invalid_argument("Unsupported OpenTelemetry instrument type: " + instrument_type);
+    foldSumCells();
+    slots_->sync();
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (auto* families : { &shard.counter_families, &shard.updowncounter_families }) {
+            for (auto& item : *families) {
+                for (auto& entry : item.second.series) {
+                    entry.value->slot = SlotStore::Handle();
+                }
+            }
+        }
+        for (auto& item : shard.gauge_families) {
+            for (auto& entry : item.second.series) {
+                entry.value.value = entry.value.read();
+                entry.value.slot = SlotStore::Handle();
+            }
+        }
     }
+    slots_.reset();
 }
 
 /**
- * @brief Records a Counter metric.
- * @param name Metric name.
- * @param value Value to record.
- * @param attributes Key-value attributes.
- * @param unit Unit of measurement.
- * @param description Metric description.
+ * @brief Starts the snapshot thread if persistence is enabled.
  */
-void IoTMetricsServer::recordCounterMetricData(const std::string& name, double value, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-
-    // Create MetricData on the heap to avoid copy issues
-    auto metric_data = std::make_unique<metrics_sdk::MetricData>();
-    metrics_sdk::InstrumentDescriptor descriptor;
-
-    descriptor.name_ = name;
-    descriptor.description_ = description;
-    descriptor.unit_ = unit;
-    descriptor.type_ = metrics_sdk::InstrumentType::kCounter;
-    metric_data->instrument_descriptor = descriptor;
-
-    metrics_sdk::SumPointData point_data;
-    point_data.value_ = value;
-    point_data.is_monotonic_ = true;
-
-    metrics_sdk::PointAttributes point_attributes;
-    for (const auto& [key, val] : attributes) {
-        point_attributes[key] = val;
+void IoTMetricsServer::startSnapshotter() {
+    if (!wal_ || snapshot_thread_.joinable()) {
+        return;
     }
-
-    // Reserve space to avoid reallocation during emplace_back
-    metric_data->point_data_attr_.reserve(1);
-    metric_data->point_data_attr_.emplace_back();
-    auto& point_data_attributes = metric_data->point_data_attr_.back();
-    point_data_attributes.attributes = std::move(point_attributes);
-    point_data_attributes.point_data = std::move(point_data);
-
-    // Store the unique_ptr - this avoids copying MetricData
-    counter_metrics_[name] = std::move(metric_data);
-
-    std::cout << "Counter PointDataAttributes created with " << attributes.size() << " attributes in PointAttributes" << std::endl;
+    snapshot_thread_ = std::thread(&IoTMetricsServer::runSnapshotter, this);
 }
 
 /**
- * @brief Records an UpDownCounter metric.
- * @param name Metric name.
- * @param value Value to record.
- * @param attributes Key-value attributes.
- * @param unit Unit of measurement.
- * @param description Metric description.
+ * @brief Joins the snapshot thread (it exits once listeners_running_ is cleared).
+ *
+ * If it was running, a final snapshot is taken so the next start has no log to
+ * replay; otherwise pending log records are synced. Value slots are synced either way.
  */
-void IoTMetricsServer::recordUpDownCounterMetricData(const std::string& name, double value, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    std::string attr_key = createAttributeKey(attributes);
-    static std::map<std::string, std::map<std::string, double>> updown_states;
-    updown_states[name][attr_key] += value;
-    double current_value = updown_states[name][attr_key];
-
-    // Create MetricData on the heap to avoid copy issues
-    auto metric_data = std::make_unique<metrics_sdk::MetricData>();
-    metrics_sdk::InstrumentDescriptor descriptor;
-
-    descriptor.name_ = name;
-    descriptor.description_ = description;
-    descriptor.unit_ = unit;
-    descriptor.type_ = metrics_sdk::InstrumentType::kUpDownCounter;
-    metric_data->instrument_descriptor = descriptor;
-
-    metrics_sdk::SumPointData point_data;
-    point_data.value_ = current_value;
-    point_data.is_monotonic_ = false;
-
-    metrics_sdk::PointAttributes point_attributes;
-    for (const auto& [key, val] : attributes) {
-        point_attributes[key] = val;
+void IoTMetricsServer::stopSnapshotter() {
+    if (!snapshot_thread_.joinable()) {
+        if (wal_) {
+            wal_->flush();
+        }
+        if (slots_) {
+            foldSumCells();
+            slots_->sync();
+        }
+        return;
+    }
+    snapshot_thread_.join();
+    writeSnapshot();
+    if (slots_) {
+        foldSumCells();
+        slots_->sync();
     }
-
-    // Reserve space to avoid reallocation during emplace_back
-    metric_data->point_data_attr_.reserve(1);
-    metric_data->point_data_attr_.emplace_back();
-    auto& point_data_attributes = metric_data->point_data_attr_.back();
-    point_data_attributes.attributes = std::move(point_attributes);
-    point_data_attributes.point_data = std::move(point_data);
-
-    // Store the unique_ptr - this avoids copying MetricData
-    updowncounter_metrics_[name] = std::move(metric_data);
-
-    std::cout << "UpDownCounter updated: " << name << " += " << value
-        << " (current=" << current_value << ")" << std::endl;
 }
 
 /**
- * @brief Records a Histogram metric.
- * @param name Metric name.
- * @param value Value to record.
- * @param attributes Key-value attributes.
- * @param unit Unit of measurement.
- * @param description Metric description.
+ * @brief Snapshot loop: takes a snapshot every snapshot_interval_ while the server runs.
+ *
+ * A snapshot that fails is retried on the next poll rather than a full
+ * interval later. Counter cells are folded into their slots and dirty slots
+ * are synced on every poll, which bounds what a crash or power loss can take
+ * from slot-backed series.
  */
-void IoTMetricsServer::recordHistogramMetricData(const std::string& name, double value, const std::map<std::string, std::string>& attributes, const std::string& unit, const std::string& description) {
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-    std::string attr_key = createAttributeKey(attributes);
-
-    // Initialize histogram state if it doesn't exist
-    if (histogram_states_[name].find(attr_key) == histogram_states_[name].end()) {
-        // Use emplace to construct HistogramState with proper boundaries
-        histogram_states_[name].emplace(attr_key, HistogramState(default_histogram_boundaries_));
-        std::cout << "Created new histogram state for: " << name << " with attributes: " << attr_key << std::endl;
+void IoTMetricsServer::runSnapshotter() {
+    auto next_snapshot = std::chrono::steady_clock::now() + snapshot_interval_;
+    while (listeners_running_) {
+        std::this_thread::sleep_for(snapshot_poll_interval_);
+        if (slots_) {
+            foldSumCells();
+            slots_->sync();
+        }
+        // A failed snapshot keeps next_snapshot in the past, so it is retried on the next poll
+        if (std::chrono::steady_clock::now() >= next_snapshot && writeSnapshot()) {
+            next_snapshot = std::chrono::steady_clock::now() + snapshot_interval_;
+        }
     }
+}
 
-    // Update histogram state
-    HistogramState& state = histogram_states_[name][attr_key];
-    state.count++;
-    state.sum += value;
-    state.min = std::min(state.min, value);
-    state.max = std::max(state.max, value);
-
-    // Find appropriate bucket and increment count
-    size_t bucket_index = findBucketIndex(value, state.boundaries);
-    state.bucket_counts[bucket_index]++;
-
-    // Create MetricData on the heap to avoid copy issues
-    auto metric_data = std::make_unique<metrics_sdk::MetricData>();
-    metrics_sdk::InstrumentDescriptor descriptor;
-
-    descriptor.name_ = name;
-    descriptor.description_ = description;
-    descriptor.unit_ = unit;
-    descriptor.type_ = metrics_sdk::InstrumentType::kHistogram;
-    metric_data->instrument_descriptor = descriptor;
-
-    // Create HistogramPointData
-    metrics_sdk::HistogramPointData histogram_point;
-    histogram_point.count_ = state.count;
-    histogram_point.sum_ = state.sum;
-
-    if (state.count > 0) {
-        histogram_point.min_ = state.min;
-        histogram_point.max_ = state.max;
+/**
+ * @brief Cuts the log and writes a snapshot of the store.
+ *
+ * Writers are held off only while the log is rotated, the store is
+ * serialized into memory and the slot catalog is compacted; the file is
+ * written and synced afterwards. Once it is in place, older snapshots and the
+ * segments it covers are deleted.
+ * @return False if the snapshot could not be written.
+ */
+bool IoTMetricsServer::writeSnapshot() {
+    std::string data(snapshot_magic);
+    std::string catalog;
+    uint64_t segment = 0;
+    size_t series = 0;
+    const auto paused = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> gate(snapshot_gate_);
+        snapshot_pending_.store(true, std::memory_order_release);
+        std::unique_lock<std::shared_mutex> exclusive(persistence_mutex_);
+        if (!wal_->rotate(segment)) {
+            snapshot_pending_.store(false, std::memory_order_release);
+            snapshot_failures_.fetch_add(1, std::memory_order_relaxed);
+            LOG_ERROR("Cannot start write-ahead log segment %llu; the snapshot is retried on the next tick",
+                static_cast<unsigned long long>(wal_->segment() + 1));
+            return false;
+        }
+        series = serializeStore(data, catalog);
+        // No slot can be allocated while writers are held off, so the compacted catalog is complete
+        if (slots_ && !slots_->replaceCatalog(catalog)) {
+            LOG_WARN("Cannot compact the series catalog; it keeps growing until the next snapshot");
+        }
+        snapshot_pending_.store(false, std::memory_order_release);
     }
+    const auto pause = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - paused);
 
-    // Set bucket counts (cumulative)
-    histogram_point.counts_ = calculateCumulativeCounts(state.bucket_counts);
-    histogram_point.boundaries_ = state.boundaries;
-
-    metrics_sdk::PointAttributes point_attributes;
-    for (const auto& [key, val] : attributes) {
-        point_attributes[key] = val;
+    const uint32_t checksum = WriteAheadLog::checksum(data.data(), data.size());
+    for (int i = 0; i < 4; ++i) {
+        data.push_back(static_cast<char>((checksum >> (8 * i)) & 0xFF));
+    }
+    const std::string path = snapshotPath(segment);
+    if (!WriteAheadLog::replaceFile(path, data)) {
+        snapshot_failures_.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Cannot write snapshot %s; the log is kept", path.c_str());
+        return false;
     }
 
-    // Reserve space to avoid reallocation during emplace_back
-    metric_data->point_data_attr_.reserve(1);
-    metric_data->point_data_attr_.emplace_back();
-    auto& point_data_attributes = metric_data->point_data_attr_.back();
-    point_data_attributes.attributes = std::move(point_attributes);
-    point_data_attributes.point_data = std::move(histogram_point);
-
-    // Store the unique_ptr - this avoids copying MetricData
-    histogram_metrics_[name] = std::move(metric_data);
+    // The snapshot covers every earlier segment and supersedes every earlier snapshot
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(data_directory_, error)) {
+        const std::string file_name = entry.path().filename().string();
+        uint64_t number = 0;
+        if ((WriteAheadLog::parseSegmentName(file_name, number) || parseSnapshotName(file_name, number)) &&
+            number < segment) {
+            std::error_code remove_error;
+            std::filesystem::remove(entry.path(), remove_error);
+        }
+    }
 
-    std::cout << "Histogram recorded: " << name << " = " << value
-        << " (count=" << state.count << ", sum=" << state.sum
-        << ", bucket=" << bucket_index << ")" << std::endl;
+    snapshots_written_.fetch_add(1, std::memory_order_relaxed);
+    snapshot_segment_.store(segment, std::memory_order_relaxed);
+    snapshot_series_.store(series, std::memory_order_relaxed);
+    snapshot_bytes_.store(data.size(), std::memory_order_relaxed);
+    snapshot_pause_us_.store(static_cast<uint64_t>(pause.count()), std::memory_order_relaxed);
+    LOG_INFO("Snapshot %s: %zu series, %zu bytes, ingestion paused %.1f ms", path.c_str(), series, data.size(),
+        static_cast<double>(pause.count()) / 1000.0);
+    return true;
 }
 
 /**
- * @brief Records a Gauge metric.
- * @param name Metric name.
- * @param value Value to record.
- * @param attributes Key-value attributes.
- * @param unit Unit of measurement.
- * @param description Metric description.
+ * @brief Serializes every family, one shard at a time.
+ *
+ * Each family is its kind byte, name, unit and description, its family-level
+ * settings (histogram boundaries, summary quantiles, the gauge's last value),
+ * then its series: attributes followed by the full state. With the slot store
+ * enabled, counter, updowncounter and gauge series held in slots are left out
+ * and the catalog records of their slots are collected instead; the ones that
+ * found no slot are written like any other series.
+ * @param out Buffer to append to.
+ * @param catalog Buffer the catalog records of slot-backed series are appended to.
+ * @return Number of series serialized.
  */
-void IoTMetricsServer::recordGaugeMetricData(const std::string& name, double value,
-    const std::map<std::string, std::string>& attributes, const std::string& unit,
-    const std::string& description) {
-
-    std::lock_guard<std::mutex> lock(metrics_mutex_);
-
-    // Create MetricData on the heap
-    auto metric_data = std::make_unique<metrics_sdk::MetricData>();
-    metrics_sdk::InstrumentDescriptor descriptor;
-
-    descriptor.name_ = name;
-    descriptor.description_ = description;
-    descriptor.unit_ = unit;
-    descriptor.type_ = metrics_sdk::InstrumentType::kUpDownCounter;
-    metric_data->instrument_descriptor = descriptor;
-
-    metrics_sdk::SumPointData point_data;
-    point_data.value_ = value;  // Set absolute value (no accumulation)
-    point_data.is_monotonic_ = false;
-
-    metrics_sdk::PointAttributes point_attributes;
-    for (const auto& [key, val] : attributes) {
-        point_attributes[key] = val;
+size_t IoTMetricsServer::serializeStore(std::string& out, std::string& catalog) {
+    size_t series = 0;
+    // Writes the family with the series include() selects (nothing if it selects none)
+    auto append_family = [&](BinaryInstrumentKind kind, const std::string& name, const auto& family,
+        auto&& append_settings, auto&& append_state, auto&& include) {
+        size_t included = 0;
+        for (const auto& entry : family.series) {
+            included += include(entry.value) ? 1 : 0;
+        }
+        if (included == 0) {
+            return;
+        }
+        out.push_back(static_cast<char>(kind));
+        appendLengthPrefixedString(out, name);
+        appendLengthPrefixedString(out, family.descriptor.unit_);
+        appendLengthPrefixedString(out, family.descriptor.description_);
+        append_settings();
+        ProtoWriter::writeVarint(out, included);
+        for (const auto& entry : family.series) {
+            if (!include(entry.value)) {
+                continue;
+            }
+            ProtoWriter::writeVarint(out, entry.labels.size());
+            for (const auto& label : entry.labels) {
+                appendLengthPrefixedString(out, label_pool_.view(label.key));
+                appendLengthPrefixedString(out, label_pool_.view(label.value));
+            }
+            append_state(entry.value);
+        }
+        series += included;
+    };
+    auto all = [](const auto&) { return true; };
+    // Slot-backed series persist themselves; only the identity of each slot is rewritten
+    std::string identity;
+    auto append_slots = [&](BinaryInstrumentKind kind, const std::string& name, const auto& family, auto&& slot_of) {
+        for (const auto& entry : family.series) {
+            const SlotStore::Handle& slot = slot_of(entry.value);
+            if (slot) {
+                identity.clear();
+                appendSlotIdentity(identity, kind, name, entry.labels, family.descriptor);
+                slots_->appendCatalogEntry(catalog, slot, identity);
+            }
+        }
+    };
+    auto sum_slot = [](const std::shared_ptr<SumSeries>& state) -> const SlotStore::Handle& { return state->slot; };
+    auto gauge_slot = [](const GaugeSeries& state) -> const SlotStore::Handle& { return state.slot; };
+    // Series that found no slot (all in use, or the catalog could not be written) are snapshotted as usual
+    auto sum_in_memory = [](const std::shared_ptr<SumSeries>& state) { return !state->slot; };
+    auto gauge_in_memory = [](const GaugeSeries& state) { return !state.slot; };
+    auto no_settings = [] {};
+    auto append_sum = [&](const std::shared_ptr<SumSeries>& state) { appendFixedDouble(out, state->read()); };
+
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [name, family] : shard.counter_families) {
+            if (slots_) {
+                append_slots(BinaryInstrumentKind::Counter, name, family, sum_slot);
+            }
+            append_family(BinaryInstrumentKind::Counter, name, family, no_settings, append_sum, sum_in_memory);
+        }
+        for (const auto& [name, family] : shard.updowncounter_families) {
+            if (slots_) {
+                append_slots(BinaryInstrumentKind::UpDownCounter, name, family, sum_slot);
+            }
+            append_family(BinaryInstrumentKind::UpDownCounter, name, family, no_settings, append_sum, sum_in_memory);
+        }
+        for (const auto& item : shard.histogram_families) {
+            const HistogramFamily& family = item.second;
+            append_family(BinaryInstrumentKind::Histogram, item.first, family,
+                [&] { appendDoubles(out, family.boundaries); },
+                [&](const HistogramState& state) {
+                    ProtoWriter::writeVarint(out, state.count);
+                    appendFixedDouble(out, state.sum);
+                    appendFixedDouble(out, state.min);
+                    appendFixedDouble(out, state.max);
+                    ProtoWriter::writeVarint(out, state.bucket_counts.size());
+                    for (uint64_t count : state.bucket_counts) {
+                        ProtoWriter::writeVarint(out, count);
+                    }
+                }, all);
+        }
+        for (const auto& [name, family] : shard.exponential_histogram_families) {
+            append_family(BinaryInstrumentKind::ExponentialHistogram, name, family, no_settings,
+                [&](const ExponentialHistogram& state) {
+                    appendSignedVarint(out, state.scale());
+                    ProtoWriter::writeVarint(out, state.count());
+                    appendFixedDouble(out, state.sum());
+                    appendFixedDouble(out, state.min());
+                    appendFixedDouble(out, state.max());
+                    ProtoWriter::writeVarint(out, state.zeroCount());
+                    appendBuckets(out, state.positive().offset, state.positive().counts);
+                    appendBuckets(out, state.negative().offset, state.negative().counts);
+                }, all);
+        }
+        for (const auto& item : shard.summary_families) {
+            const SummaryFamily& family = item.second;
+            append_family(BinaryInstrumentKind::Summary, item.first, family,
+                [&] { appendDoubles(out, family.quantiles); },
+                [&](const QuantileSketch& state) {
+                    ProtoWriter::writeVarint(out, state.count());
+                    appendFixedDouble(out, state.sum());
+                    appendFixedDouble(out, state.min());
+                    appendFixedDouble(out, state.max());
+                    ProtoWriter::writeVarint(out, state.zeroCount());
+                    appendBuckets(out, state.positive().offset, state.positive().counts);
+                    appendBuckets(out, state.negative().offset, state.negative().counts);
+                }, all);
+        }
+        for (const auto& item : shard.gauge_families) {
+            const GaugeFamily& family = item.second;
+            if (slots_) {
+                append_slots(BinaryInstrumentKind::Gauge, item.first, family, gauge_slot);
+            }
+            append_family(BinaryInstrumentKind::Gauge, item.first, family,
+                [&] { appendFixedDouble(out, family.last_value); },
+                [&](const GaugeSeries& state) { appendFixedDouble(out, state.read()); }, gauge_in_memory);
+        }
     }
-
-    metric_data->point_data_attr_.reserve(1);
-    metric_data->point_data_attr_.emplace_back();
-    auto& point_data_attributes = metric_data->point_data_attr_.back();
-    point_data_attributes.attributes = std::move(point_attributes);
-    point_data_attributes.point_data = std::move(point_data);
-
-    // Store the unique_ptr (overwrites previous value for same name+attributes)
-    gauge_metrics_[name] = std::move(metric_data);
-
-    std::cout << "Gauge set: " << name << " = " << value << std::endl;
+    return series;
 }
 
 //==============================================================================
@@ -1044,54 +5238,90 @@ void IoTMetricsServer::recordGaugeMetricData(const std::string& name, double val
 //==============================================================================
 
 /**
- * @brief Creates a unique key from metric attributes for storage.
- * @param attributes Key-value attributes.
- * @return Concatenated attribute key.
+ * @brief Fills in a family's descriptor on creation and from later writes.
+ * @param descriptor Descriptor to update.
+ * @param type Instrument type.
+ * @param name Metric name.
+ * @param unit Unit of measurement (kept from the first write that has one).
+ * @param description Metric description (kept from the first write that has one).
  */
-std::string IoTMetricsServer::createAttributeKey(const std::map<std::string, std::string>& attributes) {
-    if (attributes.empty()) {
-        return "__default__";
+void IoTMetricsServer::updateDescriptor(metrics_sdk::InstrumentDescriptor& descriptor,
+    metrics_sdk::InstrumentType type,
+    const std::string& name,
+    const std::string& unit,
+    const std::string& description) {
+    if (descriptor.name_.empty()) {
+        descriptor.name_ = name;
+        descriptor.type_ = type;
+        descriptor.value_type_ = metrics_sdk::InstrumentValueType::kDouble;
     }
-    std::string key;
-    for (const auto& [k, v] : attributes) {
-        if (!key.empty()) key += "|";
-        key += k + "=" + v;
+    if (descriptor.unit_.empty() && !unit.empty()) descriptor.unit_ = unit;
+    if (descriptor.description_.empty() && !description.empty()) descriptor.description_ = description;
+}
+
+/**
+ * @brief Interns attributes into a series identity.
+ *
+ * Keys and values are interned once in label_pool_; the result is a short
+ * vector of id pairs in key order (std::map iteration order), so equal
+ * attribute sets always produce equal LabelSets.
+ * @param attributes Key-value attributes.
+ * @return Interned (key, value) id pairs.
+ */
+LabelSet IoTMetricsServer::internAttributes(const std::map<std::string, std::string>& attributes) {
+    LabelSet labels;
+    labels.reserve(attributes.size());
+    for (const auto& [key, val] : attributes) {
+        labels.push_back({ label_pool_.intern(key), label_pool_.intern(val) });
     }
-    return key;
+    return labels;
 }
 
 /**
- * @brief Finds the appropriate histogram bucket index for a value.
- * @param value Value to bucket.
- * @param boundaries Histogram bucket boundaries.
- * @return Index of the bucket.
+ * @brief Computes the series fingerprint of a set of attributes.
+ *
+ * One FNV-1a pass over every key and value in key order, with a separator byte
+ * after each so {"ab":"c"} and {"a":"bc"} hash differently. Nothing is allocated.
+ * @param attributes Key-value attributes.
+ * @return 64-bit fingerprint.
  */
-size_t IoTMetricsServer::findBucketIndex(double value, const std::vector<double>& boundaries) {
-    for (size_t i = 0; i < boundaries.size(); ++i) {
-        if (value <= boundaries[i]) {
-            return i;
+uint64_t IoTMetricsServer::fingerprintAttributes(const std::map<std::string, std::string>& attributes) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const std::string& text) {
+        for (unsigned char c : text) {
+            hash ^= c;
+            hash *= 1099511628211ull;
         }
+        hash ^= 0xFF;
+        hash *= 1099511628211ull;
+    };
+    for (const auto& [key, val] : attributes) {
+        mix(key);
+        mix(val);
     }
-    // If value is larger than all boundaries, it goes in the +Inf bucket
-    return boundaries.size();
+    return hash;
 }
 
 /**
- * @brief Calculates cumulative counts for histogram buckets.
- * @param bucket_counts Per-bucket counts.
- * @return Cumulative counts vector.
+ * @brief Checks stored series labels against attributes without interning them.
+ *
+ * Used to rule out fingerprint collisions; both sides are in key order.
+ * @param labels Interned labels of a candidate series.
+ * @param attributes Key-value attributes being looked up.
+ * @return True if both describe the same series.
  */
-std::vector<uint64_t> IoTMetricsServer::calculateCumulativeCounts(const std::vector<uint64_t>& bucket_counts) {
-    std::vector<uint64_t> cumulative_counts;
-    cumulative_counts.reserve(bucket_counts.size());
-
-    uint64_t cumulative = 0;
-    for (uint64_t count : bucket_counts) {
-        cumulative += count;
-        cumulative_counts.push_back(cumulative);
+bool IoTMetricsServer::labelsMatch(const LabelSet& labels, const std::map<std::string, std::string>& attributes) const {
+    if (labels.size() != attributes.size()) {
+        return false;
     }
-
-    return cumulative_counts;
+    auto label = labels.begin();
+    for (const auto& [key, val] : attributes) {
+        if (label_pool_.view(label->key) != key || label_pool_.view(label->value) != val) {
+            return false;
+        }
+        ++label;
+    }
+    return true;
 }
 
 //==============================================================================
@@ -1126,8 +5356,10 @@ bool IoTMetricsServer::validateMetricRequest(const nlohmann::json& request, std:
     if (instrument_type != "counter" &&
         instrument_type != "updowncounter" &&
         instrument_type != "histogram" &&
+        instrument_type != "exponential_histogram" &&
+        instrument_type != "summary" &&
         instrument_type != "gauge") {
-        error_msg = "instrument_type must be one of the OpenTelemetry synchronous instruments: counter, updowncounter, histogram, gauge";
+        error_msg = "instrument_type must be one of the supported instruments: counter, updowncounter, histogram, exponential_histogram, summary, gauge";
         return false;
     }
 
@@ -1137,8 +5369,17 @@ bool IoTMetricsServer::validateMetricRequest(const nlohmann::json& request, std:
         return false;
     }
 
-    double value = request["value"].get<double>();
+    return validateMetricValue(instrument_type, request["value"].get<double>(), error_msg);
+}
 
+/**
+ * @brief Validates a value against the semantic rules of its instrument type.
+ * @param instrument_type Type of instrument.
+ * @param value Value to record.
+ * @param error_msg Output error message if invalid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::validateMetricValue(const std::string& instrument_type, double value, std::string& error_msg) {
     // Validate Counter semantic rules (must be non-negative and monotonic)
     if (instrument_type == "counter" && value < 0) {
         error_msg = "Counter values must be non-negative (OpenTelemetry rule)";
@@ -1146,11 +5387,148 @@ bool IoTMetricsServer::validateMetricRequest(const nlohmann::json& request, std:
     }
 
     // Validate Histogram values (must be finite)
-    if (instrument_type == "histogram" && !std::isfinite(value)) {
+    if ((instrument_type == "histogram" || instrument_type == "exponential_histogram") && !std::isfinite(value)) {
         error_msg = "Histogram values must be finite (no NaN or infinity)";
         return false;
     }
 
+    // Validate Summary values (must be finite)
+    if (instrument_type == "summary" && !std::isfinite(value)) {
+        error_msg = "Summary values must be finite (no NaN or infinity)";
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Validates submitted histogram bucket boundaries.
+ * @param instrument_type Type of instrument (boundaries are only valid for histograms).
+ * @param boundaries Boundaries to check.
+ * @param error_msg Output error message if invalid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::validateBoundaries(const std::string& instrument_type,
+    const std::vector<double>& boundaries, std::string& error_msg) {
+    if (instrument_type != "histogram") {
+        error_msg = "boundaries are only valid for histogram instruments";
+        return false;
+    }
+    if (boundaries.empty() || boundaries.size() > max_histogram_boundaries_) {
+        error_msg = "boundaries must contain between 1 and " + std::to_string(max_histogram_boundaries_) + " values";
+        return false;
+    }
+    for (size_t i = 0; i < boundaries.size(); ++i) {
+        if (!std::isfinite(boundaries[i])) {
+            error_msg = "boundaries must be finite";
+            return false;
+        }
+        if (i > 0 && boundaries[i] <= boundaries[i - 1]) {
+            error_msg = "boundaries must be strictly increasing";
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Validates a metric submission and decodes it into a MetricPoint.
+ * @param request JSON request object.
+ * @param point Output metric point if valid.
+ * @param error_msg Output error message if invalid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::parseMetricPoint(const nlohmann::json& request, MetricPoint& point, std::string& error_msg) {
+    if (!validateMetricRequest(request, error_msg)) {
+        return false;
+    }
+
+    point.metric_name = request["metric_name"].get<std::string>();
+    point.instrument_type = request["instrument_type"].get<std::string>();
+    point.value = request["value"].get<double>();
+    point.unit = request.value("unit", "");
+    point.description = request.value("description", "");
+
+    point.attributes.clear();
+    if (request.contains("attributes")) {
+        for (auto& [key, val] : request["attributes"].items()) {
+            point.attributes[key] = val.get<std::string>();
+        }
+    }
+
+    point.boundaries.clear();
+    if (request.contains("boundaries")) {
+        const json& boundaries = request["boundaries"];
+        if (!boundaries.is_array()) {
+            error_msg = "boundaries must be an array of numbers";
+            return false;
+        }
+        for (const auto& boundary : boundaries) {
+            if (!boundary.is_number()) {
+                error_msg = "boundaries must be an array of numbers";
+                return false;
+            }
+            point.boundaries.push_back(boundary.get<double>());
+        }
+        if (!validateBoundaries(point.instrument_type, point.boundaries, error_msg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Validates a fast-path parsed submission and copies it into a MetricPoint.
+ *
+ * Mirrors validateMetricRequest() so both parsers accept and reject the same
+ * payloads with the same messages.
+ * @param view Fields parsed by FastMetricParser.
+ * @param point Output metric point if valid.
+ * @param error_msg Output error message if invalid.
+ * @return true if valid, false otherwise.
+ */
+bool IoTMetricsServer::parseMetricPoint(const MetricPointView& view, MetricPoint& point, std::string& error_msg) {
+    if (!view.has_metric_name) {
+        error_msg = "Missing required field: metric_name";
+        return false;
+    }
+    if (!view.has_instrument_type) {
+        error_msg = "Missing required field: instrument_type";
+        return false;
+    }
+    if (!view.has_value) {
+        error_msg = "Missing required field: value";
+        return false;
+    }
+
+    point.instrument_type.assign(view.instrument_type.data(), view.instrument_type.size());
+    if (point.instrument_type != "counter" &&
+        point.instrument_type != "updowncounter" &&
+        point.instrument_type != "histogram" &&
+        point.instrument_type != "exponential_histogram" &&
+        point.instrument_type != "summary" &&
+        point.instrument_type != "gauge") {
+        error_msg = "instrument_type must be one of the supported instruments: counter, updowncounter, histogram, exponential_histogram, summary, gauge";
+        return false;
+    }
+    if (!validateMetricValue(point.instrument_type, view.value, error_msg)) {
+        return false;
+    }
+
+    point.metric_name.assign(view.metric_name.data(), view.metric_name.size());
+    point.value = view.value;
+    point.unit.assign(view.unit.data(), view.unit.size());
+    point.description.assign(view.description.data(), view.description.size());
+
+    point.attributes.clear();
+    for (const auto& [key, val] : view.attributes) {
+        point.attributes[std::string(key)].assign(val.data(), val.size());
+    }
+
+    point.boundaries.assign(view.boundaries.begin(), view.boundaries.end());
+    if (view.has_boundaries && !validateBoundaries(point.instrument_type, point.boundaries, error_msg)) {
+        return false;
+    }
     return true;
 }
 
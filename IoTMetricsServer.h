@@ -2,12 +2,29 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
+#include <array>
 #include <mutex>
+#include <shared_mutex>
 #include <limits>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <list>
+#include <unordered_map>
 #include <httplib.h>
 #include <nlohmann/json.hpp>
+#include "LabelPool.h"
+#include "SeriesTable.h"
+#include "ProtoWriter.h"
+#include "TextWriter.h"
+#include "ExponentialHistogram.h"
+#include "QuantileSketch.h"
+#include "SlotStore.h"
+#include "WriteAheadLog.h"
+#include "FastMetricParser.h"
 
 // OpenTelemetry includes
 #include <opentelemetry/sdk/metrics/meter_provider.h>
@@ -24,14 +41,16 @@ namespace prometheus_exporter = opentelemetry::exporter::metrics;
 
 /// @brief IoTMetricsServer provides an HTTP API for ingesting and exporting OpenTelemetry metrics.
 /// 
-/// This server supports Counter, UpDownCounter, Histogram, and Gauge instruments,
+/// This server supports Counter, UpDownCounter, Histogram, exponential Histogram, Summary and Gauge instruments,
 /// and exposes Prometheus-compatible endpoints.
 class IoTMetricsServer {
 public:
     /// @brief Construct a new IoTMetricsServer.
     /// @param port The port for the main API server (default: 8080).
     /// @param metrics_port The port for the Prometheus metrics endpoint (default: 9090).
-    IoTMetricsServer(int port = 8080, int metrics_port = 9090);
+    /// @param binary_port The TCP port for binary frame ingestion (default: 0, disabled).
+    /// @param statsd_port The UDP port for StatsD line ingestion (default: 0, disabled).
+    IoTMetricsServer(int port = 8080, int metrics_port = 9090, int binary_port = 0, int statsd_port = 0);
 
     /// @brief Destructor. Stops the server if running.
     ~IoTMetricsServer();
@@ -54,8 +73,23 @@ private:
     /// @brief Prometheus metrics endpoint port.
     int metrics_port_;
 
-    /// @brief Indicates if the server is running.
-    bool server_running_;
+    /// @brief Binary ingestion TCP port (0 disables the listener).
+    int binary_port_;
+
+    /// @brief StatsD ingestion UDP port (0 disables the listener).
+    int statsd_port_;
+
+    /// @brief Indicates if the server is running (read by stop() from other threads).
+    std::atomic<bool> server_running_;
+
+    /// @brief Serializes starting and stopping the side threads, so exactly one caller joins each of them.
+    std::mutex lifecycle_mutex_;
+
+    /// @brief Stop the side listeners, the sweeper and the snapshotter.
+    ///
+    /// Safe to call from start()'s return path, stop() and the destructor at once: the first caller
+    /// joins the threads (and takes the final snapshot), later ones find nothing left to do.
+    void stopServices();
 
     /// @brief Pointer to the HTTP server instance.
     std::unique_ptr<httplib::Server> http_server_;
@@ -68,11 +102,147 @@ private:
         0, 5, 10, 25, 50, 75, 100, 250, 500, 750, 1000, 2500, 5000, 7500, 10000
     };
 
+    /// @brief Maximum number of boundaries a histogram may register.
+    const size_t max_histogram_boundaries_ = 256;
+
+    /// @brief Histogram boundaries by metric name, loaded from the views file at startup (read-only afterwards).
+    std::unordered_map<std::string, std::vector<double>> histogram_views_;
+
+    /// @brief Writes whose boundaries differed from the ones already registered for their histogram.
+    std::atomic<uint64_t> histogram_boundary_conflicts_{ 0 };
+
+    /// @brief Default quantiles reported by summaries.
+    const std::vector<double> default_summary_quantiles_ = { 0.5, 0.9, 0.95, 0.99 };
+
+    /// @brief Maximum number of quantiles a summary may report.
+    const size_t max_summary_quantiles_ = 32;
+
+    /// @brief Summary quantiles by metric name, loaded from the views file at startup (read-only afterwards).
+    std::unordered_map<std::string, std::vector<double>> summary_views_;
+
+    //==============================================================================
+    // CARDINALITY LIMITS
+    //==============================================================================
+
+    /// @brief Maximum number of series per metric (IOT_METRICS_MAX_SERIES_PER_METRIC), not counting the overflow series.
+    size_t max_series_per_metric_ = 2000;
+
+    /// @brief Maximum number of series in the whole store (IOT_METRICS_MAX_SERIES).
+    size_t max_series_ = 200000;
+
+    /// @brief Maximum number of metrics (families of any type) in the store (IOT_METRICS_MAX_METRICS),
+    /// not counting the overflow metrics.
+    size_t max_metrics_ = 10000;
+
+    /// @brief Attributes of the series that absorbs writes past a limit (as in the OpenTelemetry SDK).
+    static const std::map<std::string, std::string> overflow_attributes_;
+
+    /// @brief Description of the metrics that absorb writes to new metrics past max_metrics_.
+    static const std::string overflow_metric_description_;
+
+    /// @brief Estimates the number of distinct keys seen, in fixed memory.
+    ///
+    /// Linear counting over a 4096-bit bitmap: exact in practice for a few
+    /// hundred keys, within a few percent up to about 20000, and saturating at
+    /// about 34000. Bits are set atomically, so one counter may be shared by
+    /// threads holding different shard locks.
+    struct DistinctCounter {
+        /// @brief Bitmap of the hashed keys seen.
+        std::array<std::atomic<uint64_t>, 64> bits{};
+
+        /// @brief Record a key.
+        /// @param hash 64-bit hash of the key.
+        void add(uint64_t hash);
+        /// @brief Estimated number of distinct keys recorded.
+        uint64_t estimate() const;
+    };
+
+    /// @brief Number of series in the store.
+    std::atomic<size_t> series_count_{ 0 };
+
+    /// @brief Number of metrics (families of any type) in the store.
+    std::atomic<size_t> family_count_{ 0 };
+
+    /// @brief Writes redirected to an overflow series, across all metrics.
+    std::atomic<uint64_t> overflow_points_{ 0 };
+
+    /// @brief Distinct series refused by a series limit, across all metrics.
+    DistinctCounter rejected_series_;
+
+    /// @brief Writes redirected to an overflow metric by the metric limit.
+    std::atomic<uint64_t> overflow_metric_points_{ 0 };
+
+    /// @brief Distinct metric names refused by the metric limit.
+    DistinctCounter rejected_metrics_;
+
+    //==============================================================================
+    // SERIES EXPIRY
+    //==============================================================================
+
+    /// @brief Number of family kinds, in exposition order: counters, updowncounters, histograms,
+    /// exponential histograms, summaries, gauges.
+    static constexpr size_t family_kind_count_ = 6;
+
+    /// @brief Shards the sweeper examines per tick.
+    static constexpr size_t sweep_shards_per_tick_ = 8;
+
+    /// @brief Interval between sweeper ticks.
+    static constexpr std::chrono::milliseconds sweep_interval_{ 250 };
+
+    /// @brief Series TTL in seconds per family kind (0 keeps series forever), from IOT_METRICS_SERIES_TTL[_<TYPE>].
+    std::array<int64_t, family_kind_count_> series_ttl_seconds_{};
+
+    /// @brief Seconds on a steady clock, advanced by the sweeper, used to stamp series updates.
+    std::atomic<int64_t> clock_seconds_{ 0 };
+
+    /// @brief Next shard the sweeper examines.
+    size_t sweep_cursor_ = 0;
+
+    /// @brief Series evicted by the sweeper.
+    std::atomic<uint64_t> series_evicted_{ 0 };
+
+    /// @brief Bumped whenever counter/updowncounter series are evicted; tells the per-thread caches to prune.
+    std::atomic<uint64_t> sum_eviction_generation_{ 0 };
+
+    /// @brief Thread evicting stale series (runs only when a TTL is set).
+    std::thread sweeper_thread_;
+
+    /// @brief Read the series TTLs from IOT_METRICS_SERIES_TTL and IOT_METRICS_SERIES_TTL_<TYPE>.
+    /// @throws std::runtime_error if a value is not a non-negative integer.
+    void loadSeriesTtls();
+
+    /// @brief Current steady-clock time in whole seconds.
+    static int64_t steadySeconds();
+
+    /// @brief Start the sweeper thread if any TTL is set.
+    void startSweeper();
+
+    /// @brief Join the sweeper thread.
+    void stopSweeper();
+
+    /// @brief Sweeper loop: advance the clock and sweep a slice of shards each tick.
+    void runSweeper();
+
+    /// @brief Evict stale series from the next count shards, locking one shard at a time.
+    /// @param count Number of shards to examine.
+    /// @return Number of series evicted.
+    size_t sweepShards(size_t count);
+
+    /// @brief Evict the series a predicate selects from every family of one kind, dropping families left empty.
+    /// @note Caller must hold the families' shard mutex.
+    /// @param families Families of one kind.
+    /// @param is_stale Predicate called with each series entry.
+    /// @return Number of series evicted.
+    template <typename Family, typename IsStale>
+    size_t evictSeries(std::map<std::string, Family>& families, IsStale&& is_stale);
+
     //==============================================================================
     // HISTOGRAM STATE MANAGEMENT
     //==============================================================================
 
     /// @brief Tracks the state of a histogram for a given metric and attribute set.
+    ///
+    /// Boundaries belong to the HistogramFamily and are passed in on each write.
     struct HistogramState {
         /// @brief Total number of recorded values.
         uint64_t count = 0;
@@ -82,35 +252,412 @@ private:
         double min = std::numeric_limits<double>::max();
         /// @brief Maximum recorded value.
         double max = std::numeric_limits<double>::lowest();
-        /// @brief Counts for each histogram bucket.
+        /// @brief Counts for each histogram bucket (one more than the family's boundaries).
         std::vector<uint64_t> bucket_counts;
-        /// @brief Histogram bucket boundaries.
-        std::vector<double> boundaries;
 
         /// @brief Default constructor.
         HistogramState() = default;
 
-        /// @brief Construct with custom bucket boundaries.
-        /// @param bounds The histogram bucket boundaries.
-        HistogramState(const std::vector<double>& bounds) : boundaries(bounds) {
-            bucket_counts.resize(bounds.size() + 1, 0);
-        }
+        /// @brief Construct with one bucket per boundary plus +Inf.
+        /// @param boundary_count Number of bucket boundaries.
+        explicit HistogramState(size_t boundary_count) : bucket_counts(boundary_count + 1, 0) {}
+
+        /// @brief Record one value.
+        /// @param value Value to record.
+        /// @param boundaries The family's bucket boundaries.
+        /// @return Index of the bucket the value fell into.
+        size_t observe(double value, const std::vector<double>& boundaries);
+
+        /// @brief Record an array of values, binning them in one pass.
+        /// @param values Values to record.
+        /// @param value_count Number of values.
+        /// @param boundaries The family's bucket boundaries.
+        void observeMany(const double* values, size_t value_count, const std::vector<double>& boundaries);
+    };
+
+    //==============================================================================
+    // INGESTION TYPES
+    //==============================================================================
+
+    /// @brief A single validated metric submission, decoded from any ingestion path.
+    struct MetricPoint {
+        /// @brief Name of the metric.
+        std::string metric_name;
+        /// @brief Type of instrument ("counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge").
+        std::string instrument_type;
+        /// @brief Value to record.
+        double value = 0.0;
+        /// @brief Key-value attributes for the metric.
+        std::map<std::string, std::string> attributes;
+        /// @brief Unit of measurement.
+        std::string unit;
+        /// @brief Metric description.
+        std::string description;
+        /// @brief Histogram bucket boundaries to register (empty if not given).
+        std::vector<double> boundaries;
     };
 
+    /// @brief Maximum number of metric entries accepted in one batch request.
+    const size_t max_batch_size_ = 10000;
+
+    /// @brief Maximum number of per-item errors echoed back in a batch response.
+    const size_t max_batch_errors_ = 100;
+
+    /// @brief Maximum length of a single NDJSON line on the streaming ingestion route.
+    const size_t max_stream_line_length_ = 64 * 1024;
+
+    /// @brief Maximum body length of a single binary ingestion frame.
+    const size_t max_binary_frame_length_ = 64 * 1024;
+
+    /// @brief Maximum number of binary ingestion connections served at once (each has its own thread).
+    const size_t max_binary_connections_ = 256;
+
+    //==============================================================================
+    // BINARY INGESTION LISTENER
+    //==============================================================================
+
+    /// @brief Instrument kind byte carried in each binary frame.
+    enum class BinaryInstrumentKind : uint8_t {
+        Counter = 1,
+        UpDownCounter = 2,
+        Histogram = 3,
+        Gauge = 4,
+        ExponentialHistogram = 5,
+        Summary = 6
+    };
+
+    /// @brief A connection served by its own thread on the binary listener.
+    struct BinaryConnection {
+        /// @brief Thread reading frames from the connection.
+        std::thread thread;
+        /// @brief Set by the thread once the connection is closed.
+        std::atomic<bool> done{ false };
+    };
+
+    /// @brief Listening socket for binary ingestion.
+    socket_t binary_listen_socket_ = INVALID_SOCKET;
+    /// @brief Thread accepting binary ingestion connections.
+    std::thread binary_accept_thread_;
+    /// @brief Active binary ingestion connections.
+    std::list<std::unique_ptr<BinaryConnection>> binary_connections_;
+    /// @brief Keeps the side listeners' loops running.
+    std::atomic<bool> listeners_running_{ false };
+    /// @brief Number of binary frames recorded.
+    std::atomic<uint64_t> binary_frames_accepted_{ 0 };
+    /// @brief Number of binary frames rejected.
+    std::atomic<uint64_t> binary_frames_rejected_{ 0 };
+    /// @brief Number of binary connections closed on accept because max_binary_connections_ were open.
+    std::atomic<uint64_t> binary_connections_rejected_{ 0 };
+
+    /// @brief Open the binary ingestion socket and start the accept thread.
+    /// @return true if listening (or disabled), false if the socket could not be bound.
+    bool startBinaryListener();
+
+    /// @brief Stop the binary ingestion listener and join its connection threads.
+    void stopBinaryListener();
+
+    /// @brief Accept loop for the binary ingestion listener.
+    void runBinaryAcceptLoop();
+
+    /// @brief Read and record frames from one binary ingestion connection.
+    /// @param client Connected client socket (closed on return).
+    void serveBinaryConnection(socket_t client);
+
+    /// @brief Decode one binary frame body into a MetricPoint.
+    ///
+    /// Layout: kind (1 byte), varint-prefixed name, varint attribute count followed by
+    /// varint-prefixed key/value pairs, value as a little-endian IEEE 754 double, then
+    /// optionally varint-prefixed unit and description, then optionally histogram
+    /// boundaries as a varint count followed by little-endian doubles.
+    /// @param data Frame body (without the length prefix).
+    /// @param length Frame body length.
+    /// @param point Output metric point if valid.
+    /// @param error_msg Output error message if invalid.
+    /// @return true if valid, false otherwise.
+    bool decodeBinaryFrame(const uint8_t* data, size_t length, MetricPoint& point, std::string& error_msg);
+
+    /// @brief Append a write as a varint length-prefixed binary frame (the layout decodeBinaryFrame reads).
+    /// @param out Buffer to append to.
+    /// @param metric_name Name of the metric.
+    /// @param instrument_type Type of instrument.
+    /// @param value Value recorded.
+    /// @param attributes Key-value attributes.
+    /// @param unit Unit of measurement.
+    /// @param description Metric description.
+    /// @param boundaries Histogram bucket boundaries (omitted from the frame if empty).
+    static void appendBinaryFrame(std::string& out,
+        const std::string& metric_name,
+        const std::string& instrument_type,
+        double value,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
+        const std::string& description,
+        const std::vector<double>& boundaries);
+
+    //==============================================================================
+    // STATSD INGESTION LISTENER
+    //==============================================================================
+
+    /// @brief Number of datagrams read per receive call on the StatsD listener.
+    static constexpr size_t statsd_batch_size_ = 64;
+    /// @brief Maximum StatsD datagram size accepted.
+    static constexpr size_t statsd_max_datagram_ = 8192;
+
+    /// @brief UDP socket for StatsD ingestion.
+    socket_t statsd_socket_ = INVALID_SOCKET;
+    /// @brief Thread reading StatsD datagrams.
+    std::thread statsd_thread_;
+    /// @brief Number of StatsD lines recorded.
+    std::atomic<uint64_t> statsd_lines_accepted_{ 0 };
+    /// @brief Number of StatsD lines rejected.
+    std::atomic<uint64_t> statsd_lines_rejected_{ 0 };
+
+    /// @brief Open the StatsD UDP socket and start the receive thread.
+    /// @return true if listening (or disabled), false if the socket could not be bound.
+    bool startStatsdListener();
+
+    /// @brief Stop the StatsD listener and join its receive thread.
+    void stopStatsdListener();
+
+    /// @brief Receive loop for the StatsD listener (batched with recvmmsg where available).
+    void runStatsdLoop();
+
+    /// @brief Parse every line of a StatsD datagram and append the valid points.
+    /// @param data Datagram payload.
+    /// @param length Payload length.
+    /// @param points Output metric points.
+    void parseStatsdDatagram(const char* data, size_t length, std::vector<MetricPoint>& points);
+
+    /// @brief Parse one StatsD line (name:value|type[|@rate][|#tag:val,...]).
+    ///
+    /// Types map to instruments as c -> counter, g -> gauge, ms/h/d -> histogram.
+    /// @param line Line text without the trailing newline.
+    /// @param point Output metric point if valid.
+    /// @return true if valid, false otherwise.
+    bool parseStatsdLine(std::string_view line, MetricPoint& point);
+
     //==============================================================================
     // METRIC STORAGE
     //==============================================================================
 
-    /// @brief Storage for Counter metrics (name -> MetricData).
-    std::map<std::string, std::unique_ptr<metrics_sdk::MetricData>> counter_metrics_;
-    /// @brief Storage for UpDownCounter metrics (name -> MetricData).
-    std::map<std::string, std::unique_ptr<metrics_sdk::MetricData>> updowncounter_metrics_;
-    /// @brief Storage for Histogram metrics (name -> MetricData).
-    std::map<std::string, std::unique_ptr<metrics_sdk::MetricData>> histogram_metrics_;
-    /// @brief Storage for Gauge metrics (name -> MetricData).
-    std::map<std::string, std::unique_ptr<metrics_sdk::MetricData>> gauge_metrics_;
-    /// @brief Histogram state tracking (metric_name -> attribute_key -> state).
-    std::map<std::string, std::map<std::string, HistogramState>> histogram_states_;
+    /// @brief Number of per-thread cells each counter/updowncounter series is striped over.
+    static constexpr size_t sum_cell_count_ = 8;
+
+    /// @brief One cache-line-sized cell of a SumSeries, written by the threads mapped to it.
+    struct alignas(64) SumCell {
+        /// @brief Partial total accumulated by this cell.
+        std::atomic<double> value{ 0.0 };
+    };
+
+    /// @brief A counter or updowncounter series accumulated without locks.
+    ///
+    /// Each worker thread adds into its own padded cell; readers sum the cells.
+    /// With the slot store enabled the total lives in a value slot instead and
+    /// the cells are released.
+    struct SumSeries {
+        /// @brief Per-thread partial totals (for a slot-backed series, what was added since the last fold).
+        std::unique_ptr<std::array<SumCell, sum_cell_count_>> cells;
+        /// @brief Memory-mapped slot holding the folded total (empty for an in-memory series).
+        /// @note Touched only under the shard lock, so the sweeper can release it from an evicted series.
+        SlotStore::Handle slot;
+        /// @brief Set (before the series is published) when it is given a slot, and never cleared; lock-free writers read this, not slot.
+        bool slot_backed = false;
+        /// @brief Coarse time of the last add, in seconds (see clock_seconds_).
+        std::atomic<int64_t> last_update{ 0 };
+        /// @brief Set under the shard lock once the sweeper has evicted the series; cached holders must look it up again.
+        std::atomic<bool> retired{ false };
+
+        /// @brief Construct an in-memory series.
+        SumSeries();
+        /// @brief Construct a series whose total lives in a slot.
+        explicit SumSeries(SlotStore::Handle value_slot);
+
+        /// @brief Move the total into a slot.
+        /// @note Caller holds the shard lock.
+        void moveToSlot(SlotStore::Handle value_slot);
+
+        /// @brief Add to the calling thread's cell (lock-free).
+        /// @param value Value to add.
+        /// @param now Coarse time of the write, in seconds.
+        void add(double value, int64_t now);
+
+        /// @brief Move what the cells hold into the slot (no-op for an in-memory series).
+        /// @note Caller holds the shard lock.
+        void fold();
+
+        /// @brief Sum the slot and all cells.
+        /// @note Caller holds the shard lock (a concurrent fold() could otherwise hide a cell's share).
+        /// @return The current total.
+        double read() const;
+    };
+
+    /// @brief Cached exposition text of one series.
+    ///
+    /// The label part is rendered once; the sample lines are re-rendered only
+    /// when the value they were built from changes.
+    struct SeriesRender {
+        /// @brief Formatted labels, e.g. {k="v"} (empty for no attributes).
+        std::string labels;
+        /// @brief Sample lines rendered at the last text scrape (shared by both text formats; OpenMetrics
+        /// counters only swap in the _total sample name).
+        std::string lines;
+        /// @brief Bits of the value (or the histogram count) the lines were rendered from.
+        uint64_t rendered_key = 0;
+        /// @brief Whether lines have been rendered at all.
+        bool valid = false;
+        /// @brief Whether labels has been rendered.
+        bool labels_valid = false;
+        /// @brief Labels encoded as repeated protobuf LabelPair fields.
+        std::string proto_labels;
+        /// @brief Whether proto_labels has been encoded.
+        bool proto_labels_valid = false;
+    };
+
+    /// @brief Cached exposition text of a family; series are parallel to the family's SeriesTable.
+    struct FamilyRender {
+        /// @brief Sanitized metric name.
+        std::string sanitized_name;
+        /// @brief Description the header was rendered from.
+        std::string description;
+        /// @brief HELP/TYPE lines by text format: [0] 0.0.4 text, [1] OpenMetrics (HELP escaping and the
+        /// counter family name differ).
+        std::array<std::string, 2> headers;
+        /// @brief Per-series render state, in series insertion order.
+        std::vector<SeriesRender> series;
+    };
+
+    /// @brief A counter or updowncounter metric and all of its series.
+    struct SumFamily {
+        /// @brief Instrument name, unit, description and type.
+        metrics_sdk::InstrumentDescriptor descriptor;
+        /// @brief Series by attribute fingerprint. Shared with the per-thread write caches.
+        SeriesTable<std::shared_ptr<SumSeries>> series;
+        /// @brief Exposition cache (touched only by scrapes).
+        FamilyRender render;
+        /// @brief Writes redirected to the overflow series by a series limit.
+        uint64_t overflow_points = 0;
+        /// @brief Distinct series refused by a series limit (allocated on the first refusal).
+        std::unique_ptr<DistinctCounter> rejected_series;
+    };
+
+    /// @brief A histogram metric and all of its series, updated in place.
+    struct HistogramFamily {
+        /// @brief Instrument name, unit, description and type.
+        metrics_sdk::InstrumentDescriptor descriptor;
+        /// @brief Bucket boundaries shared by every series, fixed on the first write.
+        std::vector<double> boundaries;
+        /// @brief Series state by attribute fingerprint.
+        SeriesTable<HistogramState> series;
+        /// @brief Exposition cache (touched only by scrapes).
+        FamilyRender render;
+        /// @brief Writes redirected to the overflow series by a series limit.
+        uint64_t overflow_points = 0;
+        /// @brief Distinct series refused by a series limit (allocated on the first refusal).
+        std::unique_ptr<DistinctCounter> rejected_series;
+    };
+
+    /// @brief An exponential histogram metric and all of its series, updated in place.
+    struct ExponentialHistogramFamily {
+        /// @brief Instrument name, unit, description and type.
+        metrics_sdk::InstrumentDescriptor descriptor;
+        /// @brief Series state by attribute fingerprint.
+        SeriesTable<ExponentialHistogram> series;
+        /// @brief Exposition cache (touched only by scrapes).
+        FamilyRender render;
+        /// @brief Writes redirected to the overflow series by a series limit.
+        uint64_t overflow_points = 0;
+        /// @brief Distinct series refused by a series limit (allocated on the first refusal).
+        std::unique_ptr<DistinctCounter> rejected_series;
+    };
+
+    /// @brief A summary metric and all of its series, each a quantile sketch updated in place.
+    struct SummaryFamily {
+        /// @brief Instrument name, unit, description and type.
+        metrics_sdk::InstrumentDescriptor descriptor;
+        /// @brief Quantiles reported for every series, fixed on the first write.
+        std::vector<double> quantiles;
+        /// @brief Series state by attribute fingerprint.
+        SeriesTable<QuantileSketch> series;
+        /// @brief Exposition cache (touched only by scrapes).
+        FamilyRender render;
+        /// @brief Writes redirected to the overflow series by a series limit.
+        uint64_t overflow_points = 0;
+        /// @brief Distinct series refused by a series limit (allocated on the first refusal).
+        std::unique_ptr<DistinctCounter> rejected_series;
+    };
+
+    /// @brief The last value set on a gauge series.
+    struct GaugeSeries {
+        /// @brief Current value (unused while the value lives in a slot).
+        double value = 0.0;
+        /// @brief Memory-mapped slot holding the value (empty for an in-memory series).
+        SlotStore::Handle slot;
+
+        /// @brief Current value.
+        double read() const { return slot ? slot.load() : value; }
+        /// @brief Set the value.
+        void set(double new_value) {
+            if (slot) slot.store(new_value);
+            else value = new_value;
+        }
+    };
+
+    /// @brief A gauge metric and all of its series, updated in place.
+    struct GaugeFamily {
+        /// @brief Instrument name, unit, description and type.
+        metrics_sdk::InstrumentDescriptor descriptor;
+        /// @brief Series by attribute fingerprint.
+        SeriesTable<GaugeSeries> series;
+        /// @brief Exposition cache (touched only by scrapes).
+        FamilyRender render;
+        /// @brief Writes redirected to the overflow series by a series limit.
+        uint64_t overflow_points = 0;
+        /// @brief Distinct series refused by a series limit (allocated on the first refusal).
+        std::unique_ptr<DistinctCounter> rejected_series;
+        /// @brief Value of the most recent write to any series.
+        double last_value = 0.0;
+    };
+
+    /// @brief Number of lock stripes the metric store is split into.
+    static constexpr size_t metric_shard_count_ = 64;
+
+    /// @brief One lock stripe of the metric store.
+    ///
+    /// A metric name always hashes to the same shard, so all series of a metric
+    /// live together and writes to metrics on different shards never contend.
+    struct MetricShard {
+        /// @brief Mutex protecting every map in this shard.
+        std::mutex mutex;
+        /// @brief Storage for Counter metrics (name -> family).
+        std::map<std::string, SumFamily> counter_families;
+        /// @brief Storage for UpDownCounter metrics (name -> family).
+        std::map<std::string, SumFamily> updowncounter_families;
+        /// @brief Storage for Histogram metrics (name -> family).
+        std::map<std::string, HistogramFamily> histogram_families;
+        /// @brief Storage for exponential Histogram metrics (name -> family).
+        std::map<std::string, ExponentialHistogramFamily> exponential_histogram_families;
+        /// @brief Storage for Summary metrics (name -> family).
+        std::map<std::string, SummaryFamily> summary_families;
+        /// @brief Storage for Gauge metrics (name -> family).
+        std::map<std::string, GaugeFamily> gauge_families;
+    };
+
+    /// @brief Interned attribute keys and values shared by every series.
+    ///
+    /// Append-only: evicting a series does not free its strings, so attribute
+    /// values that never recur grow the pool for the life of the server.
+    LabelPool label_pool_;
+
+    /// @brief The metric store, striped by metric name.
+    std::array<MetricShard, metric_shard_count_> shards_;
+
+    /// @brief Identifies this instance in the per-thread SumSeries caches.
+    const uint64_t instance_id_;
+
+    /// @brief Get the shard that owns a metric name.
+    /// @param name Metric name.
+    /// @return The owning shard.
+    MetricShard& shardFor(std::string_view name);
 
     //==============================================================================
     // CUSTOM PROMETHEUS EXPORT METHODS
@@ -123,53 +670,233 @@ private:
     /// @return Formatted Prometheus metrics as a string.
     std::string formatPrometheusMetrics();
 
-    /// @brief Format a Counter metric for Prometheus.
+    /// @brief Target size of one chunk of a streamed /metrics response.
+    static constexpr size_t exposition_chunk_size_ = 64 * 1024;
+
+    /// @brief Wire formats /metrics can be served in.
+    enum class ExpositionFormat {
+        PrometheusText,   ///< text/plain; version=0.0.4
+        OpenMetricsText,  ///< application/openmetrics-text; version=1.0.0
+        Protobuf          ///< Delimited io.prometheus.client.MetricFamily messages
+    };
+
+    /// @brief Pick the exposition format from an Accept header.
+    /// @param accept Accept header value; the recognized media type with the highest q wins
+    ///        (the first listed on a tie), and q=0 rules a type out.
+    /// @return Negotiated format (PrometheusText if nothing else matches).
+    static ExpositionFormat negotiateExpositionFormat(const std::string& accept);
+
+    /// @brief Read the q parameter of one element of an Accept or Accept-Encoding header.
+    /// @param element Media range or content coding with its parameters.
+    /// @return The quality in [0, 1] (1 if absent or malformed).
+    static double acceptQuality(std::string_view element);
+
+    /// @brief Check whether an Accept-Encoding header allows gzip.
+    /// @param accept_encoding Accept-Encoding header value.
+    /// @return True if gzip (or *) is listed with a non-zero q.
+    static bool acceptsGzip(const std::string& accept_encoding);
+
+    /// @brief Content-Type of an exposition format.
+    static const char* expositionContentType(ExpositionFormat format);
+
+    /// @brief Position of a chunked exposition within the store.
+    struct ExpositionCursor {
+        /// @brief Format being rendered.
+        ExpositionFormat format = ExpositionFormat::PrometheusText;
+        /// @brief Whether the comment preamble has been written.
+        bool preamble_written = false;
+        /// @brief Whether the closing marker (OpenMetrics # EOF) has been written.
+        bool finished = false;
+        /// @brief Shard being exported.
+        size_t shard = 0;
+        /// @brief Family kind being exported: counters, updowncounters, histograms, exponential histograms, summaries, gauges.
+        int kind = 0;
+        /// @brief Whether last_family holds a position to resume after.
+        bool resuming = false;
+        /// @brief Name of the last family written in the current kind.
+        std::string last_family;
+    };
+
+    /// @brief Render the next chunk of the exposition.
+    ///
+    /// Whole families are appended until the chunk reaches exposition_chunk_size_;
+    /// each shard is locked only while its families are rendered.
+    /// @param cursor Position to continue from; advanced past the rendered families.
+    /// @param buffer Reusable buffer, cleared and filled with the chunk.
+    /// @return False once the exposition is complete and nothing was rendered.
+    bool renderMetricsChunk(ExpositionCursor& cursor, std::string& buffer);
+
+    /// @brief Append a Counter metric in Prometheus format.
+    /// @param name Metric name.
+    /// @param family Counter family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatCounterForPrometheus(const std::string& name,
+        SumFamily& family, std::string& output);
+
+    /// @brief Append an UpDownCounter metric in Prometheus format.
+    /// @param name Metric name.
+    /// @param family UpDownCounter family (caller holds its shard's mutex).
+    /// @param format PrometheusText or OpenMetricsText (selects the cached header).
+    /// @param output Exposition buffer to append to.
+    void formatUpDownCounterForPrometheus(const std::string& name,
+        SumFamily& family, ExpositionFormat format, std::string& output);
+
+    /// @brief Append a Histogram metric in Prometheus format.
+    /// @param name Metric name.
+    /// @param family Histogram family (caller holds its shard's mutex).
+    /// @param format PrometheusText or OpenMetricsText (selects the cached header).
+    /// @param output Exposition buffer to append to.
+    void formatHistogramForPrometheus(const std::string& name,
+        HistogramFamily& family, ExpositionFormat format, std::string& output);
+
+    /// @brief Append an exponential Histogram metric in Prometheus format, as classic power-of-two buckets.
+    /// @param name Metric name.
+    /// @param family Exponential histogram family (caller holds its shard's mutex).
+    /// @param format PrometheusText or OpenMetricsText (selects the cached header).
+    /// @param output Exposition buffer to append to.
+    void formatExponentialHistogramForPrometheus(const std::string& name,
+        ExponentialHistogramFamily& family, ExpositionFormat format, std::string& output);
+
+    /// @brief Append a Summary metric in Prometheus format (quantile samples, _sum and _count).
     /// @param name Metric name.
-    /// @param metric_data Metric data.
-    /// @return Prometheus-formatted string.
-    std::string formatCounterForPrometheus(const std::string& name,
-        const metrics_sdk::MetricData& metric_data);
+    /// @param family Summary family (caller holds its shard's mutex).
+    /// @param format PrometheusText or OpenMetricsText (selects the cached header).
+    /// @param output Exposition buffer to append to.
+    void formatSummaryForPrometheus(const std::string& name,
+        SummaryFamily& family, ExpositionFormat format, std::string& output);
+
+    /// @brief Append a Gauge metric in Prometheus format.
+    /// @param name Metric name.
+    /// @param family Gauge family (caller holds its shard's mutex).
+    /// @param format PrometheusText or OpenMetricsText (selects the cached header).
+    /// @param output Exposition buffer to append to.
+    void formatGaugeForPrometheus(const std::string& name,
+        GaugeFamily& family, ExpositionFormat format, std::string& output);
+
+    /// @brief Append a family's HELP/TYPE lines, re-rendering them only if the description changed.
+    /// @param render Family render cache.
+    /// @param name Metric name.
+    /// @param descriptor Family descriptor.
+    /// @param prometheus_type Prometheus TYPE of the family.
+    /// @param format PrometheusText or OpenMetricsText; each has its own cached header.
+    /// @param output Exposition buffer to append to.
+    void appendFamilyHeader(FamilyRender& render, const std::string& name,
+        const metrics_sdk::InstrumentDescriptor& descriptor, const char* prometheus_type,
+        ExpositionFormat format, std::string& output);
+
+    /// @brief Append the samples of a counter/updowncounter family from the render cache.
+    /// @param family Sum family (caller holds its shard's mutex).
+    /// @param format PrometheusText, or OpenMetricsText for counter samples named with _total.
+    /// @param output Exposition buffer to append to.
+    void appendSumSamples(SumFamily& family, ExpositionFormat format, std::string& output);
 
-    /// @brief Format an UpDownCounter metric for Prometheus.
+    /// @brief Append a Counter metric in OpenMetrics text format (samples carry the _total suffix).
     /// @param name Metric name.
-    /// @param metric_data Metric data.
-    /// @return Prometheus-formatted string.
-    std::string formatUpDownCounterForPrometheus(const std::string& name,
-        const metrics_sdk::MetricData& metric_data);
+    /// @param family Counter family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatCounterForOpenMetrics(const std::string& name,
+        SumFamily& family, std::string& output);
 
-    /// @brief Format a Histogram metric for Prometheus.
+    /// @brief Append a counter/updowncounter family as a delimited protobuf MetricFamily.
     /// @param name Metric name.
-    /// @param metric_data Metric data.
-    /// @return Prometheus-formatted string.
-    std::string formatHistogramForPrometheus(const std::string& name,
-        const metrics_sdk::MetricData& metric_data);
+    /// @param family Sum family (caller holds its shard's mutex).
+    /// @param is_monotonic True for counters (COUNTER), false for updowncounters (GAUGE).
+    /// @param output Exposition buffer to append to.
+    void formatSumFamilyAsProtobuf(const std::string& name,
+        SumFamily& family, bool is_monotonic, std::string& output);
 
-    /// @brief Format a Gauge metric for Prometheus.
+    /// @brief Append a histogram family as a delimited protobuf MetricFamily.
     /// @param name Metric name.
-    /// @param metric_data Metric data.
-    /// @return Prometheus-formatted string.
-    std::string formatGaugeForPrometheus(const std::string& name,
-        const metrics_sdk::MetricData& metric_data);
+    /// @param family Histogram family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatHistogramAsProtobuf(const std::string& name,
+        HistogramFamily& family, std::string& output);
+
+    /// @brief Append an exponential histogram family as a delimited protobuf MetricFamily (native histogram).
+    /// @param name Metric name.
+    /// @param family Exponential histogram family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatExponentialHistogramAsProtobuf(const std::string& name,
+        ExponentialHistogramFamily& family, std::string& output);
+
+    /// @brief Append a summary family as a delimited protobuf MetricFamily.
+    /// @param name Metric name.
+    /// @param family Summary family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatSummaryAsProtobuf(const std::string& name,
+        SummaryFamily& family, std::string& output);
+
+    /// @brief Append a gauge family as a delimited protobuf MetricFamily.
+    /// @param name Metric name.
+    /// @param family Gauge family (caller holds its shard's mutex).
+    /// @param output Exposition buffer to append to.
+    void formatGaugeAsProtobuf(const std::string& name,
+        GaugeFamily& family, std::string& output);
+
+    /// @brief Wrap encoded Metric messages into a length-prefixed MetricFamily.
+    /// @param render Family render cache (supplies the sanitized name).
+    /// @param descriptor Family descriptor (supplies the help text).
+    /// @param type Prometheus MetricType enum value.
+    /// @param metrics Encoded repeated Metric fields.
+    /// @param output Exposition buffer to append to.
+    void appendProtobufFamily(const FamilyRender& render,
+        const metrics_sdk::InstrumentDescriptor& descriptor, uint64_t type,
+        const std::string& metrics, std::string& output);
+
+    /// @brief Sanitized family name, computed once per family.
+    const std::string& familyName(FamilyRender& render, const std::string& name);
+
+    /// @brief Formatted text labels of a series, rendered once.
+    const std::string& seriesLabels(SeriesRender& cached, const LabelSet& labels);
 
-    /// @brief Format metric attributes for Prometheus.
-    /// @param attributes Point attributes.
-    /// @return Prometheus-formatted attribute string.
-    std::string formatAttributes(const metrics_sdk::PointAttributes& attributes);
+    /// @brief Protobuf LabelPair fields of a series, encoded once.
+    const std::string& seriesProtoLabels(SeriesRender& cached, const LabelSet& labels);
+
+    /// @brief Append interned series attributes in Prometheus label syntax.
+    /// @param labels Interned attributes.
+    /// @param output Buffer to append {k="v",...} to (nothing for no attributes).
+    void formatAttributes(const LabelSet& labels, std::string& output);
+
+    /// @brief Append one sample line (name, labels, value, newline).
+    /// @param output Buffer to append to.
+    /// @param name Sample name (may be empty).
+    /// @param labels Formatted labels (may be empty).
+    /// @param value Sample value.
+    static void appendSample(std::string& output, std::string_view name,
+        std::string_view labels, double value);
+
+    /// @brief Append one histogram bucket line (name_bucket{le="bound",labels} count).
+    /// @param output Buffer to append to.
+    /// @param name Sanitized metric name.
+    /// @param labels Formatted series labels (may be empty).
+    /// @param upper_bound Bucket bound (+Inf for the last bucket).
+    /// @param cumulative_count Observations at or below the bound.
+    static void appendBucketSample(std::string& output, std::string_view name,
+        std::string_view labels, double upper_bound, uint64_t cumulative_count);
+
+    /// @brief Append one summary quantile line (name{quantile="q",labels} value).
+    /// @param output Buffer to append to.
+    /// @param name Sanitized metric name.
+    /// @param labels Formatted series labels (may be empty).
+    /// @param quantile Quantile in [0, 1].
+    /// @param value Estimated value at the quantile.
+    static void appendQuantileSample(std::string& output, std::string_view name,
+        std::string_view labels, double quantile, double value);
+
+    /// @brief Append a histogram's _count and _sum lines.
+    /// @param output Buffer to append to.
+    /// @param name Sanitized metric name.
+    /// @param labels Formatted series labels (may be empty).
+    /// @param count Number of observations.
+    /// @param sum Sum of observations.
+    static void appendCountAndSum(std::string& output, std::string_view name,
+        std::string_view labels, uint64_t count, double sum);
 
     /// @brief Sanitize a metric name for Prometheus compatibility.
     /// @param name Metric name.
     /// @return Sanitized metric name.
     std::string sanitizeMetricName(const std::string& name);
 
-    //==============================================================================
-    // THREAD SAFETY
-    //==============================================================================
-
-    /// @brief Mutex for protecting metric data.
-    std::mutex metrics_mutex_;
-    /// @brief Mutex for protecting instrument registration.
-    std::mutex instruments_mutex_;
-
     //==============================================================================
     // INITIALIZATION METHODS
     //==============================================================================
@@ -177,6 +904,14 @@ private:
     /// @brief Initialize OpenTelemetry metrics and exporters.
     void initializeMetrics();
 
+    /// @brief Load per-metric histogram boundaries and summary quantiles from the file named by IOT_METRICS_HISTOGRAM_VIEWS.
+    /// @throws std::runtime_error if the file cannot be read or is invalid.
+    void loadHistogramViews();
+
+    /// @brief Read the series limits from IOT_METRICS_MAX_SERIES_PER_METRIC and IOT_METRICS_MAX_SERIES.
+    /// @throws std::runtime_error if a value is not a positive integer.
+    void loadCardinalityLimits();
+
     /// @brief Set up HTTP routes and endpoints.
     void setupRoutes();
 
@@ -187,12 +922,85 @@ private:
     /// @brief Handle metric submission endpoint (/api/metrics).
     void handleMetric(const httplib::Request& req, httplib::Response& res);
 
+    /// @brief Handle batch metric submission endpoint (/api/metrics/batch).
+    void handleMetricBatch(const httplib::Request& req, httplib::Response& res);
+
+    /// @brief Handle streaming NDJSON submission endpoint (/api/metrics/stream).
+    ///
+    /// Lines are parsed and recorded as each chunk of the body arrives, so the
+    /// request body is never held in memory as a whole.
+    void handleMetricStream(const httplib::Request& req, httplib::Response& res,
+        const httplib::ContentReader& content_reader);
+
     /// @brief Handle health check endpoint (/health).
     void handleHealth(const httplib::Request& req, httplib::Response& res);
 
     /// @brief Handle status endpoint (/api/status).
     void handleStatus(const httplib::Request& req, httplib::Response& res);
 
+    //==============================================================================
+    // MEMORY ACCOUNTING
+    //==============================================================================
+
+    /// @brief Families listed by default in /api/status and in the self-metrics.
+    static constexpr size_t memory_top_families_ = 10;
+
+    /// @brief Most families /api/status lists when asked for more (?top=N).
+    static constexpr size_t max_memory_top_families_ = 100;
+
+    /// @brief Approximate memory held by one metric family.
+    struct FamilyMemory {
+        /// @brief Metric name.
+        std::string name;
+        /// @brief Instrument type.
+        const char* instrument_type = "";
+        /// @brief Number of series.
+        size_t series = 0;
+        /// @brief Series table entries and index, plus fixed-size per-series state.
+        size_t series_bytes = 0;
+        /// @brief Interned label id arrays (the strings are counted once, in the label pool).
+        size_t label_bytes = 0;
+        /// @brief Bucket arrays, boundaries and quantile lists.
+        size_t bucket_bytes = 0;
+        /// @brief Cached exposition text.
+        size_t render_bytes = 0;
+
+        /// @brief Sum of all components.
+        size_t totalBytes() const { return series_bytes + label_bytes + bucket_bytes + render_bytes; }
+    };
+
+    /// @brief Memory accounting over the whole store.
+    struct MemoryUsage {
+        /// @brief Largest families by total bytes, largest first.
+        std::vector<FamilyMemory> top_families;
+        /// @brief Components summed over every family.
+        FamilyMemory totals;
+        /// @brief Number of families measured.
+        size_t families = 0;
+    };
+
+    /// @brief Measure every family, locking one shard at a time.
+    /// @param top_count Number of largest families to keep.
+    /// @return The totals and the top_count largest families.
+    MemoryUsage collectMemoryUsage(size_t top_count);
+
+    /// @brief Measure one family.
+    /// @note Caller must hold the family's shard mutex.
+    /// @param name Metric name.
+    /// @param instrument_type Instrument type.
+    /// @param family Family to measure.
+    /// @param value_bytes Called with each series value; returns its heap bytes outside the table.
+    /// @param extra_bucket_bytes Family-level bucket bytes (boundaries, quantiles).
+    /// @return The family's memory.
+    template <typename Family, typename ValueBytes>
+    FamilyMemory measureFamily(const std::string& name, const char* instrument_type,
+        const Family& family, ValueBytes&& value_bytes, size_t extra_bucket_bytes);
+
+    /// @brief Append the memory self-metrics (iot_metrics_memory_bytes, iot_metrics_family_memory_bytes).
+    /// @param format Exposition format.
+    /// @param output Exposition buffer to append to.
+    void appendMemorySelfMetrics(ExpositionFormat format, std::string& output);
+
     /// @brief Handle metrics list endpoint (/api/metrics/list).
     void handleMetricsList(const httplib::Request& req, httplib::Response& res);
 
@@ -202,76 +1010,436 @@ private:
 
     /// @brief Record a metric of any supported type.
     /// @param metric_name Name of the metric.
-    /// @param instrument_type Type of instrument ("counter", "updowncounter", "histogram", "gauge").
+    /// @param instrument_type Type of instrument ("counter", "updowncounter", "histogram", "exponential_histogram", "summary", "gauge").
     /// @param value Value to record.
     /// @param attributes Key-value attributes for the metric.
     /// @param unit Unit of measurement.
     /// @param description Metric description.
-    void recordMetric(const std::string& metric_name,
+    /// @param boundaries Histogram bucket boundaries to register (empty for the configured ones).
+    /// @return Write-ahead log sequence number of the write for awaitDurable() (0 if it was not logged).
+    uint64_t recordMetric(const std::string& metric_name,
         const std::string& instrument_type,
         double value,
         const std::map<std::string, std::string>& attributes,
         const std::string& unit,
+        const std::string& description,
+        const std::vector<double>& boundaries = {});
+
+    /// @brief Record a batch of metrics, grouped by metric name.
+    ///
+    /// Each group is applied under a single acquisition of its shard's mutex.
+    /// @param points Validated metric points.
+    /// @return Write-ahead log sequence number of the batch for awaitDurable() (0 if it was not logged).
+    uint64_t recordMetricBatch(const std::vector<MetricPoint>& points);
+
+    /// @brief Wait until logged writes are synced to disk, unless the log is asynchronous (IOT_METRICS_WAL_ASYNC).
+    /// @param sequence Largest sequence number returned by recordMetric() or recordMetricBatch() (0 returns at once).
+    /// @throws std::runtime_error if the commit holding the writes failed.
+    void awaitDurable(uint64_t sequence);
+
+    /// @brief Dispatch a metric to its type-specific recorder.
+    ///
+    /// shard_lock is acquired on first need and left held, so a caller applying
+    /// several points to one shard locks it at most once. Counter and
+    /// updowncounter writes to known series never take it.
+    /// @return True if the write went to a series held in a value slot (it needs no log record).
+    bool applyMetric(MetricShard& shard,
+        std::unique_lock<std::mutex>& shard_lock,
+        const std::string& metric_name,
+        const std::string& instrument_type,
+        double value,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
+        const std::string& description,
+        const std::vector<double>& boundaries);
+
+    /// @brief Record a Counter metric (lock-free for known series).
+    /// @return True if the series is held in a value slot.
+    bool recordCounterMetricData(MetricShard& shard,
+        std::unique_lock<std::mutex>& shard_lock,
+        const std::string& name,
+        double value,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
         const std::string& description);
 
-    /// @brief Record a Counter metric.
-    void recordCounterMetricData(const std::string& name,
+    /// @brief Record an UpDownCounter metric (lock-free for known series).
+    /// @return True if the series is held in a value slot.
+    bool recordUpDownCounterMetricData(MetricShard& shard,
+        std::unique_lock<std::mutex>& shard_lock,
+        const std::string& name,
         double value,
         const std::map<std::string, std::string>& attributes,
         const std::string& unit,
         const std::string& description);
 
-    /// @brief Record an UpDownCounter metric.
-    void recordUpDownCounterMetricData(const std::string& name,
+    /// @brief Record one or more values into a Histogram series.
+    /// @note Caller must hold shard.mutex.
+    void recordHistogramMetricData(MetricShard& shard,
+        const std::string& name,
+        const double* values,
+        size_t value_count,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
+        const std::string& description,
+        const std::vector<double>& boundaries);
+
+    /// @brief Boundaries a new histogram family starts with.
+    /// @param name Metric name.
+    /// @param requested Boundaries from the submission (may be empty).
+    /// @return The submitted boundaries, else the configured view, else the defaults.
+    const std::vector<double>& resolveHistogramBoundaries(const std::string& name,
+        const std::vector<double>& requested) const;
+
+    /// @brief Record a value into an exponential Histogram series.
+    /// @note Caller must hold shard.mutex.
+    void recordExponentialHistogramMetricData(MetricShard& shard,
+        const std::string& name,
         double value,
         const std::map<std::string, std::string>& attributes,
         const std::string& unit,
         const std::string& description);
 
-    /// @brief Record a Histogram metric.
-    void recordHistogramMetricData(const std::string& name,
+    /// @brief Record a value into a Summary series.
+    /// @note Caller must hold shard.mutex.
+    void recordSummaryMetricData(MetricShard& shard,
+        const std::string& name,
         double value,
         const std::map<std::string, std::string>& attributes,
         const std::string& unit,
         const std::string& description);
 
+    /// @brief Fill in a family's descriptor on creation and from later writes.
+    /// @param descriptor Descriptor to update.
+    /// @param type Instrument type.
+    /// @param name Metric name.
+    /// @param unit Unit of measurement (kept from the first write that has one).
+    /// @param description Metric description (kept from the first write that has one).
+    void updateDescriptor(metrics_sdk::InstrumentDescriptor& descriptor,
+        metrics_sdk::InstrumentType type,
+        const std::string& name,
+        const std::string& unit,
+        const std::string& description);
+
+    /// @brief Intern attributes into a series identity.
+    /// @param attributes Key-value attributes.
+    /// @return The attributes as interned (key, value) id pairs, in key order.
+    LabelSet internAttributes(const std::map<std::string, std::string>& attributes);
+
+    /// @brief Compute the series fingerprint of a set of attributes.
+    /// @param attributes Key-value attributes (already in key order).
+    /// @return 64-bit hash over every key and value.
+    static uint64_t fingerprintAttributes(const std::map<std::string, std::string>& attributes);
+
+    /// @brief Check stored series labels against attributes without interning them.
+    /// @param labels Interned labels of a candidate series.
+    /// @param attributes Key-value attributes being looked up.
+    /// @return True if both describe the same series.
+    bool labelsMatch(const LabelSet& labels, const std::map<std::string, std::string>& attributes) const;
+
+    /// @brief Find a series, creating it if the series limits allow, else using the family's overflow series.
+    /// @note Caller must hold the family's shard mutex.
+    /// @param family Family to look in.
+    /// @param name Metric name (for logging).
+    /// @param attributes Key-value attributes.
+    /// @param make_value Called to build the state of a new series.
+    /// @param overflowed Set to true if the write was redirected (may be null).
+    /// @return The series entry to update.
+    template <typename Family, typename MakeValue>
+    auto& findOrCreateSeries(Family& family,
+        const std::string& name,
+        const std::map<std::string, std::string>& attributes,
+        MakeValue&& make_value,
+        bool* overflowed = nullptr);
+
+    /// @brief Reserve room for one new series under both limits.
+    /// @param family_size Number of series the family already has.
+    /// @return False if either limit has been reached.
+    bool admitSeries(size_t family_size);
+
+    /// @brief Check that a metric may be written, reserving room for it if it is new.
+    /// @note Caller must hold the families' shard mutex and create the family if this returns true.
+    /// @param families Families of the metric's type.
+    /// @param name Metric name.
+    /// @return False if the metric is new and the metric limit has been reached.
+    template <typename Family>
+    bool admitFamily(const std::map<std::string, Family>& families, const std::string& name);
+
+    /// @brief Get a family for restored state (snapshot or value slot), creating and counting it if needed.
+    /// @note Caller must hold the families' shard mutex.
+    /// @param families Families of the metric's type.
+    /// @param name Metric name.
+    /// @return The family.
+    template <typename Family>
+    Family& restoredFamily(std::map<std::string, Family>& families, const std::string& name);
+
+    /// @brief Name of the metric that absorbs writes to new metrics of a type past max_metrics_.
+    /// @param instrument_type Instrument type of the refused write.
+    /// @return The overflow metric name (empty for an unknown type).
+    static const std::string& overflowMetricName(const std::string& instrument_type);
+
+    /// @brief Record a write refused by the metric limit in its type's overflow metric.
+    ///
+    /// shard_lock is released first if the overflow metric lives on another shard.
+    /// @param shard_lock Lock on the refused metric's shard (held or not).
+    /// @param instrument_type Instrument type of the write.
+    /// @param value Value to record.
+    /// @param boundaries Histogram bucket boundaries of the write.
+    /// @return True if the overflow series is held in a value slot.
+    bool applyOverflowMetric(std::unique_lock<std::mutex>& shard_lock,
+        const std::string& instrument_type,
+        double value,
+        const std::vector<double>& boundaries);
+
+    /// @brief Add a value to a counter/updowncounter series, looking it up again if it was evicted meanwhile.
+    /// @return True if the series the value ended up in is held in a value slot.
+    bool recordSumValue(MetricShard& shard,
+        std::unique_lock<std::mutex>& shard_lock,
+        metrics_sdk::InstrumentType type,
+        const std::string& name,
+        double value,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
+        const std::string& description);
+
+    /// @brief Per-thread cache of the counter and updowncounter series a thread has written to.
+    struct SumSeriesCache {
+        /// @brief instance_id_ of the server the entries belong to (0 for none).
+        uint64_t owner = 0;
+        /// @brief sum_eviction_generation_ when retired series were last pruned.
+        uint64_t generation = 0;
+        /// @brief Series by metric name, one map per instrument type (counter, updowncounter).
+        std::unordered_map<std::string, SeriesTable<std::shared_ptr<SumSeries>>> entries[2];
+    };
+
+    /// @brief The calling thread's series cache.
+    static SumSeriesCache& sumSeriesCache();
+
+    /// @brief Find or create a counter/updowncounter series.
+    ///
+    /// Hits in the calling thread's cache need no lock; misses take shard_lock
+    /// and register the series in the shard.
+    /// @return The series to add into; the calling thread's cache (or, for an
+    ///         overflowed write, the held shard lock) keeps it alive.
+    SumSeries* findSumSeries(MetricShard& shard,
+        std::unique_lock<std::mutex>& shard_lock,
+        metrics_sdk::InstrumentType type,
+        const std::string& name,
+        const std::map<std::string, std::string>& attributes,
+        const std::string& unit,
+        const std::string& description);
+
     /// @brief Record a Gauge metric.
-    void recordGaugeMetricData(const std::string& name,
+    /// @note Caller must hold shard.mutex.
+    /// @return True if the series is held in a value slot.
+    bool recordGaugeMetricData(MetricShard& shard,
+        const std::string& name,
         double value,
         const std::map<std::string, std::string>& attributes,
         const std::string& unit,
         const std::string& description);
 
     //==============================================================================
-    // HELPER METHODS
+    // PERSISTENCE
     //==============================================================================
 
-    /// @brief Create a unique key from metric attributes for storage.
-    /// @param attributes Key-value attributes.
-    /// @return Concatenated attribute key.
-    std::string createAttributeKey(const std::map<std::string, std::string>& attributes);
+    /// @brief Default interval between snapshots, in seconds (IOT_METRICS_SNAPSHOT_INTERVAL).
+    static constexpr uint64_t default_snapshot_interval_seconds_ = 300;
+
+    /// @brief Default longest wait before a logged write is synced to disk, in ms (IOT_METRICS_WAL_COMMIT_MS).
+    static constexpr uint64_t default_wal_commit_ms_ = 10;
+
+    /// @brief How often the snapshot thread checks whether a snapshot is due.
+    static constexpr std::chrono::milliseconds snapshot_poll_interval_{ 250 };
+
+    /// @brief Directory holding snapshots and log segments (IOT_METRICS_DATA_DIR); empty disables persistence.
+    std::string data_directory_;
+
+    /// @brief Interval between snapshots.
+    std::chrono::seconds snapshot_interval_{ default_snapshot_interval_seconds_ };
+
+    /// @brief Write-ahead log of applied writes (null when persistence is disabled; set only by the constructor).
+    std::unique_ptr<WriteAheadLog> wal_;
+
+    /// @brief Acknowledge HTTP writes without waiting for their log commit (IOT_METRICS_WAL_ASYNC).
+    bool wal_async_ = false;
+
+    /// @brief Memory-mapped value slots of counter, updowncounter and gauge series (null when disabled; set only by the constructor).
+    ///
+    /// While set, writes to series held in a slot are not logged and those series are left out of snapshots:
+    /// the slots themselves are the persisted state. Series that found no slot are logged and snapshotted.
+    std::shared_ptr<SlotStore> slots_;
+
+    /// @brief Held shared while a write is applied and logged, exclusively while a snapshot cuts the log.
+    std::shared_mutex persistence_mutex_;
+
+    /// @brief Held by a snapshot from before it asks for persistence_mutex_ until it releases it.
+    std::mutex snapshot_gate_;
+
+    /// @brief Set while a snapshot waits for or holds persistence_mutex_; new writers queue on snapshot_gate_.
+    std::atomic<bool> snapshot_pending_{ false };
+
+    /// @brief Thread writing periodic snapshots (runs only when persistence is enabled).
+    std::thread snapshot_thread_;
+
+    /// @brief Snapshots written since startup.
+    std::atomic<uint64_t> snapshots_written_{ 0 };
+
+    /// @brief Snapshots that could not be written.
+    std::atomic<uint64_t> snapshot_failures_{ 0 };
 
-    /// @brief Find the appropriate histogram bucket index for a value.
-    /// @param value Value to bucket.
-    /// @param boundaries Histogram bucket boundaries.
-    /// @return Index of the bucket.
-    size_t findBucketIndex(double value, const std::vector<double>& boundaries);
+    /// @brief First log segment the latest snapshot does not cover (0 before the first one).
+    std::atomic<uint64_t> snapshot_segment_{ 0 };
 
-    /// @brief Calculate cumulative counts for histogram buckets.
-    /// @param bucket_counts Per-bucket counts.
-    /// @return Cumulative counts vector.
-    std::vector<uint64_t> calculateCumulativeCounts(const std::vector<uint64_t>& bucket_counts);
+    /// @brief Series in the latest snapshot.
+    std::atomic<uint64_t> snapshot_series_{ 0 };
+
+    /// @brief Size of the latest snapshot in bytes.
+    std::atomic<uint64_t> snapshot_bytes_{ 0 };
+
+    /// @brief How long ingestion paused while the latest snapshot was taken, in microseconds.
+    std::atomic<uint64_t> snapshot_pause_us_{ 0 };
+
+    /// @brief What startup recovered from the data directory (written only by the constructor).
+    struct RestoreStats {
+        /// @brief Series adopted from the slot store.
+        size_t slot_series = 0;
+        /// @brief Segment number of the snapshot loaded (0 if none).
+        uint64_t snapshot = 0;
+        /// @brief Series restored from the snapshot.
+        size_t snapshot_series = 0;
+        /// @brief Log segments replayed.
+        size_t segments = 0;
+        /// @brief Log records replayed.
+        size_t records = 0;
+        /// @brief Writes replayed from those records.
+        size_t points = 0;
+        /// @brief Segments that ended in a torn or corrupt record.
+        size_t torn_segments = 0;
+        /// @brief Time taken, in milliseconds.
+        double milliseconds = 0.0;
+    };
+
+    /// @brief What startup recovered.
+    RestoreStats restore_stats_;
+
+    /// @brief Read the persistence settings, restore the saved state and open the write-ahead log.
+    ///
+    /// Does nothing unless IOT_METRICS_DATA_DIR is set.
+    /// @throws std::runtime_error if a setting is invalid or the directory cannot be used.
+    void loadPersistence();
+
+    /// @brief Take persistence_mutex_ shared for one write or batch (an empty lock when persistence is disabled).
+    ///
+    /// Waits first while a snapshot is pending, so a steady stream of writers cannot starve it.
+    std::shared_lock<std::shared_mutex> lockForWrite();
+
+    /// @brief Adopt the slot store's live slots, then load the newest intact snapshot and replay the log segments it does not cover.
+    /// @return Number of the segment the log continues with.
+    uint64_t restoreState();
+
+    /// @brief Register every live slot of the slot store as the series it was allocated for.
+    /// @return Number of series adopted.
+    size_t recoverSlots();
+
+    /// @brief Move every in-memory counter, updowncounter and gauge series into a slot (startup only).
+    /// @return Number of series moved.
+    size_t moveSeriesToSlots();
+
+    /// @brief Allocate a slot for a new series, recording its identity in the catalog.
+    /// @note Caller must hold the series' shard mutex.
+    /// @return The slot, or an empty handle if the slot store is disabled or full.
+    SlotStore::Handle allocateSlot(BinaryInstrumentKind kind, const std::string& name, const LabelSet& labels,
+        const metrics_sdk::InstrumentDescriptor& descriptor);
+
+    /// @brief Append the identity a slot is cataloged with: a binary frame of the series' metric, labels and descriptor.
+    void appendSlotIdentity(std::string& out, BinaryInstrumentKind kind, const std::string& name, const LabelSet& labels,
+        const metrics_sdk::InstrumentDescriptor& descriptor) const;
+
+    /// @brief Fold the striped cells of every slot-backed counter and updowncounter series into its slot.
+    void foldSumCells();
+
+    /// @brief Fold and sync the slots, then drop every slot handle the store and the calling thread's cache hold.
+    ///
+    /// Called on destruction, so the slot file is closed with the server even if
+    /// an idle thread's series cache outlives it.
+    void releaseSlots();
+
+    /// @brief Restore every family of a snapshot file into the (empty) store.
+    /// @param path Snapshot file.
+    /// @param series Output number of series restored.
+    /// @return False if the file is unreadable, fails its checksum or does not decode to the end (nothing is restored then).
+    bool loadSnapshot(const std::string& path, size_t& series);
+
+    /// @brief Apply every intact record of a log segment.
+    /// @param path Segment file.
+    void replaySegment(const std::string& path);
+
+    /// @brief Path of the snapshot that covers every segment before a given one.
+    std::string snapshotPath(uint64_t segment) const;
+
+    /// @brief Start the snapshot thread if persistence is enabled.
+    void startSnapshotter();
+
+    /// @brief Join the snapshot thread and, if it was running, take a final snapshot.
+    void stopSnapshotter();
+
+    /// @brief Snapshot loop: take a snapshot every snapshot_interval_.
+    void runSnapshotter();
+
+    /// @brief Cut the log and write a snapshot of the store, then delete the files it supersedes.
+    /// @return False if the snapshot could not be written.
+    bool writeSnapshot();
+
+    /// @brief Serialize every family (only the catalog records of slot-backed ones).
+    /// @note Caller must hold persistence_mutex_ exclusively, so no write is half-applied.
+    /// @param out Buffer to append to.
+    /// @param catalog Buffer the catalog records of slot-backed series are appended to.
+    /// @return Number of series serialized.
+    size_t serializeStore(std::string& out, std::string& catalog);
 
     //==============================================================================
     // UTILITY METHODS
     //==============================================================================
 
+    /// @brief Validate a value against the semantic rules of its instrument type.
+    /// @param instrument_type Type of instrument.
+    /// @param value Value to record.
+    /// @param error_msg Output error message if invalid.
+    /// @return true if valid, false otherwise.
+    bool validateMetricValue(const std::string& instrument_type, double value, std::string& error_msg);
+
+    /// @brief Validate submitted histogram bucket boundaries.
+    /// @param instrument_type Type of instrument (boundaries are only valid for histograms).
+    /// @param boundaries Boundaries to check (finite, strictly increasing, 1..max_histogram_boundaries_).
+    /// @param error_msg Output error message if invalid.
+    /// @return true if valid, false otherwise.
+    bool validateBoundaries(const std::string& instrument_type, const std::vector<double>& boundaries,
+        std::string& error_msg);
+
     /// @brief Validate a metric submission request.
     /// @param request JSON request object.
     /// @param error_msg Output error message if invalid.
     /// @return true if valid, false otherwise.
     bool validateMetricRequest(const nlohmann::json& request, std::string& error_msg);
 
+    /// @brief Validate a metric submission and decode it into a MetricPoint.
+    /// @param request JSON request object.
+    /// @param point Output metric point if valid.
+    /// @param error_msg Output error message if invalid.
+    /// @return true if valid, false otherwise.
+    bool parseMetricPoint(const nlohmann::json& request, MetricPoint& point, std::string& error_msg);
+
+    /// @brief Validate a fast-path parsed submission and copy it into a MetricPoint.
+    ///
+    /// Applies the same rules, in the same order and with the same messages, as
+    /// the JSON overload.
+    /// @param view Fields parsed by FastMetricParser.
+    /// @param point Output metric point if valid.
+    /// @param error_msg Output error message if invalid.
+    /// @return true if valid, false otherwise.
+    bool parseMetricPoint(const MetricPointView& view, MetricPoint& point, std::string& error_msg);
+
     /// @brief Create a JSON error response.
     /// @param error Error message.
     /// @param code HTTP error code (default: 400).
@@ -0,0 +1,228 @@
+#include "LabelPool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+//==============================================================================
+// CONSTRUCTOR & DESTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Constructs an empty pool.
+ */
+LabelPool::LabelPool()
+    : pages_(new std::atomic<std::string_view*>[max_pages_])
+{
+    for (size_t i = 0; i < max_pages_; ++i) {
+        pages_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    tables_.push_back(makeTable(1024));
+    table_.store(tables_.back().get(), std::memory_order_release);
+}
+
+/**
+ * @brief Destructor. Releases the id pages; the arena and tables are owned by members.
+ */
+LabelPool::~LabelPool() {
+    for (size_t i = 0; i < max_pages_; ++i) {
+        delete[] pages_[i].load(std::memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Interns a string, storing it on first sight.
+ *
+ * The common case (string already interned) is a lock-free probe. New strings
+ * are copied into the arena under the write mutex, and the table is grown to
+ * keep its load factor under one half.
+ * @param text String to intern.
+ * @return Id of the interned string.
+ */
+LabelPool::Id LabelPool::intern(std::string_view text) {
+    uint64_t text_hash = hash(text);
+    Id id = findIn(*table_.load(std::memory_order_acquire), text, text_hash);
+    if (id != invalid_id) {
+        return id;
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+
+    // Another thread may have inserted it while we waited
+    Table* table = table_.load(std::memory_order_relaxed);
+    id = findIn(*table, text, text_hash);
+    if (id != invalid_id) {
+        return id;
+    }
+
+    id = count_.load(std::memory_order_relaxed);
+    size_t page_index = id >> page_bits_;
+    if (page_index >= max_pages_) {
+        throw std::length_error("LabelPool capacity exhausted");
+    }
+
+    // Publish the string before the id becomes reachable through the table
+    std::string_view* page = pages_[page_index].load(std::memory_order_relaxed);
+    if (!page) {
+        page = new std::string_view[size_t(1) << page_bits_];
+        pages_[page_index].store(page, std::memory_order_release);
+    }
+    page[id & ((size_t(1) << page_bits_) - 1)] = store(text);
+    count_.store(id + 1, std::memory_order_release);
+
+    if ((static_cast<size_t>(id) + 1) * 2 > table->mask + 1) {
+        // Grow into a new generation; readers still probing the old one stay safe
+        auto grown = makeTable((table->mask + 1) * 2);
+        for (Id existing = 0; existing < id; ++existing) {
+            insertInto(*grown, hash(view(existing)), existing);
+        }
+        insertInto(*grown, text_hash, id);
+        tables_.push_back(std::move(grown));
+        table_.store(tables_.back().get(), std::memory_order_release);
+    }
+    else {
+        insertInto(*table, text_hash, id);
+    }
+    return id;
+}
+
+/**
+ * @brief Looks up a string without interning it.
+ * @param text String to look up.
+ * @return Its id, or invalid_id if it was never interned.
+ */
+LabelPool::Id LabelPool::find(std::string_view text) const {
+    return findIn(*table_.load(std::memory_order_acquire), text, hash(text));
+}
+
+/**
+ * @brief Resolves an id to its string.
+ * @param id Id returned by intern().
+ * @return View into the arena, valid for the lifetime of the pool.
+ */
+std::string_view LabelPool::view(Id id) const {
+    const std::string_view* page = pages_[id >> page_bits_].load(std::memory_order_acquire);
+    return page[id & ((size_t(1) << page_bits_) - 1)];
+}
+
+/**
+ * @brief Returns the number of distinct strings interned.
+ */
+size_t LabelPool::size() const {
+    return count_.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Returns the bytes reserved by the string arena.
+ */
+size_t LabelPool::arenaBytes() const {
+    return arena_bytes_.load(std::memory_order_relaxed);
+}
+
+//==============================================================================
+// INTERNAL METHODS
+//==============================================================================
+
+/**
+ * @brief Hashes a string with 64-bit FNV-1a.
+ * @param text String to hash.
+ * @return Hash value.
+ */
+uint64_t LabelPool::hash(std::string_view text) {
+    uint64_t value = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        value ^= c;
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+/**
+ * @brief Probes a table for a string (linear probing).
+ * @param table Table generation to probe.
+ * @param text String to look up.
+ * @param text_hash hash(text).
+ * @return Its id, or invalid_id if absent.
+ */
+LabelPool::Id LabelPool::findIn(const Table& table, std::string_view text, uint64_t text_hash) const {
+    const uint32_t tag = static_cast<uint32_t>(text_hash >> 32);
+    for (size_t slot = text_hash & table.mask;; slot = (slot + 1) & table.mask) {
+        uint64_t entry = table.slots[slot].load(std::memory_order_acquire);
+        if (entry == 0) {
+            return invalid_id;
+        }
+        if (static_cast<uint32_t>(entry >> 32) == tag) {
+            Id id = static_cast<Id>(entry & 0xFFFFFFFFu) - 1;
+            if (view(id) == text) {
+                return id;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Inserts an id into a table (write mutex held, capacity available).
+ * @param table Table generation to insert into.
+ * @param text_hash Hash of the string.
+ * @param id Id of the string.
+ */
+void LabelPool::insertInto(Table& table, uint64_t text_hash, Id id) {
+    uint64_t entry = (text_hash & 0xFFFFFFFF00000000ull) | (static_cast<uint64_t>(id) + 1);
+    for (size_t slot = text_hash & table.mask;; slot = (slot + 1) & table.mask) {
+        if (table.slots[slot].load(std::memory_order_relaxed) == 0) {
+            table.slots[slot].store(entry, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Allocates a table generation with the given capacity.
+ * @param capacity Number of slots (power of two).
+ * @return The empty table.
+ */
+std::unique_ptr<LabelPool::Table> LabelPool::makeTable(size_t capacity) {
+    auto table = std::make_unique<Table>();
+    table->mask = capacity - 1;
+    table->slots.reset(new std::atomic<uint64_t>[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        table->slots[i].store(0, std::memory_order_relaxed);
+    }
+    return table;
+}
+
+/**
+ * @brief Copies a string into the arena (write mutex held).
+ *
+ * Strings are packed into block_size_ blocks; a string larger than a block
+ * gets a block of its own.
+ * @param text String to copy.
+ * @return View of the stored copy.
+ */
+std::string_view LabelPool::store(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+
+    if (text.size() > block_remaining_) {
+        size_t size = std::max(block_size_, text.size());
+        blocks_.emplace_back(new char[size]);
+        arena_bytes_.fetch_add(size, std::memory_order_relaxed);
+        if (size > block_size_) {
+            // Oversized string: dedicated block, keep filling the current one
+            std::memcpy(blocks_.back().get(), text.data(), text.size());
+            return std::string_view(blocks_.back().get(), text.size());
+        }
+        block_cursor_ = blocks_.back().get();
+        block_remaining_ = size;
+    }
+
+    std::memcpy(block_cursor_, text.data(), text.size());
+    std::string_view stored(block_cursor_, text.size());
+    block_cursor_ += text.size();
+    block_remaining_ -= text.size();
+    return stored;
+}
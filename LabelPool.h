@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+/// @brief Interning table for metric label keys and values.
+///
+/// Each distinct string is copied once into an append-only arena and referred to
+/// by a 32-bit id. Ids and the views they resolve to stay valid for the lifetime
+/// of the pool. Lookups and id resolution are lock-free; only inserting a string
+/// that has never been seen takes the write mutex.
+class LabelPool {
+public:
+    /// @brief Identifier of an interned string.
+    using Id = uint32_t;
+
+    /// @brief Returned by find() when a string has not been interned.
+    static constexpr Id invalid_id = 0xFFFFFFFFu;
+
+    /// @brief Construct an empty pool.
+    LabelPool();
+
+    /// @brief Destructor. Releases the arena and hash tables.
+    ~LabelPool();
+
+    LabelPool(const LabelPool&) = delete;
+    LabelPool& operator=(const LabelPool&) = delete;
+
+    /// @brief Intern a string, storing it on first sight.
+    /// @param text String to intern.
+    /// @return Id of the interned string.
+    Id intern(std::string_view text);
+
+    /// @brief Look up a string without interning it.
+    /// @param text String to look up.
+    /// @return Its id, or invalid_id if it was never interned.
+    Id find(std::string_view text) const;
+
+    /// @brief Resolve an id to its string.
+    /// @param id Id returned by intern().
+    /// @return View into the arena, valid for the lifetime of the pool.
+    std::string_view view(Id id) const;
+
+    /// @brief Number of distinct strings interned.
+    size_t size() const;
+
+    /// @brief Bytes reserved by the string arena.
+    size_t arenaBytes() const;
+
+private:
+    /// @brief One generation of the open-addressing id table.
+    ///
+    /// Slots pack the upper 32 bits of the string hash with id + 1 (0 = empty).
+    /// Tables are only ever replaced by larger ones; old generations are kept so
+    /// concurrent readers never see freed memory.
+    struct Table {
+        /// @brief Capacity - 1 (capacity is a power of two).
+        size_t mask = 0;
+        /// @brief Packed (hash, id) slots.
+        std::unique_ptr<std::atomic<uint64_t>[]> slots;
+    };
+
+    /// @brief Ids per page of the id -> string table.
+    static constexpr size_t page_bits_ = 12;
+    /// @brief Maximum number of id pages (bounds the id space to 2^28 strings).
+    static constexpr size_t max_pages_ = size_t(1) << 16;
+    /// @brief Size of each arena block.
+    static constexpr size_t block_size_ = 64 * 1024;
+
+    /// @brief Hash a string (FNV-1a, 64-bit).
+    static uint64_t hash(std::string_view text);
+
+    /// @brief Probe a table for a string.
+    Id findIn(const Table& table, std::string_view text, uint64_t text_hash) const;
+
+    /// @brief Insert an id into a table (write mutex held, capacity available).
+    static void insertInto(Table& table, uint64_t text_hash, Id id);
+
+    /// @brief Allocate a table generation with the given capacity.
+    static std::unique_ptr<Table> makeTable(size_t capacity);
+
+    /// @brief Copy a string into the arena (write mutex held).
+    std::string_view store(std::string_view text);
+
+    /// @brief Serializes inserts.
+    std::mutex write_mutex_;
+    /// @brief Current table generation.
+    std::atomic<Table*> table_{ nullptr };
+    /// @brief Every table generation allocated so far.
+    std::vector<std::unique_ptr<Table>> tables_;
+    /// @brief Arena blocks holding string bytes.
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    /// @brief Next free byte in the current block.
+    char* block_cursor_ = nullptr;
+    /// @brief Bytes left in the current block.
+    size_t block_remaining_ = 0;
+    /// @brief Total bytes reserved by arena blocks.
+    std::atomic<size_t> arena_bytes_{ 0 };
+    /// @brief Pages of id -> string views.
+    std::unique_ptr<std::atomic<std::string_view*>[]> pages_;
+    /// @brief Number of interned strings (the next id).
+    std::atomic<Id> count_{ 0 };
+};
+
+/// @brief One attribute of a series as interned (key id, value id).
+struct LabelPair {
+    /// @brief Interned attribute key.
+    LabelPool::Id key;
+    /// @brief Interned attribute value.
+    LabelPool::Id value;
+
+    bool operator==(const LabelPair& other) const { return key == other.key && value == other.value; }
+    bool operator<(const LabelPair& other) const {
+        return key != other.key ? key < other.key : value < other.value;
+    }
+};
+
+/// @brief Identity of a series: its attributes as interned pairs, in attribute key order.
+using LabelSet = std::vector<LabelPair>;
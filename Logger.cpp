@@ -0,0 +1,231 @@
+#include "Logger.h"
+#include <cctype>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+//==============================================================================
+// CONSTRUCTOR & DESTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Returns the process-wide logger.
+ */
+Logger& Logger::instance() {
+    static Logger logger;
+    return logger;
+}
+
+/**
+ * @brief Constructs the logger, reads IOT_METRICS_LOG_LEVEL and starts the writer thread.
+ */
+Logger::Logger() {
+    for (size_t i = 0; i < ring_capacity_; ++i) {
+        ring_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    LogLevel configured;
+    const char* env_level = std::getenv("IOT_METRICS_LOG_LEVEL");
+    if (env_level && parseLevel(env_level, configured)) {
+        level_.store(configured, std::memory_order_relaxed);
+    }
+
+    writer_ = std::thread(&Logger::run, this);
+}
+
+/**
+ * @brief Destructor. Stops the writer thread once the ring has been drained.
+ */
+Logger::~Logger() {
+    running_.store(false, std::memory_order_release);
+    if (writer_.joinable()) {
+        writer_.join();
+    }
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Sets the minimum level that is recorded.
+ * @param level Minimum level.
+ */
+void Logger::setLevel(LogLevel level) {
+    level_.store(level, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the current minimum level.
+ */
+LogLevel Logger::level() const {
+    return level_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Checks whether messages at a level are recorded.
+ * @param level Message level.
+ * @return True if the message should be formatted and queued.
+ */
+bool Logger::enabled(LogLevel level) const {
+    return level != LogLevel::Off && level >= level_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Queues a printf-style message.
+ *
+ * A slot is claimed with a CAS on the tail position and the message is
+ * formatted straight into it; nothing is allocated. If the ring is full the
+ * message is counted as dropped.
+ * @param level Message level.
+ * @param format printf format string.
+ */
+void Logger::log(LogLevel level, const char* format, ...) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    Slot* slot;
+    for (;;) {
+        slot = &ring_[position & (ring_capacity_ - 1)];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        else if (difference < 0) {
+            // Writer has not freed this slot yet: the ring is full
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        else {
+            position = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(slot->text, max_message_length_, format, args);
+    va_end(args);
+
+    slot->level = level;
+    slot->length = static_cast<uint16_t>(length < 0 ? 0 :
+        (static_cast<size_t>(length) >= max_message_length_ ? max_message_length_ - 1 : length));
+    slot->sequence.store(position + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Blocks until every message queued before the call has been written.
+ */
+void Logger::flush() {
+    const size_t target = tail_.load(std::memory_order_acquire);
+    while (written_.load(std::memory_order_acquire) < target && writer_.joinable()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief Returns the number of messages dropped because the ring was full.
+ */
+uint64_t Logger::dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Parses a level name (debug, info, warn/warning, error, off; case-insensitive).
+ * @param name Level name.
+ * @param level Receives the level on success.
+ * @return True if the name was recognized.
+ */
+bool Logger::parseLevel(const char* name, LogLevel& level) {
+    std::string lower(name);
+    for (char& c : lower) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+
+    if (lower == "debug") level = LogLevel::Debug;
+    else if (lower == "info") level = LogLevel::Info;
+    else if (lower == "warn" || lower == "warning") level = LogLevel::Warn;
+    else if (lower == "error") level = LogLevel::Error;
+    else if (lower == "off") level = LogLevel::Off;
+    else return false;
+    return true;
+}
+
+/**
+ * @brief Returns the lower-case name of a level.
+ */
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warn: return "warn";
+    case LogLevel::Error: return "error";
+    default: return "off";
+    }
+}
+
+//==============================================================================
+// WRITER THREAD
+//==============================================================================
+
+/**
+ * @brief Writer thread loop: drains the ring, sleeping briefly when it is empty.
+ */
+void Logger::run() {
+    for (;;) {
+        if (drain() > 0) {
+            continue;
+        }
+        if (!running_.load(std::memory_order_acquire)) {
+            // Stopped and nothing left (producers may still race in; take what is there)
+            drain();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+/**
+ * @brief Writes out filled slots in batches.
+ *
+ * Info and debug messages go to stdout, warnings and errors to stderr; each
+ * stream gets one fwrite and one flush per batch.
+ * @return Number of messages written.
+ */
+size_t Logger::drain() {
+    std::string out_batch;
+    std::string err_batch;
+    size_t count = 0;
+
+    while (count < max_batch_) {
+        Slot& slot = ring_[head_ & (ring_capacity_ - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            break;
+        }
+
+        std::string& batch = slot.level >= LogLevel::Warn ? err_batch : out_batch;
+        batch += '[';
+        batch += levelName(slot.level);
+        batch += "] ";
+        batch.append(slot.text, slot.length);
+        batch += '\n';
+
+        slot.sequence.store(head_ + ring_capacity_, std::memory_order_release);
+        ++head_;
+        ++count;
+    }
+
+    if (!out_batch.empty()) {
+        std::fwrite(out_batch.data(), 1, out_batch.size(), stdout);
+        std::fflush(stdout);
+    }
+    if (!err_batch.empty()) {
+        std::fwrite(err_batch.data(), 1, err_batch.size(), stderr);
+        std::fflush(stderr);
+    }
+    written_.store(head_, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define IOT_LOG_PRINTF_FORMAT(format_index, args_index) __attribute__((format(printf, format_index, args_index)))
+#else
+#define IOT_LOG_PRINTF_FORMAT(format_index, args_index)
+#endif
+
+/// @brief Severity of a log message.
+enum class LogLevel : uint8_t {
+    Debug = 0,
+    Info = 1,
+    Warn = 2,
+    Error = 3,
+    Off = 4
+};
+
+/// @brief Asynchronous leveled logger.
+///
+/// Callers format into a slot of a fixed-size lock-free ring (multi-producer,
+/// single-consumer) and return immediately; a background thread drains the ring
+/// in batches and writes each batch with one call. When the ring is full the
+/// message is dropped and counted rather than blocking the caller. The initial
+/// level is read from the IOT_METRICS_LOG_LEVEL environment variable
+/// (debug, info, warn, error, off) and defaults to info.
+class Logger {
+public:
+    /// @brief The process-wide logger (its writer thread starts on first use).
+    static Logger& instance();
+
+    Logger(const Logger&) = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    /// @brief Set the minimum level that is recorded.
+    void setLevel(LogLevel level);
+
+    /// @brief Current minimum level.
+    LogLevel level() const;
+
+    /// @brief Whether messages at a level are recorded (checked before formatting).
+    bool enabled(LogLevel level) const;
+
+    /// @brief Queue a printf-style message. Never blocks; drops when the ring is full.
+    /// @param level Message level.
+    /// @param format printf format string.
+    void log(LogLevel level, const char* format, ...) IOT_LOG_PRINTF_FORMAT(3, 4);
+
+    /// @brief Block until every message queued so far has been written.
+    void flush();
+
+    /// @brief Number of messages dropped because the ring was full.
+    uint64_t dropped() const;
+
+    /// @brief Parse a level name (case-insensitive).
+    /// @param name Level name.
+    /// @param level Receives the level on success.
+    /// @return True if the name was recognized.
+    static bool parseLevel(const char* name, LogLevel& level);
+
+    /// @brief Lower-case name of a level.
+    static const char* levelName(LogLevel level);
+
+private:
+    /// @brief Number of ring slots (power of two).
+    static constexpr size_t ring_capacity_ = 8192;
+    /// @brief Maximum message length; longer messages are truncated.
+    static constexpr size_t max_message_length_ = 240;
+    /// @brief Maximum number of messages written per batch.
+    static constexpr size_t max_batch_ = 256;
+
+    /// @brief One ring slot. sequence == position when free, position + 1 when filled.
+    struct alignas(64) Slot {
+        std::atomic<size_t> sequence{ 0 };
+        LogLevel level = LogLevel::Info;
+        uint16_t length = 0;
+        char text[max_message_length_];
+    };
+
+    /// @brief Construct the logger and start the writer thread.
+    Logger();
+
+    /// @brief Stop the writer thread after draining the ring.
+    ~Logger();
+
+    /// @brief Writer thread: drain the ring in batches until stopped.
+    void run();
+
+    /// @brief Write out every filled slot (at most max_batch_ per write).
+    /// @return Number of messages written.
+    size_t drain();
+
+    /// @brief Ring storage.
+    std::array<Slot, ring_capacity_> ring_;
+    /// @brief Next position producers claim.
+    alignas(64) std::atomic<size_t> tail_{ 0 };
+    /// @brief Next position the writer consumes (writer thread only).
+    alignas(64) size_t head_ = 0;
+    /// @brief Position up to which messages have been written.
+    std::atomic<size_t> written_{ 0 };
+    /// @brief Minimum recorded level.
+    std::atomic<LogLevel> level_{ LogLevel::Info };
+    /// @brief Messages dropped because the ring was full.
+    std::atomic<uint64_t> dropped_{ 0 };
+    /// @brief Writer thread keeps running while true.
+    std::atomic<bool> running_{ true };
+    /// @brief Background writer.
+    std::thread writer_;
+};
+
+/// @brief Log at a level, evaluating the arguments only if the level is enabled.
+#define IOT_LOG(level, ...) \
+    do { \
+        if (Logger::instance().enabled(level)) Logger::instance().log(level, __VA_ARGS__); \
+    } while (0)
+
+#define LOG_DEBUG(...) IOT_LOG(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...) IOT_LOG(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARN(...) IOT_LOG(LogLevel::Warn, __VA_ARGS__)
+#define LOG_ERROR(...) IOT_LOG(LogLevel::Error, __VA_ARGS__)
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+/// @brief Minimal protobuf wire-format encoder.
+///
+/// Appends fields directly to a std::string. Only the wire types needed for the
+/// Prometheus io.prometheus.client.MetricFamily messages are supported; nested
+/// messages are encoded into a separate buffer and appended with their length.
+class ProtoWriter {
+public:
+    /// @brief Protobuf wire types.
+    enum WireType : uint32_t {
+        Varint = 0,
+        Fixed64 = 1,
+        LengthDelimited = 2
+    };
+
+    /// @brief Append a base-128 varint.
+    static void writeVarint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    /// @brief Append a field key.
+    static void writeTag(std::string& out, uint32_t field, WireType type) {
+        writeVarint(out, (static_cast<uint64_t>(field) << 3) | type);
+    }
+
+    /// @brief Append an unsigned varint field (uint32/uint64/enum).
+    static void writeUint64(std::string& out, uint32_t field, uint64_t value) {
+        writeTag(out, field, Varint);
+        writeVarint(out, value);
+    }
+
+    /// @brief Append a zigzag-encoded signed varint field (sint32/sint64).
+    static void writeSint64(std::string& out, uint32_t field, int64_t value) {
+        writeTag(out, field, Varint);
+        writeVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+    }
+
+    /// @brief Append a double field (little-endian IEEE 754).
+    static void writeDouble(std::string& out, uint32_t field, double value) {
+        writeTag(out, field, Fixed64);
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        for (int i = 0; i < 8; ++i) {
+            out.push_back(static_cast<char>(bits >> (8 * i)));
+        }
+    }
+
+    /// @brief Append a string or bytes field.
+    static void writeString(std::string& out, uint32_t field, std::string_view value) {
+        writeTag(out, field, LengthDelimited);
+        writeVarint(out, value.size());
+        out.append(value.data(), value.size());
+    }
+
+    /// @brief Append an already-encoded nested message as a field.
+    static void writeMessage(std::string& out, uint32_t field, std::string_view body) {
+        writeString(out, field, body);
+    }
+};
@@ -0,0 +1,213 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+//==============================================================================
+// CONSTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Constructs an empty sketch.
+ * @param relative_accuracy Relative accuracy a, in (0, 1).
+ * @param max_buckets Maximum number of buckets per sign.
+ */
+QuantileSketch::QuantileSketch(double relative_accuracy, size_t max_buckets)
+    : relative_accuracy_(relative_accuracy > 0.0 && relative_accuracy < 1.0 ? relative_accuracy : default_relative_accuracy)
+    , max_buckets_(max_buckets < 1 ? 1 : max_buckets)
+{
+    gamma_ = (1.0 + relative_accuracy_) / (1.0 - relative_accuracy_);
+    multiplier_ = 1.0 / std::log(gamma_);
+    // Keeps the smallest index, and value() of it, well inside the double range
+    min_indexable_ = std::numeric_limits<double>::min() * gamma_;
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Records one finite value.
+ * @param value Value to record.
+ */
+void QuantileSketch::record(double value) {
+    count_++;
+    sum_ += value;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+
+    if (value > min_indexable_) {
+        positive_.add(index(value), 1, max_buckets_);
+    }
+    else if (value < -min_indexable_) {
+        negative_.add(index(-value), 1, max_buckets_);
+    }
+    else {
+        zero_count_++;
+    }
+}
+
+/**
+ * @brief Adds another sketch's observations to this one.
+ * @param other Sketch with the same relative accuracy and bucket limit.
+ * @return False if the parameters differ and nothing was merged.
+ */
+bool QuantileSketch::merge(const QuantileSketch& other) {
+    if (other.relative_accuracy_ != relative_accuracy_ || other.max_buckets_ != max_buckets_) {
+        return false;
+    }
+    if (other.count_ == 0) {
+        return true;
+    }
+
+    for (size_t i = 0; i < other.positive_.counts.size(); ++i) {
+        if (other.positive_.counts[i] > 0) {
+            positive_.add(other.positive_.offset + static_cast<int32_t>(i), other.positive_.counts[i], max_buckets_);
+        }
+    }
+    for (size_t i = 0; i < other.negative_.counts.size(); ++i) {
+        if (other.negative_.counts[i] > 0) {
+            negative_.add(other.negative_.offset + static_cast<int32_t>(i), other.negative_.counts[i], max_buckets_);
+        }
+    }
+    zero_count_ += other.zero_count_;
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    return true;
+}
+
+/**
+ * @brief Replaces the observations with previously saved ones.
+ * @param count Number of recorded values.
+ * @param sum Sum of recorded values.
+ * @param min Smallest recorded value.
+ * @param max Largest recorded value.
+ * @param zero_count Number of values counted as zero.
+ * @param positive Buckets of positive values.
+ * @param negative Buckets of negative values.
+ * @return False, leaving the sketch unchanged, if the buckets do not fit this sketch.
+ */
+bool QuantileSketch::restore(uint64_t count, double sum, double min, double max, uint64_t zero_count,
+    Buckets positive, Buckets negative) {
+    if (positive.counts.size() > max_buckets_ || negative.counts.size() > max_buckets_) {
+        return false;
+    }
+    count_ = count;
+    sum_ = sum;
+    min_ = min;
+    max_ = max;
+    zero_count_ = zero_count;
+    positive_ = std::move(positive);
+    negative_ = std::move(negative);
+    return true;
+}
+
+/**
+ * @brief Estimates a quantile.
+ *
+ * Walks the buckets from the most negative value up and returns the
+ * representative value of the bucket holding rank q * (count - 1).
+ * @param q Quantile in [0, 1].
+ * @return The estimate, or NaN if the sketch is empty.
+ */
+double QuantileSketch::quantile(double q) const {
+    if (count_ == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    q = std::min(std::max(q, 0.0), 1.0);
+    const double rank = q * static_cast<double>(count_ - 1);
+
+    double estimate = 0.0;
+    uint64_t cumulative = 0;
+    bool found = false;
+    for (size_t i = negative_.counts.size(); i-- > 0 && !found;) {
+        cumulative += negative_.counts[i];
+        if (static_cast<double>(cumulative) > rank) {
+            estimate = -value(negative_.offset + static_cast<int32_t>(i));
+            found = true;
+        }
+    }
+    if (!found) {
+        cumulative += zero_count_;
+        found = static_cast<double>(cumulative) > rank;
+    }
+    for (size_t i = 0; i < positive_.counts.size() && !found; ++i) {
+        cumulative += positive_.counts[i];
+        if (static_cast<double>(cumulative) > rank) {
+            estimate = value(positive_.offset + static_cast<int32_t>(i));
+            found = true;
+        }
+    }
+    if (!found) {
+        estimate = max_;
+    }
+    return std::min(std::max(estimate, min_), max_);
+}
+
+//==============================================================================
+// PRIVATE METHODS
+//==============================================================================
+
+/**
+ * @brief Adds n to a bucket.
+ *
+ * If the window would exceed max_buckets, every bucket below the lowest one
+ * that still fits is folded into it (a value below the window is counted there
+ * too), so the highest magnitudes keep their accuracy.
+ * @param index Bucket index.
+ * @param n Count to add.
+ * @param max_buckets Maximum window size.
+ */
+void QuantileSketch::Buckets::add(int32_t index, uint64_t n, size_t max_buckets) {
+    if (counts.empty()) {
+        offset = index;
+        counts.assign(1, n);
+        return;
+    }
+
+    const int32_t high = std::max(offset + static_cast<int32_t>(counts.size()) - 1, index);
+    const int32_t lowest_kept = high - static_cast<int32_t>(max_buckets) + 1;
+    if (offset < lowest_kept) {
+        // Fold the buckets that fall off the bottom of the window into the lowest kept one
+        const size_t dropped = static_cast<size_t>(lowest_kept - offset);
+        uint64_t folded = 0;
+        for (size_t i = 0; i < dropped && i < counts.size(); ++i) {
+            folded += counts[i];
+        }
+        counts.erase(counts.begin(), counts.begin() + static_cast<std::ptrdiff_t>(std::min(dropped, counts.size())));
+        offset = lowest_kept;
+        if (counts.empty()) {
+            counts.assign(1, 0);
+        }
+        counts[0] += folded;
+    }
+    index = std::max(index, lowest_kept);
+
+    if (index < offset) {
+        counts.insert(counts.begin(), static_cast<size_t>(offset - index), 0);
+        offset = index;
+    }
+    const size_t position = static_cast<size_t>(index - offset);
+    if (position >= counts.size()) {
+        counts.resize(position + 1, 0);
+    }
+    counts[position] += n;
+}
+
+/**
+ * @brief Returns the bucket index of a magnitude: ceil(log_gamma(magnitude)).
+ */
+int32_t QuantileSketch::index(double magnitude) const {
+    return static_cast<int32_t>(std::ceil(std::log(magnitude) * multiplier_));
+}
+
+/**
+ * @brief Returns the representative magnitude of a bucket.
+ *
+ * 2 * gamma^i / (gamma + 1) is within a of both bucket bounds.
+ */
+double QuantileSketch::value(int32_t index) const {
+    return 2.0 * std::pow(gamma_, index) / (gamma_ + 1.0);
+}
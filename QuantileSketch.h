@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+/// @brief Mergeable quantile sketch with relative-error guarantees (DDSketch).
+///
+/// Values are counted in logarithmic buckets: bucket i holds magnitudes in
+/// (gamma^(i-1), gamma^i] with gamma = (1 + a) / (1 - a), so any reported
+/// quantile is within relative error a of the true one. Each sign keeps at most
+/// max_buckets buckets; past that the lowest buckets collapse into one, which
+/// only costs accuracy for the smallest magnitudes and keeps tail quantiles
+/// exact to a. Sketches with the same parameters merge by adding bucket counts.
+class QuantileSketch {
+public:
+    /// @brief Default relative accuracy (1%).
+    static constexpr double default_relative_accuracy = 0.01;
+    /// @brief Default maximum number of buckets per sign (a dynamic range of about 10^17 at 1%).
+    static constexpr size_t default_max_buckets = 2048;
+
+    /// @brief Bucket counts for one sign, as a contiguous window of indexes.
+    struct Buckets {
+        /// @brief Index of counts[0].
+        int32_t offset = 0;
+        /// @brief Per-bucket counts.
+        std::vector<uint64_t> counts;
+
+        /// @brief Add n to a bucket, collapsing the lowest buckets if the window would exceed max_buckets.
+        void add(int32_t index, uint64_t n, size_t max_buckets);
+    };
+
+    /// @brief Construct an empty sketch.
+    /// @param relative_accuracy Relative accuracy a, in (0, 1).
+    /// @param max_buckets Maximum number of buckets per sign.
+    explicit QuantileSketch(double relative_accuracy = default_relative_accuracy,
+        size_t max_buckets = default_max_buckets);
+
+    /// @brief Record one finite value.
+    void record(double value);
+
+    /// @brief Add another sketch's observations (it must have the same parameters).
+    /// @return False if the parameters differ and nothing was merged.
+    bool merge(const QuantileSketch& other);
+
+    /// @brief Replace the observations with previously saved ones (e.g. from a snapshot).
+    /// @return False, leaving the sketch unchanged, if a bucket window exceeds max_buckets.
+    bool restore(uint64_t count, double sum, double min, double max, uint64_t zero_count,
+        Buckets positive, Buckets negative);
+
+    /// @brief Estimate a quantile.
+    /// @param q Quantile in [0, 1].
+    /// @return The estimate (clamped to the observed min/max), or NaN if the sketch is empty.
+    double quantile(double q) const;
+
+    /// @brief Number of recorded values.
+    uint64_t count() const { return count_; }
+    /// @brief Sum of recorded values.
+    double sum() const { return sum_; }
+    /// @brief Smallest recorded value.
+    double min() const { return min_; }
+    /// @brief Largest recorded value.
+    double max() const { return max_; }
+    /// @brief Number of values counted as zero.
+    uint64_t zeroCount() const { return zero_count_; }
+    /// @brief Buckets of positive values.
+    const Buckets& positive() const { return positive_; }
+    /// @brief Buckets of negative values (by magnitude).
+    const Buckets& negative() const { return negative_; }
+    /// @brief Heap bytes held by the bucket arrays.
+    size_t bucketBytes() const {
+        return (positive_.counts.capacity() + negative_.counts.capacity()) * sizeof(uint64_t);
+    }
+
+private:
+    /// @brief Bucket index of a magnitude above min_indexable_.
+    int32_t index(double magnitude) const;
+
+    /// @brief Representative magnitude of a bucket (within a of every value in it).
+    double value(int32_t index) const;
+
+    /// @brief Relative accuracy a.
+    double relative_accuracy_;
+    /// @brief Maximum number of buckets per sign.
+    size_t max_buckets_;
+    /// @brief gamma = (1 + a) / (1 - a).
+    double gamma_;
+    /// @brief 1 / ln(gamma).
+    double multiplier_;
+    /// @brief Smallest magnitude given its own bucket; anything smaller counts as zero.
+    double min_indexable_;
+    /// @brief Number of recorded values.
+    uint64_t count_ = 0;
+    /// @brief Sum of recorded values.
+    double sum_ = 0.0;
+    /// @brief Smallest recorded value.
+    double min_ = std::numeric_limits<double>::max();
+    /// @brief Largest recorded value.
+    double max_ = std::numeric_limits<double>::lowest();
+    /// @brief Number of values counted as zero.
+    uint64_t zero_count_ = 0;
+    /// @brief Buckets of positive values.
+    Buckets positive_;
+    /// @brief Buckets of negative values, by magnitude.
+    Buckets negative_;
+};
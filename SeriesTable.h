@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+#include "LabelPool.h"
+
+/// @brief Open-addressing table of series keyed by a 64-bit attribute fingerprint.
+///
+/// Entries are kept in a deque so references to them stay valid while the table
+/// grows. The index is a power-of-two array of (fingerprint, entry index + 1)
+/// slots probed linearly. Equal fingerprints are told apart by comparing the
+/// stored labels, so a collision costs an extra compare, never a wrong series.
+/// Not thread-safe; callers serialize access.
+/// @tparam Value Per-series state.
+template <typename Value>
+class SeriesTable {
+public:
+    /// @brief One series: its identity and state.
+    struct Entry {
+        /// @brief Fingerprint of the series attributes.
+        uint64_t fingerprint;
+        /// @brief Interned attributes, in key order.
+        LabelSet labels;
+        /// @brief Series state.
+        Value value;
+        /// @brief Coarse time of the last update, in seconds (maintained by the owner).
+        int64_t updated_at = 0;
+    };
+
+    /// @brief Find a series.
+    /// @param fingerprint Fingerprint of the attributes being looked up.
+    /// @param matches Predicate called with a candidate's LabelSet; returns true on a real match.
+    /// @return The entry, or nullptr if absent.
+    template <typename Match>
+    Entry* find(uint64_t fingerprint, Match&& matches) {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        const size_t mask = slots_.size() - 1;
+        for (size_t slot = fingerprint & mask;; slot = (slot + 1) & mask) {
+            const Slot& candidate = slots_[slot];
+            if (candidate.index == 0) {
+                return nullptr;
+            }
+            if (candidate.fingerprint == fingerprint) {
+                Entry& entry = entries_[candidate.index - 1];
+                if (matches(entry.labels)) {
+                    return &entry;
+                }
+            }
+        }
+    }
+
+    /// @brief Insert a series known to be absent.
+    /// @param fingerprint Fingerprint of the attributes.
+    /// @param labels Interned attributes.
+    /// @param value Initial series state.
+    /// @return The new entry.
+    Entry& insert(uint64_t fingerprint, LabelSet labels, Value value) {
+        if ((entries_.size() + 1) * 2 > slots_.size()) {
+            grow();
+        }
+        entries_.push_back(Entry{ fingerprint, std::move(labels), std::move(value) });
+        place(fingerprint, static_cast<uint32_t>(entries_.size()));
+        return entries_.back();
+    }
+
+    /// @brief Remove every series the predicate selects.
+    ///
+    /// Remaining series keep their insertion order; references to entries are
+    /// invalidated if anything was removed, and the index is rebuilt at the
+    /// smallest size that holds the rest.
+    /// @param remove Predicate called once with each Entry; returns true to remove it.
+    /// @return Number of series removed.
+    template <typename Predicate>
+    size_t eraseIf(Predicate&& remove) {
+        size_t kept = 0;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (remove(entries_[i])) {
+                continue;
+            }
+            if (kept != i) {
+                entries_[kept] = std::move(entries_[i]);
+            }
+            ++kept;
+        }
+        const size_t removed = entries_.size() - kept;
+        if (removed > 0) {
+            entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(kept), entries_.end());
+            size_t slot_count = 16;
+            while (entries_.size() * 2 > slot_count) {
+                slot_count *= 2;
+            }
+            slots_.assign(entries_.empty() ? 0 : slot_count, Slot());
+            for (size_t i = 0; i < entries_.size(); ++i) {
+                place(entries_[i].fingerprint, static_cast<uint32_t>(i + 1));
+            }
+        }
+        return removed;
+    }
+
+    /// @brief Number of series.
+    size_t size() const { return entries_.size(); }
+
+    /// @brief Approximate bytes held by the entries and the index (not by what entries point to).
+    size_t memoryBytes() const { return entries_.size() * sizeof(Entry) + slots_.capacity() * sizeof(Slot); }
+
+    /// @brief Whether the table holds no series.
+    bool empty() const { return entries_.empty(); }
+
+    /// @brief Iterate series in insertion order.
+    typename std::deque<Entry>::iterator begin() { return entries_.begin(); }
+    typename std::deque<Entry>::iterator end() { return entries_.end(); }
+    typename std::deque<Entry>::const_iterator begin() const { return entries_.begin(); }
+    typename std::deque<Entry>::const_iterator end() const { return entries_.end(); }
+
+private:
+    /// @brief Index slot; index 0 marks an empty slot.
+    struct Slot {
+        uint64_t fingerprint = 0;
+        uint32_t index = 0;
+    };
+
+    /// @brief Put an entry index into the first free slot of its probe sequence.
+    void place(uint64_t fingerprint, uint32_t index) {
+        const size_t mask = slots_.size() - 1;
+        size_t slot = fingerprint & mask;
+        while (slots_[slot].index != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = Slot{ fingerprint, index };
+    }
+
+    /// @brief Double the index (starting at 16 slots) and re-place every entry.
+    void grow() {
+        slots_.assign(slots_.empty() ? 16 : slots_.size() * 2, Slot());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            place(entries_[i].fingerprint, static_cast<uint32_t>(i + 1));
+        }
+    }
+
+    /// @brief Probe index.
+    std::vector<Slot> slots_;
+    /// @brief Series storage, in insertion order.
+    std::deque<Entry> entries_;
+};
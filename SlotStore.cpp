@@ -0,0 +1,423 @@
+#include "SlotStore.h"
+#include "WriteAheadLog.h"
+#include "Logger.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/// @brief Identifies a slot file (first 8 bytes).
+constexpr char slot_magic[8] = { 'I', 'O', 'T', 'S', 'L', 'O', 'T', '1' };
+
+/// @brief Header at the start of the slot file; slots follow it.
+struct FileHeader {
+    char magic[8];
+    uint32_t slot_size;
+    uint32_t reserved;
+    uint64_t capacity;
+    char padding[40];
+};
+
+static_assert(sizeof(FileHeader) == 64, "slot file header must stay 64 bytes");
+static_assert(sizeof(SlotStore::Slot) == 16, "slots must stay 16 bytes");
+static_assert(std::atomic<double>::is_always_lock_free, "slot values must be lock-free to live in a shared mapping");
+
+/**
+ * @brief Appends a 32-bit value in little-endian byte order.
+ */
+void appendUint32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value.
+ */
+uint32_t readUint32(const char* bytes) {
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(bytes);
+    return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+        (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+/**
+ * @brief Builds a framed catalog record: slot index, generation, kind, then the owner identity.
+ */
+void appendRecord(std::string& out, uint32_t index, uint32_t generation, uint8_t kind, std::string_view identity) {
+    std::string payload;
+    payload.reserve(9 + identity.size());
+    appendUint32(payload, index);
+    appendUint32(payload, generation);
+    payload += static_cast<char>(kind);
+    payload.append(identity.data(), identity.size());
+    WriteAheadLog::frameRecord(out, payload);
+}
+
+#ifndef _WIN32
+/**
+ * @brief Writes a whole buffer to a descriptor, retrying short writes.
+ * @return False on the first error.
+ */
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        const ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+#endif
+
+} // namespace
+
+//==============================================================================
+// HANDLE
+//==============================================================================
+
+/**
+ * @brief Takes over another handle's slot, releasing the one held before.
+ */
+SlotStore::Handle& SlotStore::Handle::operator=(Handle&& other) noexcept {
+    if (this != &other) {
+        if (slot_) {
+            store_->release(index_);
+        }
+        store_ = std::move(other.store_);
+        slot_ = other.slot_;
+        index_ = other.index_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+/**
+ * @brief Returns the slot to the free list.
+ */
+SlotStore::Handle::~Handle() {
+    if (slot_) {
+        store_->release(index_);
+    }
+}
+
+/**
+ * @brief Adds to the slot value with a compare-and-swap loop.
+ */
+void SlotStore::Handle::add(double value) const {
+    double current = slot_->value.load(std::memory_order_relaxed);
+    while (!slot_->value.compare_exchange_weak(current, current + value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * @brief Constructs a handle to an allocated slot and counts it as used.
+ */
+SlotStore::Handle::Handle(std::shared_ptr<SlotStore> store, uint32_t index)
+    : store_(std::move(store))
+    , slot_(store_->slots_ + index)
+    , index_(index)
+{
+    store_->used_.fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+// CONSTRUCTOR & DESTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Returns whether memory-mapped slot files are available on this platform.
+ */
+bool SlotStore::supported() {
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+}
+
+/**
+ * @brief Maps the slot file of a directory, creating or growing it, and opens the catalog.
+ *
+ * The file is grown with ftruncate, so slots that were never written take no
+ * disk space. A file written with a different slot layout is rejected rather
+ * than reinterpreted.
+ * @param directory Directory holding series.slots and series.catalog (must exist).
+ * @param capacity Number of slots to provide.
+ * @return The store.
+ * @throws std::runtime_error if the files cannot be opened or mapped.
+ */
+std::shared_ptr<SlotStore> SlotStore::open(const std::string& directory, size_t capacity) {
+#ifdef _WIN32
+    (void)directory;
+    (void)capacity;
+    throw std::runtime_error("Memory-mapped series slots are not supported on this platform");
+#else
+    const std::string path = directory + "/series.slots";
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open series slot file: " + path);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot read series slot file: " + path);
+    }
+    const size_t existing_size = static_cast<size_t>(info.st_size);
+    if (existing_size > 0) {
+        FileHeader header;
+        if (existing_size < sizeof(header) || pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+            std::memcmp(header.magic, slot_magic, sizeof(slot_magic)) != 0 || header.slot_size != sizeof(Slot)) {
+            ::close(fd);
+            throw std::runtime_error("Not a series slot file (or written with another slot layout): " + path);
+        }
+        capacity = std::max<size_t>(capacity, static_cast<size_t>(header.capacity));
+    }
+    capacity = std::min<size_t>(capacity, UINT32_MAX);
+
+    const size_t mapping_size = sizeof(FileHeader) + capacity * sizeof(Slot);
+    if (mapping_size > existing_size && ftruncate(fd, static_cast<off_t>(mapping_size)) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Cannot grow series slot file: " + path);
+    }
+    void* mapping = mmap(nullptr, mapping_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error("Cannot map series slot file: " + path);
+    }
+
+    FileHeader* header = static_cast<FileHeader*>(mapping);
+    std::memcpy(header->magic, slot_magic, sizeof(slot_magic));
+    header->slot_size = sizeof(Slot);
+    header->capacity = capacity;
+
+    std::shared_ptr<SlotStore> store(new SlotStore(directory, capacity, fd, mapping, mapping_size));
+    store->catalog_fd_ = ::open(store->catalogPath().c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (store->catalog_fd_ < 0) {
+        throw std::runtime_error("Cannot open series catalog: " + store->catalogPath());
+    }
+    return store;
+#endif
+}
+
+/**
+ * @brief Constructs a store over a mapped file.
+ */
+SlotStore::SlotStore(std::string directory, size_t capacity, int fd, void* mapping, size_t mapping_size)
+    : directory_(std::move(directory))
+    , capacity_(capacity)
+    , fd_(fd)
+    , mapping_(mapping)
+    , mapping_size_(mapping_size)
+    , slots_(reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(FileHeader)))
+{
+    // Reserved up front so release(), which runs in noexcept destructors, never allocates.
+    free_.reserve(capacity_);
+}
+
+/**
+ * @brief Closes the catalog and unmaps the file; the page cache still writes dirty slots back.
+ */
+SlotStore::~SlotStore() {
+#ifndef _WIN32
+    if (catalog_fd_ >= 0) {
+        ::close(catalog_fd_);
+    }
+    munmap(mapping_, mapping_size_);
+    ::close(fd_);
+#endif
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Hands back every live slot recorded in the catalog and frees every other slot.
+ *
+ * A catalog record matches when its slot still has the recorded kind and
+ * generation; records of slots that were freed or reallocated since do not.
+ * Live slots without a matching record (allocated just before a crash that
+ * lost the record) are cleared.
+ * @param adopt Called with each live slot, its kind and its owner identity;
+ * returns false (or leaves the handle unmoved) to free the slot.
+ * @return Number of slots adopted.
+ */
+size_t SlotStore::recover(const std::function<bool(Handle& handle, uint8_t kind, std::string_view identity)>& adopt) {
+    std::vector<std::pair<uint32_t, std::string>> candidates;
+    std::vector<bool> matched(capacity_, false);
+    bool torn = false;
+    WriteAheadLog::replay(catalogPath(), [&](std::string_view record) {
+        if (record.size() < 9) {
+            return;
+        }
+        const uint32_t index = readUint32(record.data());
+        const uint32_t generation = readUint32(record.data() + 4);
+        const uint8_t kind = static_cast<uint8_t>(record[8]);
+        if (index >= capacity_ || matched[index] || kind == 0 ||
+            slots_[index].kind != kind || slots_[index].generation != generation) {
+            return;
+        }
+        matched[index] = true;
+        candidates.emplace_back(index, std::string(record.substr(9)));
+    }, torn);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = capacity_; i-- > 0;) {
+            if (!matched[i]) {
+                slots_[i].kind = 0;
+                free_.push_back(static_cast<uint32_t>(i));
+            }
+        }
+    }
+
+    size_t adopted = 0;
+    for (auto& candidate : candidates) {
+        Slot& slot = slots_[candidate.first];
+        Handle handle(shared_from_this(), candidate.first);
+        if (adopt(handle, slot.kind, candidate.second) && !handle) {
+            ++adopted;
+        }
+        else {
+            slot.kind = 0;
+        }
+    }
+    return adopted;
+}
+
+/**
+ * @brief Allocates a zeroed slot and appends its catalog record.
+ *
+ * The record is written before the slot is marked live, so a crash in between
+ * leaves a record that recover() ignores rather than a live slot it cannot place.
+ * If the record cannot be written, whatever part of it reached the catalog is
+ * cut off again (recover() would stop at a torn record and lose every later
+ * one) and the slot goes back to the free list.
+ * @param kind Owner kind (non-zero).
+ * @param identity Opaque description of the owner.
+ * @return The slot, or an empty handle if every slot is in use or the record could not be written.
+ */
+SlotStore::Handle SlotStore::allocate(uint8_t kind, std::string_view identity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_.empty()) {
+        exhausted_.fetch_add(1, std::memory_order_relaxed);
+        return Handle();
+    }
+    const uint32_t index = free_.back();
+    free_.pop_back();
+
+    Slot& slot = slots_[index];
+    slot.kind = 0;
+    ++slot.generation;
+    slot.value.store(0.0, std::memory_order_relaxed);
+
+    std::string record;
+    appendRecord(record, index, slot.generation, kind, identity);
+#ifndef _WIN32
+    struct stat info;
+    const off_t size = fstat(catalog_fd_, &info) == 0 ? info.st_size : -1;
+    if (size < 0 || !writeAll(catalog_fd_, record.data(), record.size())) {
+        if (size >= 0 && ftruncate(catalog_fd_, size) != 0) {
+            LOG_ERROR("Cannot cut a torn record off the series catalog; series allocated until the next "
+                "snapshot may not be restored");
+        }
+        free_.push_back(index);
+        catalog_errors_.fetch_add(1, std::memory_order_relaxed);
+        return Handle();
+    }
+#endif
+    slot.kind = kind;
+    return Handle(shared_from_this(), index);
+}
+
+/**
+ * @brief Appends the catalog record of a live slot to a buffer (retired slots are skipped).
+ */
+void SlotStore::appendCatalogEntry(std::string& out, const Handle& handle, std::string_view identity) const {
+    const Slot& slot = slots_[handle.index()];
+    if (slot.kind != 0) {
+        appendRecord(out, handle.index(), slot.generation, slot.kind, identity);
+    }
+}
+
+/**
+ * @brief Replaces the catalog with the given records.
+ *
+ * The records go to a temporary file that is synced and renamed over the
+ * catalog; the descriptor that wrote it then becomes the one allocations
+ * append to, so there is no reopen that could fail. Until the rename, the old
+ * catalog stays open and in use.
+ * @param entries Records built with appendCatalogEntry().
+ * @return False if the new catalog could not be written (the old one is kept and still appended to).
+ */
+bool SlotStore::replaceCatalog(std::string_view entries) {
+#ifdef _WIN32
+    (void)entries;
+    return false;
+#else
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::string path = catalogPath();
+    const std::string temporary = path + ".tmp";
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    if (!writeAll(fd, entries.data(), entries.size()) || fsync(fd) != 0 ||
+        std::rename(temporary.c_str(), path.c_str()) != 0) {
+        ::close(fd);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    WriteAheadLog::syncDirectory(path);
+    ::close(catalog_fd_);
+    catalog_fd_ = fd;
+    return true;
+#endif
+}
+
+/**
+ * @brief Writes dirty slots and the catalog to disk.
+ */
+void SlotStore::sync() {
+#ifndef _WIN32
+    msync(mapping_, mapping_size_, MS_SYNC);
+    std::lock_guard<std::mutex> lock(mutex_);
+    fsync(catalog_fd_);
+#endif
+}
+
+//==============================================================================
+// PRIVATE METHODS
+//==============================================================================
+
+/**
+ * @brief Returns a slot to the free list.
+ */
+void SlotStore::release(uint32_t index) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(index);
+    used_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the path of the catalog file.
+ */
+std::string SlotStore::catalogPath() const {
+    return directory_ + "/series.catalog";
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// @brief Series values in fixed-size slots of a memory-mapped file, with a catalog of slot owners.
+///
+/// Each slot is 16 bytes: the value (an atomic double updated in place), a
+/// generation and a kind byte (0 = free). Values are written straight into the
+/// shared mapping, so they survive a process crash without being logged and the
+/// page cache writes them back; sync() forces them to disk. The series a slot
+/// belongs to is recorded once, when the slot is allocated, as a record in an
+/// append-only catalog file (framed like write-ahead log records). On restart,
+/// recover() hands back every catalog record whose slot is still live with the
+/// same generation. Slots are reused only once every Handle to them is gone, so
+/// a stale holder can never write into another series' slot.
+class SlotStore : public std::enable_shared_from_this<SlotStore> {
+public:
+    /// @brief One slot of the mapped file.
+    struct Slot {
+        /// @brief Current value.
+        std::atomic<double> value;
+        /// @brief Bumped on every allocation, so catalog records of earlier owners do not match.
+        uint32_t generation;
+        /// @brief Caller-defined kind of the owner (0 while the slot is free or retired).
+        uint8_t kind;
+        /// @brief Padding.
+        uint8_t reserved[3];
+    };
+
+    /// @brief Owning reference to an allocated slot; the slot becomes reusable when the last one is destroyed.
+    class Handle {
+    public:
+        /// @brief Construct an empty handle.
+        Handle() = default;
+        Handle(Handle&& other) noexcept { *this = std::move(other); }
+        Handle& operator=(Handle&& other) noexcept;
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+        ~Handle();
+
+        /// @brief Whether the handle refers to a slot.
+        explicit operator bool() const { return slot_ != nullptr; }
+        /// @brief Slot index.
+        uint32_t index() const { return index_; }
+        /// @brief Current value.
+        double load() const { return slot_->value.load(std::memory_order_relaxed); }
+        /// @brief Set the value.
+        void store(double value) const { slot_->value.store(value, std::memory_order_relaxed); }
+        /// @brief Add to the value (lock-free).
+        void add(double value) const;
+        /// @brief Mark the slot dead so a restart ignores it (the handle stays usable until destroyed).
+        void retire() const { slot_->kind = 0; }
+
+    private:
+        friend class SlotStore;
+
+        /// @brief Construct a handle to an allocated slot.
+        Handle(std::shared_ptr<SlotStore> store, uint32_t index);
+
+        /// @brief Store the slot belongs to (kept alive while the handle exists).
+        std::shared_ptr<SlotStore> store_;
+        /// @brief The slot.
+        Slot* slot_ = nullptr;
+        /// @brief Slot index.
+        uint32_t index_ = 0;
+    };
+
+    /// @brief Whether memory-mapped slot files are available on this platform.
+    static bool supported();
+
+    /// @brief Map (creating or growing) the slot file and open the catalog in a directory.
+    /// @param directory Directory holding series.slots and series.catalog (must exist).
+    /// @param capacity Number of slots to provide (an existing larger file keeps its size).
+    /// @return The store.
+    /// @throws std::runtime_error if the files cannot be opened or mapped.
+    static std::shared_ptr<SlotStore> open(const std::string& directory, size_t capacity);
+
+    /// @brief Unmap the file and close the catalog.
+    ~SlotStore();
+
+    SlotStore(const SlotStore&) = delete;
+    SlotStore& operator=(const SlotStore&) = delete;
+
+    /// @brief Hand back every live slot recorded in the catalog; free every other slot.
+    ///
+    /// Must be called once, before the first allocate().
+    /// @param adopt Called with each live slot, its kind and the identity it was allocated with;
+    /// returns false (or leaves the handle unmoved) to free the slot.
+    /// @return Number of slots adopted.
+    size_t recover(const std::function<bool(Handle& handle, uint8_t kind, std::string_view identity)>& adopt);
+
+    /// @brief Allocate a zeroed slot and append its catalog record.
+    /// @param kind Owner kind (non-zero).
+    /// @param identity Opaque description of the owner, returned by recover() after a restart.
+    /// @return The slot, or an empty handle if every slot is in use or the record could not be written.
+    Handle allocate(uint8_t kind, std::string_view identity);
+
+    /// @brief Append a catalog record for a slot to a buffer (see replaceCatalog()).
+    void appendCatalogEntry(std::string& out, const Handle& handle, std::string_view identity) const;
+
+    /// @brief Replace the catalog with the given records, dropping those of freed slots.
+    /// @note No slot may be allocated concurrently.
+    /// @return False if the new catalog could not be written (the old one is kept).
+    bool replaceCatalog(std::string_view entries);
+
+    /// @brief Write dirty slots and the catalog to disk.
+    void sync();
+
+    /// @brief Number of slots.
+    size_t capacity() const { return capacity_; }
+    /// @brief Size of the slot file in bytes (sparse: slots never written take no disk space).
+    size_t fileBytes() const { return mapping_size_; }
+    /// @brief Slots held by a handle.
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+    /// @brief Allocations refused because every slot was in use.
+    uint64_t exhausted() const { return exhausted_.load(std::memory_order_relaxed); }
+    /// @brief Allocations refused because the catalog record could not be written.
+    uint64_t catalogErrors() const { return catalog_errors_.load(std::memory_order_relaxed); }
+
+private:
+    /// @brief Construct a store over a mapped file (see open()).
+    SlotStore(std::string directory, size_t capacity, int fd, void* mapping, size_t mapping_size);
+
+    /// @brief Return a slot to the free list (called by the last handle).
+    void release(uint32_t index);
+
+    /// @brief Path of the catalog file.
+    std::string catalogPath() const;
+
+    /// @brief Directory holding the files.
+    std::string directory_;
+    /// @brief Number of slots.
+    size_t capacity_;
+    /// @brief Slot file descriptor.
+    int fd_;
+    /// @brief Start of the mapping (the file header).
+    void* mapping_;
+    /// @brief Size of the mapping in bytes.
+    size_t mapping_size_;
+    /// @brief First slot.
+    Slot* slots_;
+
+    /// @brief Guards free_ and catalog_fd_.
+    std::mutex mutex_;
+    /// @brief Free slot indexes (lowest last).
+    std::vector<uint32_t> free_;
+    /// @brief Catalog file descriptor, opened for appending.
+    int catalog_fd_ = -1;
+    /// @brief Slots held by a handle.
+    std::atomic<size_t> used_{ 0 };
+    /// @brief Allocations refused because every slot was in use.
+    std::atomic<uint64_t> exhausted_{ 0 };
+    /// @brief Allocations refused because the catalog record could not be written.
+    std::atomic<uint64_t> catalog_errors_{ 0 };
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// @brief Append-only text formatting for the exposition formats.
+///
+/// Numbers are written with std::to_chars into a stack buffer and appended, so
+/// formatting is locale-independent and allocates nothing once the output
+/// string has capacity. Doubles use the shortest form that round-trips, and the
+/// non-finite values are spelled the way Prometheus expects.
+class TextWriter {
+public:
+    /// @brief Append raw text.
+    static void append(std::string& out, std::string_view text) {
+        out.append(text.data(), text.size());
+    }
+
+    /// @brief Append an unsigned integer.
+    static void appendUint(std::string& out, uint64_t value) {
+        char digits[20];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    /// @brief Append a double in shortest round-trip form (+Inf, -Inf, NaN for non-finite values).
+    static void appendDouble(std::string& out, double value) {
+        if (std::isnan(value)) {
+            out += "NaN";
+            return;
+        }
+        if (std::isinf(value)) {
+            out += value > 0 ? "+Inf" : "-Inf";
+            return;
+        }
+        char digits[32];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, static_cast<size_t>(result.ptr - digits));
+    }
+
+    /// @brief Append a label name, replacing characters outside [a-zA-Z0-9_] with '_' (and prefixing a leading digit).
+    static void appendLabelName(std::string& out, std::string_view name) {
+        if (!name.empty() && name[0] >= '0' && name[0] <= '9') {
+            out += '_';
+        }
+        for (char c : name) {
+            const bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+            out += valid ? c : '_';
+        }
+    }
+
+    /// @brief Append a label value, escaping backslash, double quote and newline.
+    static void appendLabelValue(std::string& out, std::string_view value) {
+        for (char c : value) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+    }
+
+    /// @brief Append HELP text, escaping backslash and newline.
+    static void appendHelp(std::string& out, std::string_view text) {
+        for (char c : text) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+    }
+
+    /// @brief Append OpenMetrics HELP text, which also escapes double quotes.
+    static void appendOpenMetricsHelp(std::string& out, std::string_view text) {
+        for (char c : text) {
+            switch (c) {
+            case '\\': out += "\\\\"; break;
+            case '"': out += "\\\""; break;
+            case '\n': out += "\\n"; break;
+            default: out += c; break;
+            }
+        }
+    }
+};
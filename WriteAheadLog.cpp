@@ -0,0 +1,540 @@
+#include "WriteAheadLog.h"
+#include "Logger.h"
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/**
+ * @brief Appends a 32-bit value in little-endian byte order.
+ */
+void appendUint32(std::string& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value.
+ */
+uint32_t readUint32(const unsigned char* bytes) {
+    return static_cast<uint32_t>(bytes[0]) | (static_cast<uint32_t>(bytes[1]) << 8) |
+        (static_cast<uint32_t>(bytes[2]) << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+}
+
+/**
+ * @brief Flushes a stream and syncs its file to disk.
+ * @return False if either step failed.
+ */
+bool syncFile(std::FILE* file) {
+    if (std::fflush(file) != 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+/**
+ * @brief Opens a file for appending, creating it if missing.
+ * @return The descriptor, or -1.
+ */
+int openForAppend(const std::string& path) {
+#ifdef _WIN32
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+#endif
+}
+
+/**
+ * @brief Returns the size of an open file, or -1.
+ */
+int64_t descriptorSize(int fd) {
+#ifdef _WIN32
+    return _lseeki64(fd, 0, SEEK_END);
+#else
+    return static_cast<int64_t>(lseek(fd, 0, SEEK_END));
+#endif
+}
+
+/**
+ * @brief Writes a whole buffer, retrying short writes.
+ * @return False on the first error.
+ */
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+#ifdef _WIN32
+        const int written = _write(fd, data, static_cast<unsigned int>(std::min<size_t>(length, 1u << 30)));
+#else
+        const ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+/**
+ * @brief Syncs a file to disk.
+ */
+bool syncDescriptor(int fd) {
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#else
+    return fsync(fd) == 0;
+#endif
+}
+
+/**
+ * @brief Cuts a file to a length and syncs it.
+ */
+bool truncateDescriptor(int fd, uint64_t length) {
+#ifdef _WIN32
+    return _chsize_s(fd, static_cast<__int64>(length)) == 0 && _commit(fd) == 0;
+#else
+    return ftruncate(fd, static_cast<off_t>(length)) == 0 && fsync(fd) == 0;
+#endif
+}
+
+/**
+ * @brief Closes a descriptor.
+ */
+void closeDescriptor(int fd) {
+#ifdef _WIN32
+    _close(fd);
+#else
+    close(fd);
+#endif
+}
+
+} // namespace
+
+//==============================================================================
+// CONSTRUCTOR & DESTRUCTOR
+//==============================================================================
+
+/**
+ * @brief Creates the first segment and starts the committer thread.
+ * @param directory Directory holding the segments (must exist).
+ * @param segment Number of the segment to create.
+ * @param commit_interval Longest time a record waits before it is committed.
+ * @throws std::runtime_error if the segment file cannot be created.
+ */
+WriteAheadLog::WriteAheadLog(std::string directory, uint64_t segment, std::chrono::milliseconds commit_interval)
+    : directory_(std::move(directory))
+    , commit_interval_(commit_interval)
+{
+    if (!openSegment(segment)) {
+        throw std::runtime_error("Cannot create write-ahead log segment: " + segmentPath(directory_, segment));
+    }
+    committer_ = std::thread(&WriteAheadLog::run, this);
+}
+
+/**
+ * @brief Commits pending records, stops the committer and closes the segment.
+ */
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    condition_.notify_one();
+    space_.notify_all();
+    if (committer_.joinable()) {
+        committer_.join();
+    }
+    flush();
+    if (fd_ >= 0) {
+        closeDescriptor(fd_);
+    }
+}
+
+//==============================================================================
+// PUBLIC METHODS
+//==============================================================================
+
+/**
+ * @brief Frames a record and queues it for the next group commit.
+ *
+ * Blocks while the batch already holds max_pending_bytes (a record larger than
+ * that is accepted into an empty batch); the committer is woken early once the
+ * batch is full.
+ * @param record Record payload.
+ * @return Sequence number of the record.
+ */
+uint64_t WriteAheadLog::append(std::string_view record) {
+    bool wake;
+    uint64_t sequence;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        const size_t framed = record.size() + 8;
+        space_.wait(lock, [&] { return pending_.empty() || pending_.size() + framed <= max_pending_bytes || stopping_; });
+        wake = pending_.empty();
+        frameRecord(pending_, record);
+        ++pending_records_;
+        sequence = ++appended_;
+        wake = wake || pending_.size() >= max_pending_bytes;
+    }
+    if (wake) {
+        condition_.notify_one();
+    }
+    return sequence;
+}
+
+/**
+ * @brief Waits until the commit holding a record has finished.
+ * @param sequence Sequence number returned by append().
+ * @return False if that commit failed.
+ */
+bool WriteAheadLog::waitFor(uint64_t sequence) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    committed_condition_.wait(lock, [&] { return committed_ >= sequence; });
+    for (const auto& [first, last] : failed_) {
+        if (sequence >= first && sequence <= last) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Commits pending records to the current segment and starts the next one.
+ *
+ * The new segment is created before the current one is closed, so a failure
+ * (a full disk, a missing directory) leaves the log appending where it was.
+ * @param segment Set to the number of the new segment.
+ * @return False if the new segment could not be created.
+ */
+bool WriteAheadLog::rotate(uint64_t& segment) {
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    commitPending();
+    const uint64_t next = segment_.load(std::memory_order_relaxed) + 1;
+    const int previous = fd_;
+    if (!openSegment(next)) {
+        return false;
+    }
+    closeDescriptor(previous);
+    damaged_ = false;
+    segment = next;
+    return true;
+}
+
+/**
+ * @brief Writes and syncs pending records now.
+ */
+void WriteAheadLog::flush() {
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    commitPending();
+}
+
+/**
+ * @brief Returns the path of a segment file.
+ * @param directory Directory holding the segments.
+ * @param segment Segment number.
+ */
+std::string WriteAheadLog::segmentPath(const std::string& directory, uint64_t segment) {
+    char name[40];
+    std::snprintf(name, sizeof(name), "wal-%020" PRIu64 ".log", segment);
+    return directory + "/" + name;
+}
+
+/**
+ * @brief Parses a segment number from a file name of the form wal-<number>.log.
+ * @param file_name File name without directory.
+ * @param segment Output segment number.
+ * @return False if the name is not a segment name.
+ */
+bool WriteAheadLog::parseSegmentName(const std::string& file_name, uint64_t& segment) {
+    const std::string prefix = "wal-", suffix = ".log";
+    if (file_name.size() <= prefix.size() + suffix.size() ||
+        file_name.compare(0, prefix.size(), prefix) != 0 ||
+        file_name.compare(file_name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = prefix.size(); i < file_name.size() - suffix.size(); ++i) {
+        const char c = file_name[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    segment = value;
+    return true;
+}
+
+/**
+ * @brief Reads every intact record of a segment file, in order.
+ *
+ * Reading stops at the first record that is truncated, longer than
+ * max_record_length or fails its checksum: everything before it was committed
+ * whole, and nothing after it can be trusted.
+ * @param path Segment file.
+ * @param apply Called with each record payload.
+ * @param torn Set to true if reading stopped early.
+ * @return Number of records read.
+ */
+size_t WriteAheadLog::replay(const std::string& path, const std::function<void(std::string_view)>& apply, bool& torn) {
+    torn = false;
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        torn = true;
+        return 0;
+    }
+
+    size_t count = 0;
+    std::string payload;
+    unsigned char header[8];
+    for (;;) {
+        const size_t header_read = std::fread(header, 1, sizeof(header), file);
+        if (header_read == 0) {
+            break;
+        }
+        const uint32_t length = readUint32(header);
+        if (header_read < sizeof(header) || length > max_record_length) {
+            torn = true;
+            break;
+        }
+        payload.resize(length);
+        if (length > 0 && std::fread(&payload[0], 1, length, file) != length) {
+            torn = true;
+            break;
+        }
+        if (checksum(payload.data(), payload.size()) != readUint32(header + 4)) {
+            torn = true;
+            break;
+        }
+        apply(payload);
+        ++count;
+    }
+    std::fclose(file);
+    return count;
+}
+
+/**
+ * @brief Replaces a file durably.
+ *
+ * The data goes to path + ".tmp", which is synced and renamed over path; the
+ * directory is synced too (where the platform allows), so the rename itself
+ * survives a crash.
+ * @param path File to replace.
+ * @param data New contents.
+ * @return False if any step failed (the temporary file is removed).
+ */
+bool WriteAheadLog::replaceFile(const std::string& path, std::string_view data) {
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    const bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size() && syncFile(file);
+    std::fclose(file);
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    syncDirectory(path);
+    return true;
+}
+
+/**
+ * @brief Syncs the directory holding a file (POSIX only).
+ * @param path File whose directory is synced.
+ */
+void WriteAheadLog::syncDirectory(const std::string& path) {
+#ifndef _WIN32
+    const size_t slash = path.find_last_of('/');
+    const std::string directory = slash == std::string::npos ? "." : path.substr(0, slash);
+    const int directory_fd = open(directory.c_str(), O_RDONLY);
+    if (directory_fd >= 0) {
+        fsync(directory_fd);
+        close(directory_fd);
+    }
+#else
+    (void)path;
+#endif
+}
+
+/**
+ * @brief Appends a record to a buffer with the framing replay() reads.
+ * @param out Buffer to append to.
+ * @param record Record payload.
+ */
+void WriteAheadLog::frameRecord(std::string& out, std::string_view record) {
+    appendUint32(out, static_cast<uint32_t>(record.size()));
+    appendUint32(out, checksum(record.data(), record.size()));
+    out.append(record.data(), record.size());
+}
+
+/**
+ * @brief Computes the CRC-32 (IEEE 802.3, reflected) of a byte range.
+ */
+uint32_t WriteAheadLog::checksum(const void* data, size_t length) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> entries{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+            }
+            entries[i] = crc;
+        }
+        return entries;
+    }();
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+//==============================================================================
+// PRIVATE METHODS
+//==============================================================================
+
+/**
+ * @brief Committer loop.
+ *
+ * Sleeps until a record arrives, lets the batch gather for one commit interval
+ * (or until it is full or shutdown), then commits it with a single write and sync.
+ */
+void WriteAheadLog::run() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            condition_.wait_for(lock, commit_interval_,
+                [this] { return stopping_ || pending_.size() >= max_pending_bytes; });
+        }
+        std::lock_guard<std::mutex> io_lock(io_mutex_);
+        commitPending();
+    }
+}
+
+/**
+ * @brief Moves the pending batch out and writes and syncs it.
+ *
+ * Appenders blocked on a full batch are released as soon as it is moved out;
+ * waitFor() callers once it is on disk (or has failed).
+ */
+void WriteAheadLog::commitPending() {
+    uint64_t record_count;
+    uint64_t last;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty()) {
+            return;
+        }
+        batch_.swap(pending_);
+        pending_.clear();
+        record_count = pending_records_;
+        pending_records_ = 0;
+        last = appended_;
+    }
+    space_.notify_all();
+
+    // Nothing is written behind a torn tail: replay could never reach it
+    const bool written = (!damaged_ || repairTail()) &&
+        writeAll(fd_, batch_.data(), batch_.size()) && syncDescriptor(fd_);
+    if (!written) {
+        errors_.fetch_add(1, std::memory_order_relaxed);
+        LOG_ERROR("Write-ahead log commit of %zu bytes to segment %llu failed", batch_.size(),
+            static_cast<unsigned long long>(segment_.load(std::memory_order_relaxed)));
+        damaged_ = true;
+        repairTail();
+    }
+    else {
+        committed_bytes_ += batch_.size();
+        records_.fetch_add(record_count, std::memory_order_relaxed);
+        bytes_.fetch_add(batch_.size(), std::memory_order_relaxed);
+        commits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    batch_.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        committed_ = last;
+        if (!written) {
+            // Waiters are woken right away; a short history is enough for them to see the failure
+            failed_.emplace_back(last - record_count + 1, last);
+            if (failed_.size() > 64) {
+                failed_.pop_front();
+            }
+        }
+    }
+    committed_condition_.notify_all();
+}
+
+/**
+ * @brief Removes what a failed commit left behind.
+ *
+ * A failed write or sync can leave part of the batch in the file (or in the
+ * page cache, to be written later). Cutting the file back to the last commit
+ * that succeeded drops it; if the file cannot be cut, the log continues in a
+ * fresh segment, and replay reads the damaged one only up to its torn tail.
+ * @return False if neither worked.
+ */
+bool WriteAheadLog::repairTail() {
+    if (truncateDescriptor(fd_, committed_bytes_)) {
+        damaged_ = false;
+        return true;
+    }
+    const uint64_t current = segment_.load(std::memory_order_relaxed);
+    const int previous = fd_;
+    if (openSegment(current + 1)) {
+        closeDescriptor(previous);
+        damaged_ = false;
+        LOG_WARN("Cannot truncate write-ahead log segment %llu after a failed commit; continuing in segment %llu",
+            static_cast<unsigned long long>(current), static_cast<unsigned long long>(current + 1));
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Creates a segment file and makes it current.
+ * @param segment Segment number.
+ * @return False if the file cannot be created (fd_ and segment_ are unchanged).
+ */
+bool WriteAheadLog::openSegment(uint64_t segment) {
+    const int fd = openForAppend(segmentPath(directory_, segment));
+    if (fd < 0) {
+        return false;
+    }
+    const int64_t size = descriptorSize(fd);
+    if (size < 0) {
+        closeDescriptor(fd);
+        return false;
+    }
+    fd_ = fd;
+    committed_bytes_ = static_cast<uint64_t>(size);
+    segment_.store(segment, std::memory_order_relaxed);
+    return true;
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/// @brief Append-only, group-committed log of opaque records, split into numbered segment files.
+///
+/// append() copies a record into an in-memory batch and returns its sequence
+/// number; a committer thread writes the batch and syncs it to disk at most once
+/// per commit interval, so concurrent writers share one fsync. A writer that
+/// must not acknowledge before its record is on disk passes the sequence number
+/// to waitFor(). append() blocks while max_pending_bytes are waiting to be
+/// committed, so a stalled disk slows writers down instead of growing the batch
+/// without bound. Each record is framed
+/// as a 4-byte length and a 4-byte CRC-32 followed by the payload (little-endian),
+/// so replay stops cleanly at a torn or corrupt tail. A commit that fails is cut
+/// off again (or, failing that, the log moves to a new segment), so the records
+/// committed after it stay reachable. Segments are named
+/// wal-<number>.log; rotate() moves on to the next number so that older segments
+/// can be deleted once a snapshot covers them.
+class WriteAheadLog {
+public:
+    /// @brief Largest record accepted by replay (anything larger is treated as corruption).
+    static constexpr uint32_t max_record_length = 64 * 1024 * 1024;
+
+    /// @brief Framed bytes allowed to wait for a commit before append() blocks.
+    static constexpr size_t max_pending_bytes = 64 * 1024 * 1024;
+
+    /// @brief Start a new segment in a directory and the committer thread.
+    /// @param directory Directory holding the segments (must exist).
+    /// @param segment Number of the segment to create.
+    /// @param commit_interval Longest time a record waits before it is written and synced.
+    /// @throws std::runtime_error if the segment file cannot be created.
+    WriteAheadLog(std::string directory, uint64_t segment, std::chrono::milliseconds commit_interval);
+
+    /// @brief Commit pending records and stop the committer thread.
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /// @brief Queue one record for the next group commit (blocks while max_pending_bytes are queued).
+    /// @param record Record payload.
+    /// @return Sequence number of the record, for waitFor().
+    uint64_t append(std::string_view record);
+
+    /// @brief Wait until the commit holding a record has finished.
+    /// @param sequence Sequence number returned by append().
+    /// @return False if that commit failed, so the record is not on disk.
+    bool waitFor(uint64_t sequence);
+
+    /// @brief Commit pending records to the current segment, then start the next one.
+    /// @param segment Set to the number of the new segment; every record appended before the call is in an older one.
+    /// @return False if the new segment could not be created (appending continues in the current one).
+    bool rotate(uint64_t& segment);
+
+    /// @brief Write and sync pending records now.
+    void flush();
+
+    /// @brief Number of the segment being appended to.
+    uint64_t segment() const { return segment_.load(std::memory_order_relaxed); }
+    /// @brief Records committed since startup.
+    uint64_t records() const { return records_.load(std::memory_order_relaxed); }
+    /// @brief Bytes committed since startup, framing included.
+    uint64_t bytes() const { return bytes_.load(std::memory_order_relaxed); }
+    /// @brief Group commits (write + sync) since startup.
+    uint64_t commits() const { return commits_.load(std::memory_order_relaxed); }
+    /// @brief Failed writes or syncs since startup.
+    uint64_t errors() const { return errors_.load(std::memory_order_relaxed); }
+
+    /// @brief Path of a segment file.
+    static std::string segmentPath(const std::string& directory, uint64_t segment);
+
+    /// @brief Parse a segment number from a file name of the form wal-<number>.log.
+    /// @return False if the name is not a segment name.
+    static bool parseSegmentName(const std::string& file_name, uint64_t& segment);
+
+    /// @brief Read every intact record of a segment file, in order.
+    /// @param path Segment file.
+    /// @param apply Called with each record payload.
+    /// @param torn Set to true if reading stopped at a truncated or corrupt record.
+    /// @return Number of records read.
+    static size_t replay(const std::string& path, const std::function<void(std::string_view)>& apply, bool& torn);
+
+    /// @brief Replace a file durably: write a temporary file, sync it, rename it over path and sync the directory.
+    ///
+    /// A crash leaves either the old file or the complete new one.
+    /// @return False if any step failed (the temporary file is removed).
+    static bool replaceFile(const std::string& path, std::string_view data);
+
+    /// @brief Sync the directory holding a file, so a rename into it survives a crash (no-op where unsupported).
+    static void syncDirectory(const std::string& path);
+
+    /// @brief Append a record to a buffer with the framing replay() reads (length, CRC-32, payload).
+    static void frameRecord(std::string& out, std::string_view record);
+
+    /// @brief CRC-32 (IEEE 802.3) of a byte range.
+    static uint32_t checksum(const void* data, size_t length);
+
+private:
+    /// @brief Committer loop: gather a batch for one commit interval, then commit it.
+    void run();
+
+    /// @brief Move the pending batch out and write and sync it.
+    /// @note Caller holds io_mutex_, which keeps batches in append order.
+    void commitPending();
+
+    /// @brief Remove what a failed commit left behind, so the next record follows the last intact one.
+    ///
+    /// Truncates the segment back to committed_bytes_; if that fails, moves on to a new segment.
+    /// @note Caller holds io_mutex_.
+    /// @return False if neither worked (damaged_ stays set and the next commit tries again).
+    bool repairTail();
+
+    /// @brief Create a segment file and make it current.
+    /// @note Caller holds io_mutex_ (or is the constructor).
+    /// @return False if the file cannot be created (the current segment is left in place).
+    bool openSegment(uint64_t segment);
+
+    /// @brief Directory holding the segments.
+    std::string directory_;
+    /// @brief Longest time a record waits before it is committed.
+    std::chrono::milliseconds commit_interval_;
+
+    /// @brief Guards pending_, pending_records_, stopping_ and the sequence numbers.
+    std::mutex mutex_;
+    /// @brief Wakes the committer when records arrive, when pending_ is full or on shutdown.
+    std::condition_variable condition_;
+    /// @brief Wakes appenders blocked on a full pending_.
+    std::condition_variable space_;
+    /// @brief Wakes waitFor() callers when a commit finishes.
+    std::condition_variable committed_condition_;
+    /// @brief Framed records waiting for the next commit.
+    std::string pending_;
+    /// @brief Number of records in pending_.
+    uint64_t pending_records_ = 0;
+    /// @brief Set to stop the committer.
+    bool stopping_ = false;
+    /// @brief Sequence number of the last record appended.
+    uint64_t appended_ = 0;
+    /// @brief Sequence number of the last record whose commit has finished (successfully or not).
+    uint64_t committed_ = 0;
+    /// @brief Sequence ranges (first, last) of recent failed commits, oldest first.
+    std::deque<std::pair<uint64_t, uint64_t>> failed_;
+
+    /// @brief Serializes commits and rotation (taken before mutex_).
+    std::mutex io_mutex_;
+    /// @brief Current segment file descriptor (opened for appending).
+    int fd_ = -1;
+    /// @brief Size of the current segment after its last successful commit.
+    uint64_t committed_bytes_ = 0;
+    /// @brief Set after a failed commit until repairTail() succeeds.
+    bool damaged_ = false;
+    /// @brief Batch being written (reused between commits).
+    std::string batch_;
+
+    /// @brief Number of the current segment.
+    std::atomic<uint64_t> segment_{ 0 };
+    /// @brief Records committed.
+    std::atomic<uint64_t> records_{ 0 };
+    /// @brief Bytes committed.
+    std::atomic<uint64_t> bytes_{ 0 };
+    /// @brief Group commits.
+    std::atomic<uint64_t> commits_{ 0 };
+    /// @brief Failed writes or syncs.
+    std::atomic<uint64_t> errors_{ 0 };
+
+    /// @brief Committer thread.
+    std::thread committer_;
+};
@@ -5,8 +5,9 @@ int main() {
     std::cout << "Starting OpenTelemetry IoT Metrics Server..." << std::endl;
 
     try {
-        // Create server instance (API on port 8080, Prometheus on port 9090)
-        IoTMetricsServer server(8080, 9090);
+        // Create server instance (API on port 8080, Prometheus on port 9090,
+        // binary ingestion on TCP port 8090, StatsD on UDP port 8125)
+        IoTMetricsServer server(8080, 9090, 8090, 8125);
 
         std::cout << "Server initialized successfully!" << std::endl;
         std::cout << "Starting server (this will block)..." << std::endl;
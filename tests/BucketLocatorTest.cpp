@@ -0,0 +1,101 @@
+#include "TestSupport.h"
+#include "BucketLocator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Reference bucket: the first boundary the value is less than or equal to (NaN goes to +Inf).
+ */
+size_t referenceBucket(double value, const std::vector<double>& boundaries) {
+    if (std::isnan(value)) {
+        return boundaries.size();
+    }
+    return static_cast<size_t>(std::lower_bound(boundaries.begin(), boundaries.end(), value) - boundaries.begin());
+}
+
+/**
+ * @brief Checks locate() and binMany() against the reference for a set of values.
+ */
+void checkAgainstReference(const std::vector<double>& boundaries, const std::vector<double>& values) {
+    std::vector<uint64_t> expected(boundaries.size() + 1, 0);
+    for (double value : values) {
+        const size_t reference = referenceBucket(value, boundaries);
+        const size_t located = BucketLocator::locate(value, boundaries.data(), boundaries.size());
+        CHECK(located == reference);
+        if (located != reference) {
+            std::fprintf(stderr, "  value %.17g among %zu boundaries: got %zu, expected %zu\n",
+                value, boundaries.size(), located, reference);
+        }
+        ++expected[reference];
+    }
+
+    std::vector<uint64_t> counts(boundaries.size() + 1, 0);
+    BucketLocator::binMany(values.data(), values.size(), boundaries.data(), boundaries.size(), counts.data());
+    CHECK(counts == expected);
+}
+
+/**
+ * @brief Edge values: on a boundary, between, outside, infinities, signed zeros and NaN.
+ */
+void testEdgeValues() {
+    const double infinity = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    const std::vector<double> boundaries = { -10, -1, 0, 0.5, 1, 5, 10, 25, 50, 100 };
+    std::vector<double> values = { -infinity, -1e300, -10.5, 0.0, -0.0, 1e-300, 0.25, 99.999, 100.0001, 1e300, infinity, nan };
+    for (double boundary : boundaries) {
+        values.push_back(boundary);
+        values.push_back(std::nextafter(boundary, -infinity));
+        values.push_back(std::nextafter(boundary, infinity));
+    }
+    checkAgainstReference(boundaries, values);
+
+    // Fewer boundaries than one vector holds, and none at all
+    for (size_t count = 0; count < 4; ++count) {
+        checkAgainstReference(std::vector<double>(boundaries.begin(), boundaries.begin() + count), values);
+    }
+
+    // Repeated boundaries: the value belongs to the first of them
+    checkAgainstReference({ 1, 1, 1, 2, 2, 3 }, { 0, 1, 1.5, 2, 2.5, 3, 4, nan });
+}
+
+/**
+ * @brief Random sorted boundary sets of every length up to past the vector tails.
+ */
+void testRandomBoundaries() {
+    std::mt19937_64 random(2024);
+    std::normal_distribution<double> distribution(0.0, 100.0);
+    for (size_t count = 0; count <= 70; ++count) {
+        std::vector<double> boundaries(count);
+        for (double& boundary : boundaries) {
+            boundary = std::round(distribution(random));
+        }
+        std::sort(boundaries.begin(), boundaries.end());
+
+        std::vector<double> values;
+        for (int i = 0; i < 500; ++i) {
+            values.push_back(distribution(random) * 1.5);
+        }
+        for (double boundary : boundaries) {
+            values.push_back(boundary);
+        }
+        checkAgainstReference(boundaries, values);
+    }
+}
+
+} // namespace
+
+int main() {
+    // CTest runs this once per kernel through IOT_METRICS_BUCKET_KERNEL; each is checked against the reference
+    const char* requested = std::getenv("IOT_METRICS_BUCKET_KERNEL");
+    std::printf("BucketLocatorTest: kernel %s (requested %s)\n", BucketLocator::kernelName(),
+        requested ? requested : "widest supported");
+    testEdgeValues();
+    testRandomBoundaries();
+    return testResult("BucketLocatorTest");
+}
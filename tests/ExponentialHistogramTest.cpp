@@ -0,0 +1,238 @@
+#include "TestSupport.h"
+#include "ExponentialHistogram.h"
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Checks that a value lies in (base^index, base^(index + 1)] with base = 2^(2^-scale).
+ *
+ * Bounds are computed in long double; a bound within rounding distance of the
+ * value is accepted on either side.
+ */
+bool inBucket(double value, int32_t index, int32_t scale) {
+    const long double exponent_step = std::ldexp(1.0L, -scale);
+    const long double lower = std::exp2(static_cast<long double>(index) * exponent_step);
+    const long double upper = std::exp2(static_cast<long double>(index + 1) * exponent_step);
+    const long double slack = 1e-12L * value;
+    return value > lower - slack && value <= upper + slack;
+}
+
+/**
+ * @brief Bucket indexes at known points, including exact powers of two on a bucket's upper bound.
+ */
+void testKnownIndexes() {
+    // Scale 0: buckets are (2^i, 2^(i+1)]
+    CHECK(ExponentialHistogram::mapToIndex(1.0, 0) == -1);
+    CHECK(ExponentialHistogram::mapToIndex(1.5, 0) == 0);
+    CHECK(ExponentialHistogram::mapToIndex(2.0, 0) == 0);
+    CHECK(ExponentialHistogram::mapToIndex(3.0, 0) == 1);
+    CHECK(ExponentialHistogram::mapToIndex(4.0, 0) == 1);
+    CHECK(ExponentialHistogram::mapToIndex(0.5, 0) == -2);
+
+    // Scale 1: base sqrt(2)
+    CHECK(ExponentialHistogram::mapToIndex(2.0, 1) == 1);
+    CHECK(ExponentialHistogram::mapToIndex(1.0, 1) == -1);
+    CHECK(ExponentialHistogram::mapToIndex(1.4, 1) == 0);
+    CHECK(ExponentialHistogram::mapToIndex(1.5, 1) == 1);
+
+    // Negative scales: base 4 at -1, 16 at -2
+    CHECK(ExponentialHistogram::mapToIndex(4.0, -1) == 0);
+    CHECK(ExponentialHistogram::mapToIndex(5.0, -1) == 1);
+    CHECK(ExponentialHistogram::mapToIndex(1.0, -1) == -1);
+    CHECK(ExponentialHistogram::mapToIndex(16.0, -2) == 0);
+    CHECK(ExponentialHistogram::mapToIndex(17.0, -2) == 1);
+
+    // The extremes of the double range stay inside the index range at every scale
+    const double smallest = std::numeric_limits<double>::denorm_min();
+    const double largest = std::numeric_limits<double>::max();
+    CHECK(ExponentialHistogram::mapToIndex(smallest, 0) == -1075);
+    CHECK(ExponentialHistogram::mapToIndex(largest, 0) == 1023);
+    CHECK(ExponentialHistogram::mapToIndex(smallest, ExponentialHistogram::min_scale) == -68);
+    CHECK(ExponentialHistogram::mapToIndex(largest, ExponentialHistogram::min_scale) == 63);
+}
+
+/**
+ * @brief Random values land in their bucket at every scale, and coarser indexes are the finer ones shifted.
+ */
+void testIndexMapping() {
+    std::mt19937_64 random(7);
+    std::uniform_real_distribution<double> exponent(-300.0, 300.0);
+    for (int i = 0; i < 20000; ++i) {
+        const double value = std::pow(10.0, exponent(random));
+        int32_t previous = 0;
+        for (int32_t scale = ExponentialHistogram::max_scale; scale >= ExponentialHistogram::min_scale; --scale) {
+            const int32_t index = ExponentialHistogram::mapToIndex(value, scale);
+            CHECK(inBucket(value, index, scale));
+            if (scale < ExponentialHistogram::max_scale) {
+                // floor(previous / 2) for either sign
+                CHECK(index == (previous >= 0 ? previous / 2 : -((-previous + 1) / 2)));
+            }
+            previous = index;
+        }
+    }
+
+    // Exact powers of two sit on an upper bound at every scale
+    for (int exponent_value = -1074; exponent_value <= 1023; exponent_value += 7) {
+        const double value = std::ldexp(1.0, exponent_value);
+        for (int32_t scale = ExponentialHistogram::min_scale; scale <= ExponentialHistogram::max_scale; ++scale) {
+            const int32_t index = ExponentialHistogram::mapToIndex(value, scale);
+            if (scale >= 0) {
+                CHECK(index == exponent_value * (int32_t{ 1 } << scale) - 1);
+            }
+            CHECK(inBucket(value, index, scale));
+        }
+    }
+}
+
+/**
+ * @brief downscale() merges counts into the coarser buckets without losing any.
+ */
+void testDownscale() {
+    ExponentialHistogram::Buckets source;
+    source.offset = -5;
+    source.counts = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };  // indexes -5 .. 4
+
+    ExponentialHistogram::Buckets target;
+    ExponentialHistogram::downscale(source, 1, target);
+    CHECK(target.offset == -3);
+    CHECK((target.counts == std::vector<uint64_t>{ 1, 5, 9, 13, 17, 10 }));
+
+    ExponentialHistogram::downscale(source, 3, target);
+    CHECK(target.offset == -1);
+    CHECK((target.counts == std::vector<uint64_t>{ 15, 40 }));
+
+    ExponentialHistogram::downscale(source, 0, target);
+    CHECK(target.offset == source.offset && target.counts == source.counts);
+
+    ExponentialHistogram::downscale(ExponentialHistogram::Buckets(), 2, target);
+    CHECK(target.counts.empty());
+}
+
+/**
+ * @brief Recording a wide range downscales just enough to fit, keeping every observation in its bucket.
+ */
+void testRecordDownscales() {
+    ExponentialHistogram histogram(20);
+    CHECK(histogram.scale() == ExponentialHistogram::max_scale);
+    std::vector<double> values = { 1.0, 1.5, 100.0, 1e6, 0.001, 0.0, -2.0, -1e-3, 3.0, 7.0 };
+    for (double value : values) {
+        histogram.record(value);
+    }
+    CHECK(histogram.count() == values.size());
+    CHECK(histogram.zeroCount() == 1);
+    CHECK(histogram.min() == -2.0);
+    CHECK(histogram.max() == 1e6);
+    CHECK(histogram.sum() == std::accumulate(values.begin(), values.end(), 0.0));
+    CHECK(histogram.positive().counts.size() <= 20);
+    CHECK(histogram.negative().counts.size() <= 20);
+
+    // One step finer would not fit the positive range in 20 buckets
+    const int32_t scale = histogram.scale();
+    CHECK(ExponentialHistogram::mapToIndex(1e6, scale + 1) - ExponentialHistogram::mapToIndex(0.001, scale + 1) + 1 > 20);
+
+    uint64_t positive = 0;
+    for (double value : values) {
+        if (value > 0.0) {
+            const int32_t index = ExponentialHistogram::mapToIndex(value, scale);
+            const auto& buckets = histogram.positive();
+            CHECK(index >= buckets.offset && index < buckets.offset + static_cast<int32_t>(buckets.counts.size()));
+            ++positive;
+        }
+    }
+    const auto& counts = histogram.positive().counts;
+    CHECK(std::accumulate(counts.begin(), counts.end(), uint64_t{ 0 }) == positive);
+}
+
+/**
+ * @brief The scale never drops below min_scale, even when the range cannot fit.
+ */
+void testMinimumScale() {
+    ExponentialHistogram histogram(2);
+    histogram.record(std::numeric_limits<double>::denorm_min());
+    histogram.record(std::numeric_limits<double>::max());
+    histogram.record(1.0);
+    CHECK(histogram.scale() == ExponentialHistogram::min_scale);
+    CHECK(histogram.count() == 3);
+    const auto& counts = histogram.positive().counts;
+    CHECK(std::accumulate(counts.begin(), counts.end(), uint64_t{ 0 }) == 3);
+
+    // At the default size the whole double range fits once min_scale is reached
+    ExponentialHistogram wide;
+    wide.record(std::numeric_limits<double>::denorm_min());
+    wide.record(std::numeric_limits<double>::max());
+    CHECK(wide.scale() == ExponentialHistogram::min_scale);
+    CHECK(wide.positive().counts.size() <= ExponentialHistogram::default_max_size);
+    CHECK(wide.positive().counts.front() == 1 && wide.positive().counts.back() == 1);
+}
+
+/**
+ * @brief Classic buckets at power-of-two bounds are cumulative and end at the total count.
+ */
+void testClassicBuckets() {
+    ExponentialHistogram histogram;
+    for (double value : { 0.3, 1.0, 2.0, 3.0, 1000.0, 0.0, -4.0 }) {
+        histogram.record(value);
+    }
+    std::vector<ExponentialHistogram::ClassicBucket> buckets;
+    histogram.classicBuckets(buckets);
+    CHECK(!buckets.empty());
+    for (size_t i = 1; i < buckets.size(); ++i) {
+        CHECK(buckets[i].upper_bound > buckets[i - 1].upper_bound);
+        CHECK(buckets[i].cumulative_count >= buckets[i - 1].cumulative_count);
+    }
+    for (const auto& bucket : buckets) {
+        if (bucket.upper_bound == 0.0) {
+            CHECK(bucket.cumulative_count == 2);
+        }
+        if (bucket.upper_bound == 2.0) {
+            CHECK(bucket.cumulative_count == 5);
+        }
+        if (bucket.upper_bound == 1024.0) {
+            CHECK(bucket.cumulative_count == 7);
+        }
+    }
+    CHECK(buckets.back().cumulative_count == histogram.count());
+}
+
+/**
+ * @brief restore() takes a saved state and refuses one that does not fit.
+ */
+void testRestore() {
+    ExponentialHistogram source;
+    for (double value : { 0.5, 2.0, 8.0, -1.0 }) {
+        source.record(value);
+    }
+    ExponentialHistogram copy;
+    CHECK(copy.restore(source.scale(), source.count(), source.sum(), source.min(), source.max(),
+        source.zeroCount(), source.positive(), source.negative()));
+    CHECK(copy.scale() == source.scale());
+    CHECK(copy.positive().counts == source.positive().counts);
+    copy.record(4.0);
+    CHECK(copy.count() == 5);
+
+    ExponentialHistogram small(2);
+    ExponentialHistogram::Buckets three;
+    three.counts = { 1, 1, 1 };
+    CHECK(!small.restore(0, 3, 3.0, 1.0, 1.0, 0, three, {}));
+    CHECK(!small.restore(ExponentialHistogram::min_scale - 1, 0, 0.0, 0.0, 0.0, 0, {}, {}));
+    CHECK(!small.restore(ExponentialHistogram::max_scale + 1, 0, 0.0, 0.0, 0.0, 0, {}, {}));
+    CHECK(small.count() == 0);
+}
+
+} // namespace
+
+int main() {
+    testKnownIndexes();
+    testIndexMapping();
+    testDownscale();
+    testRecordDownscales();
+    testMinimumScale();
+    testClassicBuckets();
+    testRestore();
+    return testResult("ExponentialHistogramTest");
+}
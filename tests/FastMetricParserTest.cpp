@@ -0,0 +1,181 @@
+#include "TestSupport.h"
+#include "FastMetricParser.h"
+#include <nlohmann/json.hpp>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+/**
+ * @brief Checks that a document the fast parser accepted reads the same through nlohmann::json.
+ */
+void checkMatchesDom(const std::string& text, const MetricPointView& view) {
+    const json dom = json::parse(text, nullptr, false);
+    CHECK(!dom.is_discarded());
+    if (dom.is_discarded()) {
+        std::fprintf(stderr, "  accepted by the fast parser only: %s\n", text.c_str());
+        return;
+    }
+
+    CHECK(view.has_metric_name == dom.contains("metric_name"));
+    if (view.has_metric_name) {
+        CHECK(view.metric_name == dom["metric_name"].get<std::string>());
+    }
+    CHECK(view.has_instrument_type == dom.contains("instrument_type"));
+    if (view.has_instrument_type) {
+        CHECK(view.instrument_type == dom["instrument_type"].get<std::string>());
+    }
+    CHECK(view.has_value == dom.contains("value"));
+    if (view.has_value) {
+        CHECK(view.value == dom["value"].get<double>());
+    }
+    CHECK(view.unit == dom.value("unit", std::string()));
+    CHECK(view.description == dom.value("description", std::string()));
+
+    CHECK(view.has_boundaries == dom.contains("boundaries"));
+    if (view.has_boundaries) {
+        const std::vector<double> boundaries = dom["boundaries"].get<std::vector<double>>();
+        CHECK(view.boundaries == boundaries);
+    }
+
+    // The view keeps duplicates in order; downstream the last one wins, as in the DOM
+    std::map<std::string, std::string> attributes;
+    for (const auto& [key, value] : view.attributes) {
+        attributes[std::string(key)] = std::string(value);
+    }
+    const std::map<std::string, std::string> dom_attributes = dom.contains("attributes") ?
+        dom["attributes"].get<std::map<std::string, std::string>>() : std::map<std::string, std::string>();
+    CHECK(attributes == dom_attributes);
+}
+
+/**
+ * @brief Documents within the fixed schema are parsed exactly as the DOM reads them.
+ */
+void testAcceptedDocuments() {
+    const std::vector<std::string> documents = {
+        R"({"metric_name":"cpu","instrument_type":"gauge","value":0.5})",
+        R"( { "metric_name" : "cpu" , "instrument_type" : "gauge" , "value" : -12.25e-3 } )",
+        R"({"metric_name":"requests","instrument_type":"counter","value":3,"unit":"1","description":"Served requests"})",
+        R"({"metric_name":"latency","instrument_type":"histogram","value":12,"boundaries":[0,5,10.5,1e3]})",
+        R"({"metric_name":"latency","instrument_type":"histogram","value":12,"boundaries":[]})",
+        R"({"metric_name":"temp","instrument_type":"gauge","value":21,"attributes":{"room":"kitchen","floor":"1"}})",
+        R"({"metric_name":"temp","instrument_type":"gauge","value":21,"attributes":{}})",
+        R"({"value":1,"metric_name":"x","instrument_type":"counter"})",
+        R"({"metric_name":"x"})",
+        R"({})",
+        // Repeated keys: the last value wins, as in the DOM
+        R"({"metric_name":"first","metric_name":"second","instrument_type":"gauge","value":1,"value":2})",
+        R"({"metric_name":"h","instrument_type":"histogram","value":1,"boundaries":[1,2,3],"boundaries":[5]})",
+        R"({"metric_name":"g","instrument_type":"gauge","value":1,"attributes":{"a":"1"},"attributes":{"b":"2"}})",
+        R"({"metric_name":"g","instrument_type":"gauge","value":1,"attributes":{"a":"1","a":"2"}})",
+        // Valid UTF-8 of every length
+        "{\"metric_name\":\"caf\xC3\xA9\",\"instrument_type\":\"gauge\",\"value\":1,"
+        "\"attributes\":{\"unit\":\"\xE2\x82\xAC\",\"mood\":\"\xF0\x9F\x98\x80\"}}",
+    };
+    MetricPointView view;
+    for (const std::string& text : documents) {
+        const bool parsed = FastMetricParser::parseObject(text, view);
+        CHECK(parsed);
+        if (!parsed) {
+            std::fprintf(stderr, "  rejected by the fast parser: %s\n", text.c_str());
+            continue;
+        }
+        checkMatchesDom(text, view);
+    }
+}
+
+/**
+ * @brief Anything outside the fixed schema, and anything malformed, is left to the DOM.
+ */
+void testFallbackDocuments() {
+    const std::vector<std::string> documents = {
+        R"({"metric_name":"esc\"aped","instrument_type":"gauge","value":1})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1,"extra":true})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":"1"})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1,"attributes":{"n":1}})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1,"boundaries":[1,"2"]})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1,})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1} trailing)",
+        R"({"metric_name":"x","instrument_type":"gauge","value":01})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":1.})",
+        R"({"metric_name":"x","instrument_type":"gauge","value":NaN})",
+        R"({"metric_name":"x")",
+        "{\"metric_name\":\"tab\there\",\"instrument_type\":\"gauge\",\"value\":1}",
+        R"([{"metric_name":"x","instrument_type":"gauge","value":1}])",
+        "",
+    };
+    MetricPointView view;
+    for (const std::string& text : documents) {
+        const bool parsed = FastMetricParser::parseObject(text, view);
+        CHECK(!parsed);
+        if (parsed) {
+            std::fprintf(stderr, "  accepted by the fast parser: %s\n", text.c_str());
+        }
+    }
+}
+
+/**
+ * @brief Invalid UTF-8 is never accepted by the fast path (the DOM rejects it), valid UTF-8 always is.
+ */
+void testUtf8Parity() {
+    const std::vector<std::string> sequences = {
+        "\x80", "\xBF", "\xC0\x80", "\xC1\xBF", "\xC3", "\xE0\x80\x80", "\xE0\x9F\xBF", "\xE2\x82",
+        "\xED\xA0\x80", "\xED\xBF\xBF", "\xF0\x80\x80\x80", "\xF0\x8F\xBF\xBF", "\xF4\x90\x80\x80",
+        "\xF5\x80\x80\x80", "\xFF", "\xC3\xA9\x80",
+        "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF",
+    };
+    std::vector<std::string> cases(sequences);
+    std::mt19937 random(12345);
+    for (int i = 0; i < 20000; ++i) {
+        std::string bytes;
+        const int length = 1 + static_cast<int>(random() % 4);
+        for (int j = 0; j < length; ++j) {
+            bytes += static_cast<char>(0x80 + random() % 0x80);
+        }
+        cases.push_back(bytes);
+    }
+
+    MetricPointView view;
+    for (const std::string& bytes : cases) {
+        for (const std::string& text : {
+            "{\"metric_name\":\"m" + bytes + "\",\"instrument_type\":\"gauge\",\"value\":1}",
+            "{\"metric_name\":\"m\",\"instrument_type\":\"gauge\",\"value\":1,\"attributes\":{\"k\":\"" + bytes + "\"}}" }) {
+            const bool fast = FastMetricParser::parseObject(text, view);
+            const bool dom = !json::parse(text, nullptr, false).is_discarded();
+            CHECK(fast == dom);
+        }
+    }
+}
+
+/**
+ * @brief Batches parse element by element, with the same results as single objects.
+ */
+void testArrays() {
+    std::vector<MetricPointView> views;
+    CHECK(FastMetricParser::parseArray(
+        R"([{"metric_name":"a","instrument_type":"counter","value":1},
+            {"metric_name":"b","instrument_type":"gauge","value":2,"attributes":{"k":"v"}}])", views));
+    CHECK(views.size() == 2);
+    if (views.size() == 2) {
+        CHECK(views[0].metric_name == "a");
+        CHECK(views[1].attributes.size() == 1 && views[1].attributes[0].second == "v");
+    }
+    CHECK(FastMetricParser::parseArray("[]", views));
+    CHECK(views.empty());
+    CHECK(!FastMetricParser::parseArray(R"([{"metric_name":"a"},3])", views));
+    CHECK(!FastMetricParser::parseArray(R"({"metric_name":"a"})", views));
+}
+
+} // namespace
+
+int main() {
+    testAcceptedDocuments();
+    testFallbackDocuments();
+    testUtf8Parity();
+    testArrays();
+    return testResult("FastMetricParserTest");
+}
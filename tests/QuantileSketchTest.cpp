@@ -0,0 +1,184 @@
+#include "TestSupport.h"
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+/// @brief Quantiles checked against the exact ones.
+const double checked_quantiles[] = { 0.0, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 0.99, 0.999, 1.0 };
+
+/**
+ * @brief Checks every quantile of a sketch against the exact value of the same rank.
+ *
+ * The sketch reports the value of rank floor(q * (n - 1)); it must be within
+ * relative error a of it (plus rounding).
+ */
+void checkQuantiles(const QuantileSketch& sketch, std::vector<double> values, double relative_accuracy) {
+    std::sort(values.begin(), values.end());
+    for (double q : checked_quantiles) {
+        const double exact = values[static_cast<size_t>(q * static_cast<double>(values.size() - 1))];
+        const double estimate = sketch.quantile(q);
+        const double tolerance = relative_accuracy * std::fabs(exact) * (1.0 + 1e-9);
+        CHECK(std::fabs(estimate - exact) <= tolerance);
+        if (std::fabs(estimate - exact) > tolerance) {
+            std::fprintf(stderr, "  q=%g: estimate %.17g, exact %.17g\n", q, estimate, exact);
+        }
+    }
+}
+
+/**
+ * @brief Records values into a fresh sketch and checks its quantiles.
+ */
+void checkDistribution(const std::vector<double>& values, double relative_accuracy) {
+    QuantileSketch sketch(relative_accuracy);
+    for (double value : values) {
+        sketch.record(value);
+    }
+    CHECK(sketch.count() == values.size());
+    CHECK(sketch.min() == *std::min_element(values.begin(), values.end()));
+    CHECK(sketch.max() == *std::max_element(values.begin(), values.end()));
+    checkQuantiles(sketch, values, relative_accuracy);
+}
+
+/**
+ * @brief Quantiles stay within the relative accuracy on skewed, wide and mixed-sign data.
+ *
+ * Every data set fits in max_buckets at these accuracies, so nothing collapses.
+ */
+void testErrorBounds() {
+    std::mt19937_64 random(99);
+    std::lognormal_distribution<double> lognormal(0.0, 2.0);
+    std::uniform_real_distribution<double> uniform(-1000.0, 1000.0);
+    std::uniform_real_distribution<double> exponent(-7.0, 7.0);
+
+    std::vector<double> skewed, mixed, wide;
+    for (int i = 0; i < 50000; ++i) {
+        skewed.push_back(lognormal(random));
+        mixed.push_back(uniform(random));
+        wide.push_back(std::pow(10.0, exponent(random)));
+    }
+    for (double accuracy : { 0.01, 0.02, 0.05 }) {
+        checkDistribution(skewed, accuracy);
+        checkDistribution(mixed, accuracy);
+        checkDistribution(wide, accuracy);
+    }
+
+    // Zeros and tiny magnitudes share the zero bucket and are reported as 0
+    std::vector<double> with_zeros = { 0.0, 0.0, 0.0, 1e-320, -1e-320, 5.0, 10.0 };
+    QuantileSketch sketch;
+    for (double value : with_zeros) {
+        sketch.record(value);
+    }
+    CHECK(sketch.zeroCount() == 5);
+    CHECK(sketch.quantile(0.5) == 0.0);
+    CHECK(std::fabs(sketch.quantile(1.0) - 10.0) <= 0.01 * 10.0);
+}
+
+/**
+ * @brief Estimates never leave the observed range; an empty sketch has no quantiles.
+ */
+void testEdges() {
+    QuantileSketch empty;
+    CHECK(std::isnan(empty.quantile(0.5)));
+
+    QuantileSketch single;
+    single.record(3.7);
+    CHECK(single.quantile(0.0) == 3.7);
+    CHECK(single.quantile(0.5) == 3.7);
+    CHECK(single.quantile(1.0) == 3.7);
+
+    QuantileSketch pair;
+    pair.record(100.0);
+    pair.record(101.0);
+    CHECK(pair.quantile(0.0) >= 100.0);
+    CHECK(pair.quantile(1.0) <= 101.0);
+    CHECK(pair.quantile(-1.0) == pair.quantile(0.0));
+    CHECK(pair.quantile(2.0) == pair.quantile(1.0));
+}
+
+/**
+ * @brief Merging sketches gives the same buckets as recording everything into one.
+ */
+void testMerge() {
+    std::mt19937_64 random(5);
+    std::lognormal_distribution<double> lognormal(1.0, 1.5);
+    QuantileSketch first, second, combined;
+    std::vector<double> values;
+    for (int i = 0; i < 20000; ++i) {
+        const double value = (i % 3 == 0 ? -1.0 : 1.0) * lognormal(random);
+        values.push_back(value);
+        (i % 2 == 0 ? first : second).record(value);
+        combined.record(value);
+    }
+    CHECK(first.merge(second));
+    CHECK(first.count() == combined.count());
+    CHECK(first.positive().offset == combined.positive().offset);
+    CHECK(first.positive().counts == combined.positive().counts);
+    CHECK(first.negative().counts == combined.negative().counts);
+    CHECK(first.min() == combined.min() && first.max() == combined.max());
+    checkQuantiles(first, values, QuantileSketch::default_relative_accuracy);
+
+    QuantileSketch coarser(0.05);
+    CHECK(!first.merge(coarser));
+    CHECK(first.count() == combined.count());
+}
+
+/**
+ * @brief Past max_buckets the lowest buckets collapse; the upper quantiles keep their accuracy.
+ */
+void testCollapse() {
+    const size_t max_buckets = 64;
+    QuantileSketch sketch(0.01, max_buckets);
+    std::vector<double> values;
+    std::mt19937_64 random(11);
+    std::uniform_real_distribution<double> exponent(-6.0, 6.0);
+    for (int i = 0; i < 20000; ++i) {
+        values.push_back(std::pow(10.0, exponent(random)));
+        sketch.record(values.back());
+    }
+    CHECK(sketch.positive().counts.size() <= max_buckets);
+
+    std::sort(values.begin(), values.end());
+    for (double q : { 0.99, 0.999, 1.0 }) {
+        const double exact = values[static_cast<size_t>(q * static_cast<double>(values.size() - 1))];
+        CHECK(std::fabs(sketch.quantile(q) - exact) <= 0.01 * exact * (1.0 + 1e-9));
+    }
+    // Collapsed low buckets overestimate, but never past the observed range
+    CHECK(sketch.quantile(0.0) >= sketch.min());
+}
+
+/**
+ * @brief restore() reproduces a saved sketch and refuses a window wider than max_buckets.
+ */
+void testRestore() {
+    QuantileSketch source;
+    for (double value : { -3.0, 0.0, 1.0, 2.0, 1000.0 }) {
+        source.record(value);
+    }
+    QuantileSketch copy;
+    CHECK(copy.restore(source.count(), source.sum(), source.min(), source.max(), source.zeroCount(),
+        source.positive(), source.negative()));
+    for (double q : checked_quantiles) {
+        CHECK(copy.quantile(q) == source.quantile(q));
+    }
+
+    QuantileSketch small(0.01, 2);
+    QuantileSketch::Buckets three;
+    three.counts = { 1, 1, 1 };
+    CHECK(!small.restore(3, 3.0, 1.0, 1.0, 0, three, {}));
+    CHECK(small.count() == 0);
+}
+
+} // namespace
+
+int main() {
+    testErrorBounds();
+    testEdges();
+    testMerge();
+    testCollapse();
+    testRestore();
+    return testResult("QuantileSketchTest");
+}
@@ -0,0 +1,191 @@
+#include "TestSupport.h"
+#include "SlotStore.h"
+#include <fstream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Reopens a store and adopts every live slot, returning their values by identity.
+ */
+std::map<std::string, double> reopen(const std::string& directory, size_t capacity,
+    std::vector<SlotStore::Handle>& handles, std::shared_ptr<SlotStore>& store) {
+    std::map<std::string, double> values;
+    handles.clear();
+    store = SlotStore::open(directory, capacity);
+    store->recover([&](SlotStore::Handle& handle, uint8_t kind, std::string_view identity) {
+        values[std::string(identity) + "/" + std::to_string(kind)] = handle.load();
+        handles.push_back(std::move(handle));
+        return true;
+    });
+    return values;
+}
+
+/**
+ * @brief Values written through handles survive a restart; retired slots do not come back.
+ */
+void testRecover() {
+    TemporaryDirectory directory("slot-test");
+    {
+        auto store = SlotStore::open(directory.path(), 8);
+        CHECK(store->recover([](SlotStore::Handle&, uint8_t, std::string_view) { return true; }) == 0);
+        SlotStore::Handle a = store->allocate(1, "a");
+        SlotStore::Handle b = store->allocate(1, "b");
+        SlotStore::Handle c = store->allocate(2, "c");
+        CHECK(a && b && c);
+        CHECK(store->used() == 3);
+        a.add(1.5);
+        a.add(2.0);
+        b.store(7.0);
+        c.store(-3.0);
+        b.retire();
+    }
+
+    std::vector<SlotStore::Handle> handles;
+    std::shared_ptr<SlotStore> store;
+    const std::map<std::string, double> values = reopen(directory.path(), 8, handles, store);
+    CHECK(values.size() == 2);
+    CHECK(values.count("a/1") == 1 && values.at("a/1") == 3.5);
+    CHECK(values.count("c/2") == 1 && values.at("c/2") == -3.0);
+    CHECK(values.count("b/1") == 0);
+    CHECK(store->used() == 2);
+}
+
+/**
+ * @brief A slot that is freed and reallocated gets a new generation, so only its latest owner is recovered.
+ */
+void testGenerations() {
+    TemporaryDirectory directory("slot-test");
+    {
+        auto store = SlotStore::open(directory.path(), 1);
+        store->recover([](SlotStore::Handle&, uint8_t, std::string_view) { return true; });
+        uint32_t first_index;
+        {
+            SlotStore::Handle old_owner = store->allocate(1, "old");
+            CHECK(old_owner);
+            first_index = old_owner.index();
+            old_owner.store(42.0);
+        }
+        CHECK(store->used() == 0);
+        SlotStore::Handle new_owner = store->allocate(1, "new");
+        CHECK(new_owner);
+        CHECK(new_owner.index() == first_index);
+        CHECK(new_owner.load() == 0.0);
+        new_owner.store(5.0);
+    }
+
+    std::vector<SlotStore::Handle> handles;
+    std::shared_ptr<SlotStore> store;
+    const std::map<std::string, double> values = reopen(directory.path(), 1, handles, store);
+    CHECK(values.size() == 1);
+    CHECK(values.count("new/1") == 1 && values.at("new/1") == 5.0);
+}
+
+/**
+ * @brief Slots the caller declines at recovery are freed for good.
+ */
+void testDeclinedSlots() {
+    TemporaryDirectory directory("slot-test");
+    {
+        auto store = SlotStore::open(directory.path(), 4);
+        store->recover([](SlotStore::Handle&, uint8_t, std::string_view) { return true; });
+        SlotStore::Handle keep = store->allocate(1, "keep");
+        SlotStore::Handle drop = store->allocate(1, "drop");
+        keep.store(1.0);
+        drop.store(2.0);
+    }
+    {
+        auto store = SlotStore::open(directory.path(), 4);
+        std::vector<SlotStore::Handle> handles;
+        const size_t adopted = store->recover([&](SlotStore::Handle& handle, uint8_t, std::string_view identity) {
+            if (identity != "keep") {
+                return false;
+            }
+            handles.push_back(std::move(handle));
+            return true;
+        });
+        CHECK(adopted == 1);
+        CHECK(store->used() == 1);
+    }
+
+    std::vector<SlotStore::Handle> handles;
+    std::shared_ptr<SlotStore> store;
+    const std::map<std::string, double> values = reopen(directory.path(), 4, handles, store);
+    CHECK(values.size() == 1);
+    CHECK(values.count("keep/1") == 1);
+}
+
+/**
+ * @brief Allocation fails cleanly once every slot is held, and succeeds again when one is released.
+ */
+void testExhaustion() {
+    TemporaryDirectory directory("slot-test");
+    auto store = SlotStore::open(directory.path(), 2);
+    store->recover([](SlotStore::Handle&, uint8_t, std::string_view) { return true; });
+    SlotStore::Handle first = store->allocate(1, "first");
+    SlotStore::Handle second = store->allocate(1, "second");
+    CHECK(first && second);
+    CHECK(first.index() != second.index());
+
+    SlotStore::Handle third = store->allocate(1, "third");
+    CHECK(!third);
+    CHECK(store->exhausted() == 1);
+    CHECK(store->used() == 2);
+
+    first = SlotStore::Handle();
+    CHECK(store->used() == 1);
+    third = store->allocate(1, "third");
+    CHECK(third);
+    CHECK(store->exhausted() == 1);
+}
+
+/**
+ * @brief Reopening with a smaller capacity keeps the file's; a file that is not a slot file is refused.
+ */
+void testFileLayout() {
+    TemporaryDirectory directory("slot-test");
+    {
+        auto store = SlotStore::open(directory.path(), 16);
+        CHECK(store->capacity() == 16);
+    }
+    {
+        auto store = SlotStore::open(directory.path(), 4);
+        CHECK(store->capacity() == 16);
+    }
+    {
+        auto store = SlotStore::open(directory.path(), 32);
+        CHECK(store->capacity() == 32);
+    }
+
+    TemporaryDirectory foreign("slot-test");
+    {
+        std::ofstream out(foreign.path() + "/series.slots", std::ios::binary);
+        out << "definitely not a slot file, but long enough to hold a header of sixty-four bytes";
+    }
+    bool threw = false;
+    try {
+        SlotStore::open(foreign.path(), 4);
+    }
+    catch (const std::runtime_error&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    if (!SlotStore::supported()) {
+        std::printf("SlotStoreTest: memory-mapped slots are not supported on this platform; skipped\n");
+        return 0;
+    }
+    testRecover();
+    testGenerations();
+    testDeclinedSlots();
+    testExhaustion();
+    testFileLayout();
+    return testResult("SlotStoreTest");
+}
@@ -0,0 +1,206 @@
+#include "TestSupport.h"
+#include "IoTMetricsServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+/// @brief First API port used by the test; each server instance takes the next two ports.
+constexpr int base_port = 18640;
+
+/**
+ * @brief Sets an environment variable for servers constructed afterwards.
+ */
+void setEnvironment(const char* name, const std::string& value) {
+#ifdef _WIN32
+    _putenv_s(name, value.c_str());
+#else
+    setenv(name, value.c_str(), 1);
+#endif
+}
+
+/**
+ * @brief A server started on its own thread, stopped (taking its final snapshot) on destruction.
+ */
+class RunningServer {
+public:
+    /// @brief Construct the server (restoring the data directory) and wait until it answers.
+    explicit RunningServer(int port)
+        : server_(port, port + 1)
+        , thread_([this] { server_.start(); })
+        , client_("127.0.0.1", port)
+    {
+        client_.set_connection_timeout(std::chrono::seconds(1));
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            auto response = client_.Get("/health");
+            if (response && response->status == 200) {
+                ready_ = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        CHECK(ready_);
+    }
+
+    /// @brief Stop the server and wait for start() to return.
+    ~RunningServer() {
+        server_.stop();
+        thread_.join();
+    }
+
+    /// @brief Submit one metric; returns the HTTP status (0 if the request failed).
+    int submit(const std::string& body) {
+        auto response = client_.Post("/api/metrics", body, "application/json");
+        return response ? response->status : 0;
+    }
+
+    /// @brief Text exposition of /metrics.
+    std::string exposition() {
+        auto response = client_.Get("/metrics");
+        return response && response->status == 200 ? response->body : std::string();
+    }
+
+    /// @brief The persistence.restored object of /api/status.
+    json restored() {
+        auto response = client_.Get("/api/status");
+        if (!response || response->status != 200) {
+            return json::object();
+        }
+        return json::parse(response->body)["persistence"]["restored"];
+    }
+
+private:
+    /// @brief The server.
+    IoTMetricsServer server_;
+    /// @brief Thread blocked in start().
+    std::thread thread_;
+    /// @brief Client for the API port.
+    httplib::Client client_;
+    /// @brief Whether /health answered.
+    bool ready_ = false;
+};
+
+/**
+ * @brief Snapshot numbers in a data directory, ascending.
+ */
+std::vector<uint64_t> snapshotNumbers(const std::string& directory) {
+    std::vector<uint64_t> numbers;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        const std::string name = entry.path().filename().string();
+        if (name.rfind("snapshot-", 0) == 0 && name.size() > 13 && name.compare(name.size() - 4, 4, ".bin") == 0) {
+            numbers.push_back(std::stoull(name.substr(9, name.size() - 13)));
+        }
+    }
+    std::sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+/**
+ * @brief Path of a snapshot file, named the way the server names them.
+ */
+std::string snapshotPath(const std::string& directory, uint64_t number) {
+    char name[48];
+    std::snprintf(name, sizeof(name), "snapshot-%020llu.bin", static_cast<unsigned long long>(number));
+    return directory + "/" + name;
+}
+
+/**
+ * @brief Whether the exposition has a sample line with exactly this name, labels and value.
+ */
+bool hasSample(const std::string& exposition, const std::string& sample) {
+    return exposition.find("\n" + sample + "\n") != std::string::npos;
+}
+
+/**
+ * @brief Every kind of series written before a shutdown comes back from the snapshot after a restart.
+ */
+void testRoundTrip(const std::string& directory, int& port) {
+    {
+        RunningServer server(port += 2);
+        CHECK(server.submit(R"({"metric_name":"rt_requests","instrument_type":"counter","value":5,"attributes":{"room":"a"}})") == 200);
+        CHECK(server.submit(R"({"metric_name":"rt_requests","instrument_type":"counter","value":2,"attributes":{"room":"a"}})") == 200);
+        CHECK(server.submit(R"({"metric_name":"rt_latency","instrument_type":"histogram","value":12})") == 200);
+        CHECK(server.submit(R"({"metric_name":"rt_temp","instrument_type":"gauge","value":21.5})") == 200);
+    }
+    CHECK(!snapshotNumbers(directory).empty());
+
+    RunningServer server(port += 2);
+    const json restored = server.restored();
+    CHECK(restored.value("snapshot", uint64_t{ 0 }) == snapshotNumbers(directory).back());
+    CHECK(restored.value("snapshot_series", size_t{ 0 }) == 3);
+
+    const std::string exposition = server.exposition();
+    CHECK(hasSample(exposition, R"(rt_requests{room="a"} 7)"));
+    CHECK(hasSample(exposition, R"(rt_latency_bucket{le="25"} 1)"));
+    CHECK(hasSample(exposition, "rt_latency_count 1"));
+    CHECK(hasSample(exposition, "rt_latency_sum 12"));
+    CHECK(hasSample(exposition, "rt_temp 21.5"));
+}
+
+/**
+ * @brief A truncated or garbage newest snapshot is skipped in favour of the newest intact one.
+ */
+void testCorruptNewestSnapshot(const std::string& directory, int& port) {
+    const std::vector<uint64_t> numbers = snapshotNumbers(directory);
+    CHECK(!numbers.empty());
+    if (numbers.empty()) {
+        return;
+    }
+    const uint64_t intact = numbers.back();
+    std::ifstream in(snapshotPath(directory, intact), std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK(data.size() > 16);
+    {
+        std::ofstream truncated(snapshotPath(directory, intact + 7), std::ios::binary);
+        truncated << data.substr(0, data.size() / 2);
+        std::ofstream garbage(snapshotPath(directory, intact + 10), std::ios::binary);
+        garbage << "not a snapshot";
+    }
+
+    RunningServer server(port += 2);
+    CHECK(server.restored().value("snapshot", uint64_t{ 0 }) == intact);
+    CHECK(hasSample(server.exposition(), R"(rt_requests{room="a"} 7)"));
+}
+
+/**
+ * @brief A data directory holding only an unreadable snapshot starts empty and keeps working.
+ */
+void testGarbageOnly(int& port) {
+    TemporaryDirectory directory("snapshot-test");
+    {
+        std::ofstream garbage(snapshotPath(directory.path(), 3), std::ios::binary);
+        garbage << std::string(100, '\x7f');
+    }
+    setEnvironment("IOT_METRICS_DATA_DIR", directory.path());
+
+    RunningServer server(port += 2);
+    const json restored = server.restored();
+    CHECK(restored.value("snapshot", uint64_t{ 1 }) == 0);
+    CHECK(restored.value("snapshot_series", size_t{ 1 }) == 0);
+    CHECK(server.submit(R"({"metric_name":"after_restart","instrument_type":"gauge","value":1})") == 200);
+    CHECK(hasSample(server.exposition(), "after_restart 1"));
+}
+
+} // namespace
+
+int main() {
+    // Slots would hold counters and gauges outside the snapshot; this test is about the snapshot itself
+    TemporaryDirectory directory("snapshot-test");
+    setEnvironment("IOT_METRICS_DATA_DIR", directory.path());
+    setEnvironment("IOT_METRICS_SERIES_SLOTS", "0");
+
+    int port = base_port;
+    testRoundTrip(directory.path(), port);
+    testCorruptNewestSnapshot(directory.path(), port);
+    testGarbageOnly(port);
+    return testResult("SnapshotTest");
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <system_error>
+
+/// @brief Number of failed checks in this test program.
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+/// @brief Record a failure (with its location) if a condition is false, then carry on.
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++testFailures(); \
+        } \
+    } while (0)
+
+/// @brief Print the outcome and return the process exit code (non-zero if any check failed).
+inline int testResult(const char* name) {
+    if (testFailures() > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, testFailures());
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+/// @brief A fresh, empty directory under the system temporary directory, removed on destruction.
+class TemporaryDirectory {
+public:
+    /// @brief Create the directory.
+    /// @param prefix Start of the directory name.
+    explicit TemporaryDirectory(const std::string& prefix) {
+        std::random_device random;
+        path_ = std::filesystem::temp_directory_path() / (prefix + "-" + std::to_string(random()));
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+
+    /// @brief Remove the directory and everything in it.
+    ~TemporaryDirectory() {
+        std::error_code error;
+        std::filesystem::remove_all(path_, error);
+    }
+
+    TemporaryDirectory(const TemporaryDirectory&) = delete;
+    TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+    /// @brief Path of the directory.
+    std::string path() const { return path_.string(); }
+
+private:
+    /// @brief Path of the directory.
+    std::filesystem::path path_;
+};
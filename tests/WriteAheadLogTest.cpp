@@ -0,0 +1,220 @@
+#include "TestSupport.h"
+#include "WriteAheadLog.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Reads a whole file.
+ */
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @brief Replaces a file's contents.
+ */
+void writeFile(const std::string& path, const std::string& data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+/**
+ * @brief Replays a segment into a list of records.
+ */
+std::vector<std::string> replayAll(const std::string& path, bool& torn) {
+    std::vector<std::string> records;
+    WriteAheadLog::replay(path, [&](std::string_view record) { records.emplace_back(record); }, torn);
+    return records;
+}
+
+/**
+ * @brief Reads a little-endian 32-bit value from a string.
+ */
+uint32_t readUint32(const std::string& bytes, size_t offset) {
+    uint32_t value = 0;
+    for (int i = 3; i >= 0; --i) {
+        value = (value << 8) | static_cast<unsigned char>(bytes[offset + i]);
+    }
+    return value;
+}
+
+/**
+ * @brief A record is framed as its length and CRC-32 (little-endian), then the payload.
+ */
+void testFraming() {
+    CHECK(WriteAheadLog::checksum("123456789", 9) == 0xCBF43926u);
+    CHECK(WriteAheadLog::checksum("", 0) == 0u);
+
+    std::string framed;
+    WriteAheadLog::frameRecord(framed, "123456789");
+    CHECK(framed.size() == 8 + 9);
+    CHECK(readUint32(framed, 0) == 9u);
+    CHECK(readUint32(framed, 4) == 0xCBF43926u);
+    CHECK(framed.substr(8) == "123456789");
+
+    WriteAheadLog::frameRecord(framed, "");
+    CHECK(framed.size() == 17 + 8);
+    CHECK(readUint32(framed, 17) == 0u);
+}
+
+/**
+ * @brief Appended records are committed in order and replayed byte for byte.
+ */
+void testAppendAndReplay() {
+    TemporaryDirectory directory("wal-test");
+    const std::string large(100000, 'x');
+    {
+        WriteAheadLog wal(directory.path(), 1, std::chrono::milliseconds(5));
+        wal.append("alpha");
+        wal.append("");
+        std::string binary("\0\1\2\xff", 4);
+        wal.append(binary);
+        const uint64_t last = wal.append(large);
+        CHECK(wal.waitFor(last));
+        CHECK(wal.records() == 4);
+        CHECK(wal.errors() == 0);
+        CHECK(wal.bytes() == 4 * 8 + 5 + 0 + 4 + large.size());
+    }
+
+    bool torn = true;
+    const std::vector<std::string> records = replayAll(WriteAheadLog::segmentPath(directory.path(), 1), torn);
+    CHECK(!torn);
+    CHECK(records.size() == 4);
+    if (records.size() == 4) {
+        CHECK(records[0] == "alpha");
+        CHECK(records[1].empty());
+        CHECK(records[2] == std::string("\0\1\2\xff", 4));
+        CHECK(records[3] == large);
+    }
+}
+
+/**
+ * @brief Records still pending when the log is destroyed are committed first.
+ */
+void testDestructorCommits() {
+    TemporaryDirectory directory("wal-test");
+    {
+        WriteAheadLog wal(directory.path(), 3, std::chrono::milliseconds(60000));
+        wal.append("pending");
+    }
+    bool torn = true;
+    const std::vector<std::string> records = replayAll(WriteAheadLog::segmentPath(directory.path(), 3), torn);
+    CHECK(!torn);
+    CHECK(records.size() == 1 && records[0] == "pending");
+}
+
+/**
+ * @brief Replay stops at a truncated, corrupt or oversized record and keeps everything before it.
+ */
+void testTornTail() {
+    TemporaryDirectory directory("wal-test");
+    const std::string path = directory.path() + "/segment";
+    std::string intact;
+    WriteAheadLog::frameRecord(intact, "first");
+    WriteAheadLog::frameRecord(intact, "second");
+    std::string third;
+    WriteAheadLog::frameRecord(third, "third record");
+
+    bool torn = true;
+    writeFile(path, intact);
+    CHECK(replayAll(path, torn).size() == 2);
+    CHECK(!torn);
+
+    // Crash in the middle of a header, then in the middle of a payload
+    for (size_t cut : { size_t{ 3 }, size_t{ 10 } }) {
+        writeFile(path, intact + third.substr(0, cut));
+        const std::vector<std::string> records = replayAll(path, torn);
+        CHECK(torn);
+        CHECK(records.size() == 2 && records[1] == "second");
+    }
+
+    // A flipped payload byte fails the checksum; the records after it are not trusted either
+    std::string corrupt = intact + third;
+    corrupt[8 + 5 + 8] ^= 0x01;
+    writeFile(path, corrupt);
+    const std::vector<std::string> records = replayAll(path, torn);
+    CHECK(torn);
+    CHECK(records.size() == 1 && records[0] == "first");
+
+    // A length beyond max_record_length is corruption, not an allocation request
+    std::string oversized = intact;
+    const uint32_t length = WriteAheadLog::max_record_length + 1;
+    for (int i = 0; i < 4; ++i) {
+        oversized += static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+    oversized += std::string(4, '\0');
+    writeFile(path, oversized);
+    CHECK(replayAll(path, torn).size() == 2);
+    CHECK(torn);
+
+    CHECK(replayAll(directory.path() + "/missing", torn).empty());
+    CHECK(torn);
+}
+
+/**
+ * @brief rotate() commits to the current segment and moves on to the next number.
+ */
+void testRotation() {
+    TemporaryDirectory directory("wal-test");
+    {
+        WriteAheadLog wal(directory.path(), 4, std::chrono::milliseconds(5));
+        CHECK(wal.segment() == 4);
+        wal.append("before");
+        uint64_t segment = 0;
+        CHECK(wal.rotate(segment));
+        CHECK(segment == 5);
+        CHECK(wal.segment() == 5);
+        wal.append("after");
+        wal.flush();
+    }
+
+    bool torn = true;
+    std::vector<std::string> records = replayAll(WriteAheadLog::segmentPath(directory.path(), 4), torn);
+    CHECK(!torn);
+    CHECK(records.size() == 1 && records[0] == "before");
+    records = replayAll(WriteAheadLog::segmentPath(directory.path(), 5), torn);
+    CHECK(!torn);
+    CHECK(records.size() == 1 && records[0] == "after");
+
+    uint64_t number = 0;
+    const std::string name = std::filesystem::path(WriteAheadLog::segmentPath(directory.path(), 42)).filename().string();
+    CHECK(WriteAheadLog::parseSegmentName(name, number));
+    CHECK(number == 42);
+    CHECK(!WriteAheadLog::parseSegmentName("wal-.log", number));
+    CHECK(!WriteAheadLog::parseSegmentName("wal-12x.log", number));
+    CHECK(!WriteAheadLog::parseSegmentName("wal-12.log.tmp", number));
+    CHECK(!WriteAheadLog::parseSegmentName("snapshot-12.bin", number));
+}
+
+/**
+ * @brief replaceFile() swaps in the new contents and leaves no temporary file behind.
+ */
+void testReplaceFile() {
+    TemporaryDirectory directory("wal-test");
+    const std::string path = directory.path() + "/state";
+    CHECK(WriteAheadLog::replaceFile(path, "first"));
+    CHECK(readFile(path) == "first");
+    CHECK(WriteAheadLog::replaceFile(path, "second"));
+    CHECK(readFile(path) == "second");
+    CHECK(!std::filesystem::exists(path + ".tmp"));
+    CHECK(!WriteAheadLog::replaceFile(directory.path() + "/missing/state", "data"));
+}
+
+} // namespace
+
+int main() {
+    testFraming();
+    testAppendAndReplay();
+    testDestructorCommits();
+    testTornTail();
+    testRotation();
+    testReplaceFile();
+    return testResult("WriteAheadLogTest");
+}